@@ -0,0 +1,249 @@
+#include "generators.h"
+#include "../circuit/hierarchy/circuit-definition.h"
+
+#include <memory>
+#include <random>
+
+using GateID = CircuitGate::GateID;
+
+static GateID addNot(Circuit& circuit, GateID a) {
+    CircuitGate &gate = circuit.add<CircuitGate_Not>();
+    gate.updateInput(a, 0, 0);
+    return gate.getId();
+}
+
+static GateID addAnd(Circuit& circuit, GateID a, GateID b) {
+    CircuitGate &gate = circuit.add<CircuitGate_And>();
+    gate.updateInput(a, 0, 0);
+    gate.updateInput(b, 0, 1);
+    return gate.getId();
+}
+
+static GateID addOr(Circuit& circuit, GateID a, GateID b) {
+    return addNot(circuit, addAnd(circuit, addNot(circuit, a), addNot(circuit, b)));
+}
+
+static GateID addXor(Circuit& circuit, GateID a, GateID b) {
+    return addAnd(circuit, addOr(circuit, a, b), addNot(circuit, addAnd(circuit, a, b)));
+}
+
+static std::vector<GateID> addBoolInputs(BenchCircuit& bench, size_t count) {
+    std::vector<GateID> inputs;
+    for (size_t i = 0; i < count; i++) {
+        inputs.push_back(bench.circuit.add<CircuitGate_ConstBool>().getId());
+    }
+
+    bench.inputs.insert(bench.inputs.end(), inputs.begin(), inputs.end());
+    return inputs;
+}
+
+BenchCircuit makeRippleCarryAdder(size_t bits) {
+    BenchCircuit bench;
+    bench.name = "ripple-carry-adder";
+    bench.params = {{"bits", bits}};
+
+    Circuit &c = bench.circuit;
+    const std::vector<GateID> a = addBoolInputs(bench, bits);
+    const std::vector<GateID> b = addBoolInputs(bench, bits);
+
+    // the first bit is a half adder, as there is no carry-in
+    GateID carry = addAnd(c, a[0], b[0]);
+    bench.outputs.push_back(addXor(c, a[0], b[0]));
+
+    for (size_t i = 1; i < bits; i++) {
+        const GateID half = addXor(c, a[i], b[i]);
+        bench.outputs.push_back(addXor(c, half, carry));
+        carry = addOr(c, addAnd(c, a[i], b[i]), addAnd(c, half, carry));
+    }
+
+    bench.outputs.push_back(carry);
+    return bench;
+}
+
+BenchCircuit makeHierarchicalAdder(size_t bits) {
+    BenchCircuit bench;
+    bench.name = "hierarchical-adder";
+    bench.params = {{"bits", bits}};
+
+    Circuit contents;
+    const GateID x = contents.add<CircuitGate_ConstBool>().getId();
+    const GateID y = contents.add<CircuitGate_ConstBool>().getId();
+    const GateID carryIn = contents.add<CircuitGate_ConstBool>().getId();
+    const GateID half = addXor(contents, x, y);
+    const GateID sum = addXor(contents, half, carryIn);
+    const GateID carryOut = addOr(contents, addAnd(contents, x, y), addAnd(contents, half, carryIn));
+
+    const auto fullAdder = std::make_shared<const CircuitDefinition>(
+            "FullAdder", std::move(contents),
+            std::vector<CircuitDefinition::Port>{{"x", x}, {"y", y}, {"cin", carryIn}},
+            std::vector<CircuitDefinition::Port>{{"sum", sum}, {"cout", carryOut}});
+
+    Circuit &c = bench.circuit;
+    const std::vector<GateID> a = addBoolInputs(bench, bits);
+    const std::vector<GateID> b = addBoolInputs(bench, bits);
+
+    // the carry into the first bit is a constant false
+    GateID carry = addAnd(c, a[0], addNot(c, a[0]));
+    size_t carryOutput = 0;
+
+    for (size_t i = 0; i < bits; i++) {
+        CircuitGate &adder = c.add<CircuitGate_SubCircuit>({}, fullAdder);
+        adder.updateInput(a[i], 0, 0);
+        adder.updateInput(b[i], 0, 1);
+        adder.updateInput(carry, carryOutput, 2);
+
+        bench.outputs.push_back(adder.getId());
+        carry = adder.getId();
+        carryOutput = 1;
+    }
+
+    return bench;
+}
+
+BenchCircuit makeCarryLookaheadAdder(size_t bits) {
+    BenchCircuit bench;
+    bench.name = "carry-lookahead-adder";
+    bench.params = {{"bits", bits}};
+
+    Circuit &c = bench.circuit;
+    const std::vector<GateID> a = addBoolInputs(bench, bits);
+    const std::vector<GateID> b = addBoolInputs(bench, bits);
+
+    std::vector<GateID> propagate(bits), generate(bits);
+    for (size_t i = 0; i < bits; i++) {
+        propagate[i] = addXor(c, a[i], b[i]);
+        generate[i] = addAnd(c, a[i], b[i]);
+    }
+
+    // Kogge-Stone prefix: after the pass with distance d, G[i] and P[i] cover bits (i - 2d, i]
+    std::vector<GateID> groupGenerate = generate, groupPropagate = propagate;
+    for (size_t distance = 1; distance < bits; distance *= 2) {
+        std::vector<GateID> nextGenerate = groupGenerate, nextPropagate = groupPropagate;
+
+        for (size_t i = distance; i < bits; i++) {
+            const GateID carried = addAnd(c, groupPropagate[i], groupGenerate[i - distance]);
+            nextGenerate[i] = addOr(c, groupGenerate[i], carried);
+            nextPropagate[i] = addAnd(c, groupPropagate[i], groupPropagate[i - distance]);
+        }
+
+        groupGenerate = std::move(nextGenerate);
+        groupPropagate = std::move(nextPropagate);
+    }
+
+    bench.outputs.push_back(propagate[0]);
+    for (size_t i = 1; i < bits; i++) {
+        bench.outputs.push_back(addXor(c, propagate[i], groupGenerate[i - 1]));
+    }
+
+    bench.outputs.push_back(groupGenerate[bits - 1]);
+    return bench;
+}
+
+BenchCircuit makeMultiplierTree(size_t terms) {
+    BenchCircuit bench;
+    bench.name = "multiplier-tree";
+    bench.params = {{"terms", terms}};
+
+    Circuit &c = bench.circuit;
+    std::vector<GateID> layer;
+
+    for (size_t i = 0; i < terms; i++) {
+        CircuitGate &x = c.add<CircuitGate_ConstInt>();
+        CircuitGate &y = c.add<CircuitGate_ConstInt>();
+        bench.inputs.push_back(x.getId());
+        bench.inputs.push_back(y.getId());
+
+        CircuitGate &product = c.add<CircuitGate_Mul>();
+        product.updateInput(x.getId(), 0, 0);
+        product.updateInput(y.getId(), 0, 1);
+        layer.push_back(product.getId());
+    }
+
+    while (layer.size() > 1) {
+        std::vector<GateID> next;
+
+        for (size_t i = 0; i + 1 < layer.size(); i += 2) {
+            CircuitGate &sum = c.add<CircuitGate_Add>();
+            sum.updateInput(layer[i], 0, 0);
+            sum.updateInput(layer[i + 1], 0, 1);
+            next.push_back(sum.getId());
+        }
+        if (layer.size() % 2 == 1) {
+            next.push_back(layer.back());
+        }
+
+        layer = std::move(next);
+    }
+
+    bench.outputs = layer;
+    return bench;
+}
+
+BenchCircuit makeInverterChain(size_t depth) {
+    BenchCircuit bench;
+    bench.name = "inverter-chain";
+    bench.params = {{"depth", depth}};
+
+    GateID last = addBoolInputs(bench, 1)[0];
+    for (size_t i = 0; i < depth; i++) {
+        last = addNot(bench.circuit, last);
+    }
+
+    bench.outputs.push_back(last);
+    return bench;
+}
+
+BenchCircuit makeRandomDag(size_t width, size_t depth, uint64_t seed) {
+    BenchCircuit bench;
+    bench.name = "random-dag";
+    bench.params = {{"width", width}, {"depth", depth}, {"seed", seed}};
+
+    // gates read from anywhere within the last few layers, not just the previous one
+    constexpr size_t WINDOW_LAYERS = 4;
+
+    Circuit &c = bench.circuit;
+    std::mt19937_64 rng(seed);
+    std::vector<std::vector<GateID>> layers = {addBoolInputs(bench, width)};
+
+    for (size_t l = 0; l < depth; l++) {
+        const size_t firstLayer = layers.size() > WINDOW_LAYERS ? layers.size() - WINDOW_LAYERS : 0;
+        const size_t candidates = (layers.size() - firstLayer) * width;
+
+        auto pick = [&]() {
+            const size_t k = rng() % candidates;
+            return layers[firstLayer + k / width][k % width];
+        };
+
+        // the first operand always comes from the previous layer, which keeps the depth exact
+        auto pickPrevious = [&]() { return layers.back()[rng() % width]; };
+
+        std::vector<GateID> layer(width);
+        for (size_t i = 0; i < width; i++) {
+            layer[i] = rng() % 4 == 0 ? addNot(c, pickPrevious()) : addAnd(c, pickPrevious(), pick());
+        }
+
+        layers.push_back(std::move(layer));
+    }
+
+    bench.outputs = layers.back();
+    return bench;
+}
+
+BenchCircuit makeCounter(size_t bits) {
+    BenchCircuit bench;
+    bench.name = "counter";
+    bench.params = {{"bits", bits}};
+
+    Circuit &c = bench.circuit;
+    GateID carry = addBoolInputs(bench, 1)[0];
+
+    for (size_t i = 0; i < bits; i++) {
+        CircuitGate &state = c.add<CircuitGate_Register>();
+        state.updateInput(addXor(c, state.getId(), carry), 0, 0);
+        carry = addAnd(c, state.getId(), carry);
+
+        bench.outputs.push_back(state.getId());
+    }
+
+    return bench;
+}
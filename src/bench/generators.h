@@ -0,0 +1,63 @@
+#ifndef CIRCUIT_BENCH_GENERATORS_H
+#define CIRCUIT_BENCH_GENERATORS_H
+
+#include "../circuit/circuit.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * A synthetic circuit together with its primary inputs (ConstBool or ConstInt gates, which the
+ * benchmarks drive) and the outputs it computes.
+ */
+struct BenchCircuit {
+    std::string name;
+    std::vector<std::pair<std::string, size_t>> params;
+
+    Circuit circuit;
+    std::vector<CircuitGate::GateID> inputs;
+    std::vector<CircuitGate::GateID> outputs;
+};
+
+/**
+ * `bits`-wide adder built from full adders made of And/Not gates, the carry rippling through
+ * all of them. Depth grows linearly with the width.
+ */
+BenchCircuit makeRippleCarryAdder(size_t bits);
+
+/**
+ * `bits`-wide adder with a Kogge-Stone carry-lookahead network, also made of And/Not gates only.
+ * Depth grows logarithmically with the width, at the cost of more gates and heavy reconvergence.
+ */
+BenchCircuit makeCarryLookaheadAdder(size_t bits);
+
+/**
+ * The ripple carry adder again, but made of instances of a single full adder sub-circuit. Only the
+ * sum bits are outputs.
+ */
+BenchCircuit makeHierarchicalAdder(size_t bits);
+
+/**
+ * Sum of `terms` Int products, reduced by a balanced tree of Add gates.
+ */
+BenchCircuit makeMultiplierTree(size_t terms);
+
+/**
+ * A single input followed by `depth` Not gates; as deep and narrow as a circuit gets.
+ */
+BenchCircuit makeInverterChain(size_t depth);
+
+/**
+ * `depth` layers of `width` And/Not gates each, every gate reading random gates of the few
+ * layers before it, so that paths split and reconverge all over the place.
+ */
+BenchCircuit makeRandomDag(size_t width, size_t depth, uint64_t seed);
+
+/**
+ * `bits`-wide binary counter: one register per bit and a ripple of half adders computing the next
+ * count, counting up on every clock cycle while its single input is set. The registers are the
+ * outputs. Most cycles only flip the lowest few bits, which makes it the sequential benchmark.
+ */
+BenchCircuit makeCounter(size_t bits);
+
+#endif //CIRCUIT_BENCH_GENERATORS_H
@@ -0,0 +1,415 @@
+#include "generators.h"
+#include "../circuit/compiler/batch-evaluator.h"
+#include "../circuit/compiler/compiled-circuit.h"
+#include "../circuit/compiler/cone-evaluator.h"
+#include "../circuit/compiler/event-simulator.h"
+#include "../circuit/compiler/native-evaluator.h"
+#include "../circuit/compiler/optimizer.h"
+#include "../circuit/compiler/parallel-evaluator.h"
+#include "../circuit/io/netlist.h"
+#include "../circuit/io/trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sys/resource.h>
+#include <thread>
+
+using Clock = std::chrono::steady_clock;
+
+// set by the build, see CMakeLists.txt
+#ifndef CIRCUIT_BUILD_TYPE
+#define CIRCUIT_BUILD_TYPE ""
+#endif
+#ifndef CIRCUIT_CXX_FLAGS
+#define CIRCUIT_CXX_FLAGS ""
+#endif
+#ifndef CIRCUIT_COMPILER
+#define CIRCUIT_COMPILER ""
+#endif
+
+struct Options {
+    size_t scale = 1;
+    std::string filter;
+    double minTime = 0.2;
+    size_t threads = std::thread::hardware_concurrency();
+    size_t lanes = 1024;
+    std::string outputPath;
+};
+
+struct Timing {
+    size_t runs = 0;
+    double minUs = 0, medianUs = 0, meanUs = 0;
+};
+
+struct ModeResult {
+    std::string mode;
+    Timing timing;
+    double gateEvalsPerSec = 0;
+    long peakRssKb = 0;
+};
+
+struct BenchResult {
+    std::string name;
+    std::vector<std::pair<std::string, size_t>> params;
+    size_t gatesCount, instructionsCount, levelsCount, circuitBytes;
+    double buildMs, compileMs;
+    std::vector<ModeResult> modes;
+};
+
+static void printUsage() {
+    std::cerr << "usage: circuit-bench [--scale <n>] [--filter <substring>] [--min-time <seconds>]\n"
+                 "                     [--threads <n>] [--lanes <n>] [-o <output>]\n"
+                 "\n"
+                 "Generates synthetic circuits, evaluates each one with every evaluator and writes the\n"
+                 "results as JSON. --scale multiplies the size of every circuit, --filter only runs the\n"
+                 "circuits whose name contains the given string. The results name the build type and\n"
+                 "compiler flags of the binary, as numbers of differently built binaries do not compare.\n";
+}
+
+static double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+/**
+ * Resets the peak resident set size of the process, so that the next `getPeakRssKb()` covers
+ * only what happened in between. Linux only; elsewhere the peak just keeps growing.
+ */
+static void resetPeakRss() {
+    std::ofstream clearRefs("/proc/self/clear_refs");
+    clearRefs << "5";
+}
+
+static long getPeakRssKb() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("VmHWM:", 0) == 0) {
+            return std::stol(line.substr(6));
+        }
+    }
+
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+/**
+ * Calls `fn` once to warm up, then repeatedly until `minTime` seconds have passed.
+ */
+static Timing measure(const std::function<void()>& fn, double minTime) {
+    fn();
+
+    std::vector<double> samples;
+    const Clock::time_point start = Clock::now();
+    do {
+        const Clock::time_point runStart = Clock::now();
+        fn();
+        samples.push_back(std::chrono::duration<double, std::micro>(Clock::now() - runStart).count());
+    } while (millisecondsSince(start) < minTime * 1000);
+
+    std::sort(samples.begin(), samples.end());
+
+    Timing timing;
+    timing.runs = samples.size();
+    timing.minUs = samples.front();
+    timing.medianUs = samples[samples.size() / 2];
+    for (double sample : samples) {
+        timing.meanUs += sample / samples.size();
+    }
+
+    return timing;
+}
+
+static ModeResult makeModeResult(const std::string& mode, const Timing& timing, double gateEvalsPerRun) {
+    return {mode, timing, gateEvalsPerRun / (timing.medianUs * 1e-6), getPeakRssKb()};
+}
+
+static void randomizeInputs(BenchCircuit& bench, std::mt19937& rng) {
+    for (CircuitGate::GateID input : bench.inputs) {
+        setConstantValue(bench.circuit[input], static_cast<int>(rng() % 1024));
+    }
+}
+
+static BenchResult runBenchmark(BenchCircuit& bench, double buildMs, const Options& options) {
+    std::mt19937 rng(1);
+    randomizeInputs(bench, rng);
+
+    const Clock::time_point compileStart = Clock::now();
+    CompiledCircuit compiled(bench.circuit);
+    const double compileMs = millisecondsSince(compileStart);
+
+    const double instructions = compiled.getInstructions().size();
+    BenchResult result = {bench.name, bench.params, bench.circuit.getGatesCount(), compiled.getInstructions().size(),
+                          compiled.getLevelsCount(), bench.circuit.getMemoryUsage(), buildMs, compileMs, {}};
+
+    resetPeakRss();
+    const Timing interpreter = measure([&] { compiled.run(); }, options.minTime);
+    result.modes.push_back(makeModeResult("interpreter", interpreter, instructions));
+
+    {
+        resetPeakRss();
+        // the interpreter recording every output after each run, one input changing in between
+        const std::filesystem::path tracePath = std::filesystem::temp_directory_path() / "circuit-bench.trace";
+        std::ofstream traceFile(tracePath, std::ios::binary);
+
+        std::vector<TraceRecorder::Probe> probes;
+        for (CircuitGate::GateID output : bench.outputs) {
+            probes.push_back({std::to_string(output), compiled.getSlot(bench.circuit[output], 0)});
+        }
+
+        TraceRecorder trace(compiled, probes, traceFile);
+        TraceRecorder::Time time = 0;
+        const Timing timing = measure([&] {
+            compiled.setConstant(bench.inputs[rng() % bench.inputs.size()], static_cast<int32_t>(rng() % 1024));
+            compiled.run();
+            trace.record(time++);
+        }, options.minTime);
+
+        trace.finish();
+        std::filesystem::remove(tracePath);
+        result.modes.push_back(makeModeResult("traced", timing, instructions));
+    }
+
+    {
+        resetPeakRss();
+        CompiledCircuit optimized(bench.circuit);
+        CircuitOptimizer().run(optimized, bench.outputs);
+
+        // counted as evaluations of the original gates, so that the gain shows up as throughput
+        const Timing timing = measure([&] { optimized.run(); }, options.minTime);
+        result.modes.push_back(makeModeResult("optimized", timing, instructions));
+    }
+
+    {
+        resetPeakRss();
+        NativeEvaluator native(compiled);
+
+        if (native.isNative()) {
+            const Timing timing = measure([&] { native.run(); }, options.minTime);
+            result.modes.push_back(makeModeResult("native", timing, instructions));
+        } else {
+            std::cerr << "skipping native mode: " << native.getError() << "\n";
+        }
+    }
+
+    {
+        resetPeakRss();
+        ParallelEvaluator parallel(compiled, options.threads);
+        const Timing timing = measure([&] { parallel.run(); }, options.minTime);
+        result.modes.push_back(makeModeResult("parallel", timing, instructions));
+    }
+
+    {
+        resetPeakRss();
+        BatchEvaluator batch(compiled, options.lanes);
+        std::vector<BatchEvaluator::Word> boolLanes(batch.getWordsCount());
+        std::vector<int32_t> intLanes(batch.getLanesCount());
+
+        for (CircuitGate::GateID input : bench.inputs) {
+            const CircuitGate &gate = bench.circuit[input];
+            if (gate.getOutputType(0) == CircuitGate::Bool) {
+                std::generate(boolLanes.begin(), boolLanes.end(), [&] { return (uint64_t(rng()) << 32) | rng(); });
+                batch.driveBool(gate, boolLanes);
+            } else {
+                std::generate(intLanes.begin(), intLanes.end(), [&] { return static_cast<int32_t>(rng() % 1024); });
+                batch.driveInt(gate, intLanes);
+            }
+        }
+
+        const Timing timing = measure([&] { batch.run(); }, options.minTime);
+        result.modes.push_back(makeModeResult("batch", timing, instructions * batch.getLanesCount()));
+    }
+
+    {
+        resetPeakRss();
+        // edit-to-result latency: flip one input and re-evaluate what depends on it
+        CompiledCircuit initial(bench.circuit, bench.outputs);
+        initial.run();
+        initial.storeResults();
+
+        size_t recomputed = 0, runs = 0;
+        const Timing timing = measure([&] {
+            CircuitGate &input = bench.circuit[bench.inputs[rng() % bench.inputs.size()]];
+            setConstantValue(input, static_cast<int>(rng() % 1024));
+
+            CompiledCircuit incremental(bench.circuit, bench.outputs, true);
+            incremental.run();
+            incremental.storeResults();
+
+            recomputed += incremental.getInstructions().size();
+            runs++;
+        }, options.minTime);
+
+        result.modes.push_back(makeModeResult("incremental", timing, double(recomputed) / runs));
+    }
+
+    {
+        resetPeakRss();
+        // probing one output after changing one input, paying only for the part of its cone which changed
+        CompiledCircuit probed(bench.circuit);
+        ConeEvaluator cone(probed);
+
+        size_t runs = 0;
+        const Timing timing = measure([&] {
+            cone.setConstant(bench.inputs[rng() % bench.inputs.size()], static_cast<int32_t>(rng() % 1024));
+            cone.getValue(bench.outputs[rng() % bench.outputs.size()]);
+            runs++;
+        }, options.minTime);
+
+        result.modes.push_back(makeModeResult("cone", timing, double(cone.getEvaluationsCount()) / runs));
+    }
+
+    {
+        resetPeakRss();
+        // one clock cycle after changing one input, paying only for the gates which see a change
+        CompiledCircuit stepped(bench.circuit);
+        EventSimulator events(stepped);
+
+        size_t runs = 0;
+        const uint64_t evaluationsBefore = events.getEvaluationsCount();
+        const Timing timing = measure([&] {
+            events.setConstant(bench.inputs[rng() % bench.inputs.size()], static_cast<int32_t>(rng() % 1024));
+            events.step();
+            runs++;
+        }, options.minTime);
+
+        const double evaluations = events.getEvaluationsCount() - evaluationsBefore;
+        result.modes.push_back(makeModeResult("event", timing, evaluations / runs));
+    }
+
+    return result;
+}
+
+static void writeJson(std::ostream& out, const std::vector<BenchResult>& results, const Options& options) {
+    out << std::setprecision(6);
+    out << "{\n";
+    out << "  \"build_type\": \"" << CIRCUIT_BUILD_TYPE << "\",\n";
+    out << "  \"compiler\": \"" << CIRCUIT_COMPILER << "\",\n";
+    out << "  \"cxx_flags\": \"" << CIRCUIT_CXX_FLAGS << "\",\n";
+    out << "  \"threads\": " << options.threads << ",\n";
+    out << "  \"lanes\": " << options.lanes << ",\n";
+    out << "  \"scale\": " << options.scale << ",\n";
+    out << "  \"benchmarks\": [";
+
+    for (size_t r = 0; r < results.size(); r++) {
+        const BenchResult &result = results[r];
+
+        out << (r > 0 ? "," : "") << "\n    {\n";
+        out << "      \"circuit\": \"" << result.name << "\",\n";
+        out << "      \"params\": {";
+        for (size_t p = 0; p < result.params.size(); p++) {
+            const auto &[name, value] = result.params[p];
+            out << (p > 0 ? ", " : "") << "\"" << name << "\": " << value;
+        }
+        out << "},\n";
+        out << "      \"gates\": " << result.gatesCount << ",\n";
+        out << "      \"instructions\": " << result.instructionsCount << ",\n";
+        out << "      \"levels\": " << result.levelsCount << ",\n";
+        out << "      \"circuit_bytes\": " << result.circuitBytes << ",\n";
+        out << "      \"build_ms\": " << result.buildMs << ",\n";
+        out << "      \"compile_ms\": " << result.compileMs << ",\n";
+        out << "      \"modes\": [";
+
+        for (size_t m = 0; m < result.modes.size(); m++) {
+            const ModeResult &mode = result.modes[m];
+
+            out << (m > 0 ? "," : "") << "\n        {";
+            out << "\"mode\": \"" << mode.mode << "\", ";
+            out << "\"runs\": " << mode.timing.runs << ", ";
+            out << "\"latency_us\": {\"min\": " << mode.timing.minUs << ", \"median\": " << mode.timing.medianUs
+                << ", \"mean\": " << mode.timing.meanUs << "}, ";
+            out << "\"gate_evals_per_sec\": " << mode.gateEvalsPerSec << ", ";
+            out << "\"peak_rss_kb\": " << mode.peakRssKb << "}";
+        }
+
+        out << "\n      ]\n    }";
+    }
+
+    out << "\n  ]\n}\n";
+}
+
+int main(int argc, char **argv) {
+    Options options;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            const std::string arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+
+            if (arg == "-h" || arg == "--help") {
+                printUsage();
+                return 0;
+            } else if (arg == "--scale" && hasValue) {
+                options.scale = std::max<size_t>(1, std::stoul(argv[++i]));
+            } else if (arg == "--filter" && hasValue) {
+                options.filter = argv[++i];
+            } else if (arg == "--min-time" && hasValue) {
+                options.minTime = std::stod(argv[++i]);
+            } else if (arg == "--threads" && hasValue) {
+                options.threads = std::max<size_t>(1, std::stoul(argv[++i]));
+            } else if (arg == "--lanes" && hasValue) {
+                options.lanes = std::max<size_t>(1, std::stoul(argv[++i]));
+            } else if (arg == "-o" && hasValue) {
+                options.outputPath = argv[++i];
+            } else {
+                printUsage();
+                return 2;
+            }
+        }
+    } catch (const std::exception &) {
+        printUsage();
+        return 2;
+    }
+
+    const size_t s = options.scale;
+    const std::vector<std::pair<std::string, std::function<BenchCircuit()>>> generators = {
+            {"ripple-carry-adder", [s] { return makeRippleCarryAdder(256 * s); }},
+            {"hierarchical-adder", [s] { return makeHierarchicalAdder(256 * s); }},
+            {"carry-lookahead-adder", [s] { return makeCarryLookaheadAdder(256 * s); }},
+            {"multiplier-tree", [s] { return makeMultiplierTree(16384 * s); }},
+            {"inverter-chain", [s] { return makeInverterChain(100000 * s); }},
+            {"random-dag", [s] { return makeRandomDag(4096 * s, 64, 1); }},
+            {"counter", [s] { return makeCounter(65536 * s); }},
+    };
+
+    const std::string buildType = CIRCUIT_BUILD_TYPE;
+    if (buildType != "Release" && buildType != "RelWithDebInfo" && buildType != "MinSizeRel") {
+        std::cerr << "warning: benchmarking a build of type '" << buildType << "', which may not be optimized\n";
+    }
+
+    try {
+        std::vector<BenchResult> results;
+
+        for (const auto &[name, generate] : generators) {
+            if (name.find(options.filter) == std::string::npos) continue;
+
+            std::cerr << "running " << name << "...\n";
+            const Clock::time_point buildStart = Clock::now();
+            BenchCircuit bench = generate();
+            const double buildMs = millisecondsSince(buildStart);
+
+            results.push_back(runBenchmark(bench, buildMs, options));
+        }
+
+        std::ofstream outputFile;
+        if (!options.outputPath.empty()) {
+            outputFile.open(options.outputPath);
+            if (!outputFile) {
+                throw std::runtime_error("cannot open " + options.outputPath);
+            }
+        }
+
+        writeJson(options.outputPath.empty() ? std::cout : outputFile, results, options);
+    } catch (const std::exception &e) {
+        std::cerr << "circuit-bench: " << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
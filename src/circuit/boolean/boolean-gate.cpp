@@ -3,6 +3,10 @@
 
 void CircuitGate_ConstTrue::acceptVisitor(CircuitVisitor &visitor) { visitor.visit(*this); }
 
+void CircuitGate_ConstBool::acceptVisitor(CircuitVisitor &visitor) { visitor.visit(*this); }
+
 void CircuitGate_Not::acceptVisitor(CircuitVisitor &visitor) { visitor.visit(*this); }
 
 void CircuitGate_And::acceptVisitor(CircuitVisitor &visitor) { visitor.visit(*this); }
+
+void CircuitGate_Register::acceptVisitor(CircuitVisitor &visitor) { visitor.visit(*this); }
@@ -7,7 +7,7 @@
 struct CircuitVisitor;
 
 struct CircuitGate_ConstTrue : public CircuitGate {
-    explicit CircuitGate_ConstTrue(ImVec2 _pos) : CircuitGate({}, {Bool}, _pos) { }
+    explicit CircuitGate_ConstTrue(CircuitGraph& _graph, Position _pos) : CircuitGate(_graph, {}, {Bool}, _pos) { }
 
     [[nodiscard]]
     std::string getName() const override { return "ConstantTrue"; }
@@ -15,8 +15,19 @@ struct CircuitGate_ConstTrue : public CircuitGate {
     void acceptVisitor(CircuitVisitor& visitor) override;
 };
 
+struct CircuitGate_ConstBool : public CircuitGate {
+    explicit CircuitGate_ConstBool(CircuitGraph& _graph, Position _pos) : CircuitGate(_graph, {}, {Bool}, _pos) { }
+
+    [[nodiscard]]
+    std::string getName() const override { return "Constant (bool)"; }
+
+    bool value = false;
+
+    void acceptVisitor(CircuitVisitor& visitor) override;
+};
+
 struct CircuitGate_Not : public CircuitGate {
-    explicit CircuitGate_Not(ImVec2 _pos) : CircuitGate({Bool}, {Bool}, _pos) { }
+    explicit CircuitGate_Not(CircuitGraph& _graph, Position _pos) : CircuitGate(_graph, {Bool}, {Bool}, _pos) { }
 
     [[nodiscard]]
     std::string getName() const override { return "Not"; }
@@ -25,7 +36,7 @@ struct CircuitGate_Not : public CircuitGate {
 };
 
 struct CircuitGate_And : public CircuitGate {
-    explicit CircuitGate_And(ImVec2 _pos) : CircuitGate({Bool, Bool}, {Bool}, _pos) { }
+    explicit CircuitGate_And(CircuitGraph& _graph, Position _pos) : CircuitGate(_graph, {Bool, Bool}, {Bool}, _pos) { }
 
     [[nodiscard]]
     std::string getName() const override { return "And"; }
@@ -33,4 +44,20 @@ struct CircuitGate_And : public CircuitGate {
     void acceptVisitor(CircuitVisitor& visitor) override;
 };
 
+/**
+ * D flip-flop. The output holds `value`, the stored state, which becomes whatever the input
+ * is on the next clock edge; see `Circuit::clock()`. Reading the state instead of the input is
+ * what lets feedback loops through registers be evaluated.
+ */
+struct CircuitGate_Register : public CircuitGate {
+    explicit CircuitGate_Register(CircuitGraph& _graph, Position _pos) : CircuitGate(_graph, {Bool}, {Bool}, _pos) { }
+
+    [[nodiscard]]
+    std::string getName() const override { return "Register"; }
+
+    bool value = false;
+
+    void acceptVisitor(CircuitVisitor& visitor) override;
+};
+
 #endif //CIRCUIT_BOOLEAN_GATE_H
@@ -0,0 +1,80 @@
+#include "circuit.h"
+#include "compiler/compiled-circuit.h"
+
+template<typename T>
+static void addRegisterInputs(const GateArena<T>& registers, std::vector<CircuitGate::GateID>& roots) {
+    for (size_t i = 0; i < registers.size(); i++) {
+        const CircuitGate::GateID input = registers[i].getInput(0).destGate;
+        if (input != CircuitGate::NO_GATE) {
+            roots.push_back(input);
+        }
+    }
+}
+
+// collects the registers whose input evaluates to something other than their current state
+template<typename T>
+static void readRegisterInputs(const GateArena<T>& registers, const CompiledCircuit& compiled,
+                               std::vector<std::pair<T *, decltype(T::value)>>& changes) {
+    for (size_t i = 0; i < registers.size(); i++) {
+        T &gate = registers[i];
+        if (gate.getInput(0).destGate == CircuitGate::NO_GATE) continue;
+
+        const auto input = compiled.getValue(gate.getInputGate(0), gate.getInput(0).destSlotIndex);
+        if (!input) continue;
+
+        const auto next = std::visit([](auto v) { return static_cast<decltype(T::value)>(v); }, *input);
+        if (next != gate.value) {
+            changes.emplace_back(&gate, next);
+        }
+    }
+}
+
+template<typename T, typename V>
+static void latchRegisters(const std::vector<std::pair<T *, V>>& changes) {
+    for (const auto &[gate, value] : changes) {
+        gate->value = value;
+        gate->invalidate();
+    }
+}
+
+void Circuit::clock() {
+    const auto &boolRegisters = std::get<GateArena<CircuitGate_Register>>(arenas);
+    const auto &intRegisters = std::get<GateArena<CircuitGate_IntRegister>>(arenas);
+
+    // the fan-in of the register inputs is evaluated like any compiled circuit, without recursion,
+    // so that arbitrarily deep logic cannot overflow the stack
+    std::vector<CircuitGate::GateID> roots;
+    addRegisterInputs(boolRegisters, roots);
+    addRegisterInputs(intRegisters, roots);
+    if (roots.empty()) return;
+
+    CompiledCircuit compiled(CompiledCircuit::Snapshot(*this, roots, true));
+    compiled.run();
+    // the fan-in stays cached, as gate-level evaluation would have left it
+    compiled.storeResults();
+
+    std::vector<std::pair<CircuitGate_Register *, bool>> boolChanges;
+    std::vector<std::pair<CircuitGate_IntRegister *, int>> intChanges;
+    readRegisterInputs(boolRegisters, compiled, boolChanges);
+    readRegisterInputs(intRegisters, compiled, intChanges);
+
+    latchRegisters(boolChanges);
+    latchRegisters(intChanges);
+}
+
+const CircuitValidation& Circuit::validate() const {
+    if (!validation || validation->getRevision() != getRevision()) {
+        validation.emplace(*this);
+    }
+
+    return *validation;
+}
+
+size_t Circuit::getMemoryUsage() const {
+    size_t bytes = graph->gates.capacity() * sizeof(CircuitGate *)
+                   + graph->inputs.capacity() * sizeof(CircuitGate::InputPin)
+                   + graph->outputs.getMemoryUsage();
+
+    std::apply([&](const auto&... arena) { ((bytes += arena.getAllocatedBytes()), ...); }, arenas);
+    return bytes;
+}
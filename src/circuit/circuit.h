@@ -0,0 +1,153 @@
+#ifndef CIRCUIT_CIRCUIT_H
+#define CIRCUIT_CIRCUIT_H
+
+#include "boolean/boolean-gate.h"
+#include "hierarchy/sub-circuit-gate.h"
+#include "num/num-gate.h"
+#include "validation.h"
+#include <memory>
+#include <new>
+#include <optional>
+#include <tuple>
+
+/**
+ * Storage for gates of a single type, handed out from fixed-size blocks. Gates never move once
+ * created and are all destroyed together with the arena.
+ */
+template<typename T>
+class GateArena {
+    constexpr static size_t BLOCK_SIZE = 256;
+
+    struct Block {
+        alignas(T) std::byte storage[BLOCK_SIZE * sizeof(T)];
+    };
+
+    std::vector<std::unique_ptr<Block>> blocks;
+    size_t count = 0;
+
+public:
+    GateArena() = default;
+
+    GateArena(const GateArena&) = delete;
+
+    GateArena(GateArena&& other) noexcept : blocks(std::move(other.blocks)), count(std::exchange(other.count, 0)) { }
+
+    ~GateArena() {
+        for (size_t i = 0; i < count; i++) {
+            (*this)[i].~T();
+        }
+    }
+
+    template<typename... Args>
+    T& emplace(Args&&... args) {
+        if (count == blocks.size() * BLOCK_SIZE) {
+            blocks.push_back(std::unique_ptr<Block>(new Block));
+        }
+
+        void *place = blocks[count / BLOCK_SIZE]->storage + (count % BLOCK_SIZE) * sizeof(T);
+        T *gate = new (place) T(std::forward<Args>(args)...);
+        count++;
+
+        return *gate;
+    }
+
+    [[nodiscard]]
+    T& operator[](size_t index) const {
+        return *std::launder(reinterpret_cast<T *>(blocks[index / BLOCK_SIZE]->storage + (index % BLOCK_SIZE) * sizeof(T)));
+    }
+
+    [[nodiscard]]
+    size_t size() const { return count; }
+
+    [[nodiscard]]
+    size_t getAllocatedBytes() const { return blocks.size() * sizeof(Block); }
+};
+
+/**
+ * Owns a set of gates, allocated in one arena per gate type, together with the flat pin arrays
+ * they share. Gates are addressed by their `GateID`, which is their index in creation order, and
+ * stay at the same address for the lifetime of the circuit (moving the circuit included).
+ */
+class Circuit {
+    using GateID = CircuitGate::GateID;
+
+    std::unique_ptr<CircuitGraph> graph = std::make_unique<CircuitGraph>();
+
+    std::tuple<
+        GateArena<CircuitGate_ConstTrue>,
+        GateArena<CircuitGate_ConstBool>,
+        GateArena<CircuitGate_Not>,
+        GateArena<CircuitGate_And>,
+        GateArena<CircuitGate_Register>,
+        GateArena<CircuitGate_ConstInt>,
+        GateArena<CircuitGate_Add>,
+        GateArena<CircuitGate_Mul>,
+        GateArena<CircuitGate_CmpLe>,
+        GateArena<CircuitGate_IntRegister>,
+        GateArena<CircuitGate_SubCircuit>
+    > arenas;
+
+    mutable std::optional<CircuitValidation> validation;
+
+public:
+    Circuit() = default;
+
+    Circuit(const Circuit&) = delete;
+
+    Circuit(Circuit&&) noexcept = default;
+
+    /**
+     * Creates a gate of type `T`, passing `args` on to its constructor after the position.
+     */
+    template<typename T, typename... Args>
+    T& add(CircuitGate::Position pos = {}, Args&&... args) {
+        return std::get<GateArena<T>>(arenas).emplace(*graph, pos, std::forward<Args>(args)...);
+    }
+
+    [[nodiscard]]
+    CircuitGate& getGate(GateID id) const { return *graph->gates[id]; }
+
+    [[nodiscard]]
+    CircuitGate& operator[](GateID id) const { return getGate(id); }
+
+    [[nodiscard]]
+    size_t getGatesCount() const { return graph->gates.size(); }
+
+    [[nodiscard]]
+    std::span<CircuitGate *const> getGates() const { return graph->gates; }
+
+    /**
+     * Connects output `sourceOutput` of `source` to input `destInput` of `dest`.
+     */
+    void connect(GateID source, size_t sourceOutput, GateID dest, size_t destInput) {
+        getGate(dest).updateInput(source, sourceOutput, destInput);
+    }
+
+    /**
+     * A rising edge of the clock shared by all registers: every register takes the value of its
+     * input, compiling and evaluating the inputs which are not cached. All inputs are read before any state
+     * changes, so registers feeding each other shift like in hardware. A register whose input
+     * cannot be evaluated keeps its state.
+     */
+    void clock();
+
+    /**
+     * Changes every time a gate is added or an input is connected or disconnected.
+     */
+    [[nodiscard]]
+    uint64_t getRevision() const { return graph->revision; }
+
+    /**
+     * Finds everything which keeps gates from being evaluated. The result is kept until the
+     * circuit is next edited, so calling this before every evaluation costs nothing.
+     */
+    const CircuitValidation& validate() const;
+
+    /**
+     * Bytes held by the gates and their pins, including unused arena and array capacity.
+     */
+    [[nodiscard]]
+    size_t getMemoryUsage() const;
+};
+
+#endif //CIRCUIT_CIRCUIT_H
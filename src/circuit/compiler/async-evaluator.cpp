@@ -0,0 +1,84 @@
+#include "async-evaluator.h"
+
+#include <algorithm>
+#include <utility>
+
+void AsyncEvaluator::submit(CompiledCircuit&& circuit, std::function<void()> onFinished) {
+    restart();
+    instructionsCount = circuit.getInstructions().size();
+
+    worker = std::jthread([this, compiled = std::move(circuit), onFinished = std::move(onFinished)]
+                                  (const std::stop_token& stopToken) mutable {
+        evaluate(compiled, stopToken, onFinished);
+    });
+}
+
+void AsyncEvaluator::submit(CompiledCircuit::Snapshot&& snapshot, std::function<void()> onFinished) {
+    restart();
+
+    worker = std::jthread([this, snapshot = std::move(snapshot), onFinished = std::move(onFinished)]
+                                  (const std::stop_token& stopToken) mutable {
+        CompiledCircuit compiled(std::move(snapshot));
+        instructionsCount = compiled.getInstructions().size();
+        evaluate(compiled, stopToken, onFinished);
+    });
+}
+
+void AsyncEvaluator::restart() {
+    cancel();
+    // waits for the previous worker, which stops within one chunk of instructions, or once it is
+    // done compiling
+    worker = {};
+
+    executedInstructions = 0;
+    instructionsCount = 0;
+    running = true;
+}
+
+void AsyncEvaluator::evaluate(CompiledCircuit& compiled, const std::stop_token& stopToken,
+                              const std::function<void()>& onFinished) {
+    const size_t count = compiled.getInstructions().size();
+
+    for (size_t begin = 0; begin < count; begin += CHUNK_SIZE) {
+        if (stopToken.stop_requested()) {
+            running = false;
+            return;
+        }
+
+        // instructions are sorted by level, so running them in order respects every dependency
+        const size_t end = std::min(begin + CHUNK_SIZE, count);
+        compiled.runRange(begin, end);
+        executedInstructions.store(end, std::memory_order_relaxed);
+    }
+
+    {
+        std::lock_guard lock(resultMutex);
+        if (stopToken.stop_requested()) {
+            running = false;
+            return;
+        }
+        result.emplace(std::move(compiled));
+    }
+
+    running = false;
+    if (onFinished) {
+        onFinished();
+    }
+}
+
+void AsyncEvaluator::cancel() {
+    worker.request_stop();
+
+    std::lock_guard lock(resultMutex);
+    result.reset();
+}
+
+float AsyncEvaluator::getProgress() const {
+    const size_t count = instructionsCount;
+    return count == 0 ? 0.0f : static_cast<float>(executedInstructions.load(std::memory_order_relaxed)) / count;
+}
+
+std::optional<CompiledCircuit> AsyncEvaluator::takeResult() {
+    std::lock_guard lock(resultMutex);
+    return std::exchange(result, std::nullopt);
+}
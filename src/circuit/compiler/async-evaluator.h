@@ -0,0 +1,81 @@
+#ifndef CIRCUIT_ASYNC_EVALUATOR_H
+#define CIRCUIT_ASYNC_EVALUATOR_H
+
+#include "compiled-circuit.h"
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+/**
+ * Runs compiled circuits on a background thread, one at a time. A compiled circuit holds its own
+ * copy of everything it needs, so it is a snapshot which the gates can be edited independently of;
+ * nothing but the evaluator touches it until the finished evaluation is taken back with
+ * `takeResult()`, which is where its values can be stored into the gates.
+ *
+ * Compiling a large circuit takes far longer than running it, so it is best left to the worker as
+ * well: submitting a `CompiledCircuit::Snapshot` compiles it there. The gates may have been edited by
+ * the time the result is taken, which its revision tells.
+ */
+class AsyncEvaluator {
+    std::atomic<size_t> executedInstructions = 0;
+    std::atomic<size_t> instructionsCount = 0;
+    std::atomic<bool> running = false;
+
+    std::mutex resultMutex;
+    std::optional<CompiledCircuit> result;
+
+    // declared last, so that it is joined before anything it uses is destroyed
+    std::jthread worker;
+
+    // how often the worker reports progress and checks whether it was cancelled
+    constexpr static size_t CHUNK_SIZE = 16384;
+
+    void restart();
+
+    void evaluate(CompiledCircuit& compiled, const std::stop_token& stopToken, const std::function<void()>& onFinished);
+
+public:
+    AsyncEvaluator() = default;
+
+    AsyncEvaluator(const AsyncEvaluator&) = delete;
+
+    AsyncEvaluator& operator=(const AsyncEvaluator&) = delete;
+
+    /**
+     * Starts evaluating `circuit`, cancelling the evaluation in progress, if any. `onFinished` is
+     * called from the worker thread once the result is ready to be taken.
+     */
+    void submit(CompiledCircuit&& circuit, std::function<void()> onFinished = {});
+
+    /**
+     * Like the above, but compiles the snapshot on the worker thread first. A compilation in
+     * progress is not interrupted, so the next submission waits for it to finish.
+     */
+    void submit(CompiledCircuit::Snapshot&& snapshot, std::function<void()> onFinished = {});
+
+    /**
+     * Stops the evaluation in progress and discards a finished one which was not taken yet.
+     * Doesn't wait for the worker thread to stop.
+     */
+    void cancel();
+
+    [[nodiscard]]
+    bool isRunning() const { return running; }
+
+    /**
+     * Fraction of the instructions of the current evaluation executed so far, zero while it is
+     * still being compiled.
+     */
+    [[nodiscard]]
+    float getProgress() const;
+
+    /**
+     * Returns the evaluated circuit once the last submitted evaluation has finished, only once.
+     */
+    [[nodiscard]]
+    std::optional<CompiledCircuit> takeResult();
+};
+
+#endif //CIRCUIT_ASYNC_EVALUATOR_H
@@ -0,0 +1,283 @@
+#include "batch-evaluator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+constexpr static BatchEvaluator::Word ALL_LANES = ~BatchEvaluator::Word(0);
+
+// bit `k` of the lane index within a word, for the six bits that vary inside one word
+constexpr static BatchEvaluator::Word LANE_INDEX_BITS[6] = {
+        0xAAAAAAAAAAAAAAAA, 0xCCCCCCCCCCCCCCCC, 0xF0F0F0F0F0F0F0F0,
+        0xFF00FF00FF00FF00, 0xFFFF0000FFFF0000, 0xFFFFFFFF00000000,
+};
+
+BatchEvaluator::BatchEvaluator(const CompiledCircuit& _circuit, size_t _lanesCount)
+    : circuit(_circuit), lanesCount(_lanesCount), wordsCount((_lanesCount + WORD_BITS - 1) / WORD_BITS) {
+    if (lanesCount == 0) {
+        throw std::runtime_error("batch evaluation needs at least one lane");
+    }
+
+    size_t boolRowsCount = 0, intRowsCount = 0;
+    slotRows.resize(circuit.getSlotsCount());
+
+    for (CompiledCircuit::SlotIndex slot = 0; slot < circuit.getSlotsCount(); slot++) {
+        slotRows[slot] = circuit.getSlotType(slot) == CircuitGate::Bool ? boolRowsCount++ : intRowsCount++;
+    }
+
+    boolValues.resize(boolRowsCount * wordsCount);
+    intValues.resize(intRowsCount * wordsCount * WORD_BITS);
+    drivenSlots.resize(circuit.getSlotsCount());
+}
+
+void BatchEvaluator::driveBool(const CircuitGate& gate, std::span<const Word> lanes) {
+    if (lanes.size() != wordsCount) {
+        throw std::runtime_error("driven lanes do not match the batch size");
+    }
+
+    const CompiledCircuit::SlotIndex slot = getSourceSlot(gate, CircuitGate::Bool);
+    std::copy(lanes.begin(), lanes.end(), boolRow(slot));
+    drivenSlots[slot] = true;
+}
+
+void BatchEvaluator::driveInt(const CircuitGate& gate, std::span<const int32_t> lanes) {
+    if (lanes.size() != lanesCount) {
+        throw std::runtime_error("driven lanes do not match the batch size");
+    }
+
+    const CompiledCircuit::SlotIndex slot = getSourceSlot(gate, CircuitGate::Int);
+    std::copy(lanes.begin(), lanes.end(), intRow(slot));
+    drivenSlots[slot] = true;
+}
+
+void BatchEvaluator::driveBool(uint32_t gateIndex, std::span<const Word> lanes) {
+    if (lanes.size() != wordsCount) {
+        throw std::runtime_error("driven lanes do not match the batch size");
+    }
+
+    const CompiledCircuit::SlotIndex slot = getSourceSlot(gateIndex, CircuitGate::Bool);
+    std::copy(lanes.begin(), lanes.end(), boolRow(slot));
+    drivenSlots[slot] = true;
+}
+
+void BatchEvaluator::driveInt(uint32_t gateIndex, std::span<const int32_t> lanes) {
+    if (lanes.size() != lanesCount) {
+        throw std::runtime_error("driven lanes do not match the batch size");
+    }
+
+    const CompiledCircuit::SlotIndex slot = getSourceSlot(gateIndex, CircuitGate::Int);
+    std::copy(lanes.begin(), lanes.end(), intRow(slot));
+    drivenSlots[slot] = true;
+}
+
+void BatchEvaluator::driveInt(const CircuitGate& gate, int32_t value) {
+    const CompiledCircuit::SlotIndex slot = getSourceSlot(gate, CircuitGate::Int);
+    std::fill_n(intRow(slot), wordsCount * WORD_BITS, value);
+    drivenSlots[slot] = true;
+}
+
+void BatchEvaluator::driveExhaustive(const std::vector<const CircuitGate*>& inputs, uint64_t firstPattern) {
+    if (firstPattern % WORD_BITS != 0) {
+        throw std::runtime_error("exhaustive patterns must start at a multiple of 64");
+    }
+    if (inputs.size() > 64) {
+        throw std::runtime_error("exhaustive patterns cover at most 64 inputs");
+    }
+
+    for (size_t k = 0; k < inputs.size(); k++) {
+        const CompiledCircuit::SlotIndex slot = getSourceSlot(*inputs[k], CircuitGate::Bool);
+        Word *row = boolRow(slot);
+
+        for (size_t w = 0; w < wordsCount; w++) {
+            const uint64_t wordPattern = firstPattern + w * WORD_BITS;
+            if (k < 6) {
+                row[w] = LANE_INDEX_BITS[k];
+            } else {
+                row[w] = (wordPattern >> k) & 1 ? ALL_LANES : 0;
+            }
+        }
+
+        drivenSlots[slot] = true;
+    }
+}
+
+void BatchEvaluator::release(const CircuitGate& gate) {
+    const CompiledCircuit::SlotIndex slot = circuit.getSlot(gate, 0);
+    if (slot < drivenSlots.size()) {
+        drivenSlots[slot] = false;
+    }
+}
+
+void BatchEvaluator::run() {
+    const size_t n = wordsCount;
+    const size_t rowLength = wordsCount * WORD_BITS;
+
+    for (const auto &ins : circuit.getInstructions()) {
+        if (drivenSlots[ins.out]) continue;
+
+        switch (ins.op) {
+            case CompiledCircuit::ConstTrue:
+                std::fill_n(boolRow(ins.out), n, ALL_LANES);
+                break;
+            case CompiledCircuit::ConstBool:
+                std::fill_n(boolRow(ins.out), n, ins.imm ? ALL_LANES : 0);
+                break;
+            case CompiledCircuit::Not: {
+                Word *out = boolRow(ins.out);
+                const Word *a = boolRow(ins.in0);
+                for (size_t w = 0; w < n; w++) {
+                    out[w] = ~a[w];
+                }
+                break;
+            }
+            case CompiledCircuit::And: {
+                Word *out = boolRow(ins.out);
+                const Word *a = boolRow(ins.in0);
+                const Word *b = boolRow(ins.in1);
+                for (size_t w = 0; w < n; w++) {
+                    out[w] = a[w] & b[w];
+                }
+                break;
+            }
+            case CompiledCircuit::ConstInt:
+                std::fill_n(intRow(ins.out), rowLength, ins.imm);
+                break;
+            case CompiledCircuit::Add: {
+                int32_t *out = intRow(ins.out);
+                const int32_t *a = intRow(ins.in0);
+                const int32_t *b = intRow(ins.in1);
+                for (size_t i = 0; i < rowLength; i++) {
+                    out[i] = CompiledCircuit::evaluate(CompiledCircuit::Add, 0, a[i], b[i]);
+                }
+                break;
+            }
+            case CompiledCircuit::Mul: {
+                int32_t *out = intRow(ins.out);
+                const int32_t *a = intRow(ins.in0);
+                const int32_t *b = intRow(ins.in1);
+                for (size_t i = 0; i < rowLength; i++) {
+                    out[i] = CompiledCircuit::evaluate(CompiledCircuit::Mul, 0, a[i], b[i]);
+                }
+                break;
+            }
+            case CompiledCircuit::CmpLe: {
+                Word *out = boolRow(ins.out);
+                const int32_t *a = intRow(ins.in0);
+                const int32_t *b = intRow(ins.in1);
+                for (size_t w = 0; w < n; w++) {
+                    Word mask = 0;
+                    for (size_t bit = 0; bit < WORD_BITS; bit++) {
+                        const size_t lane = w * WORD_BITS + bit;
+                        mask |= Word(CompiledCircuit::evaluate(CompiledCircuit::CmpLe, 0, a[lane], b[lane])) << bit;
+                    }
+                    out[w] = mask;
+                }
+                break;
+            }
+            case CompiledCircuit::Register:
+                // every lane shares the register's state
+                if (circuit.getSlotType(ins.out) == CircuitGate::Bool) {
+                    std::fill_n(boolRow(ins.out), n, ins.imm ? ALL_LANES : 0);
+                } else {
+                    std::fill_n(intRow(ins.out), rowLength, ins.imm);
+                }
+                break;
+            case CompiledCircuit::Copy:
+                if (circuit.getSlotType(ins.out) == CircuitGate::Bool) {
+                    std::copy_n(boolRow(ins.in0), n, boolRow(ins.out));
+                } else {
+                    std::copy_n(intRow(ins.in0), rowLength, intRow(ins.out));
+                }
+                break;
+        }
+    }
+}
+
+std::span<const BatchEvaluator::Word> BatchEvaluator::getBoolLanes(const CircuitGate& gate, size_t outputIndex) const {
+    const CompiledCircuit::SlotIndex slot = getEvaluatedSlot(gate, outputIndex, CircuitGate::Bool);
+    return {boolRow(slot), wordsCount};
+}
+
+bool BatchEvaluator::getBool(const CircuitGate& gate, size_t lane, size_t outputIndex) const {
+    if (lane >= lanesCount) {
+        throw std::runtime_error("lane index out of range");
+    }
+
+    return (getBoolLanes(gate, outputIndex)[lane / WORD_BITS] >> (lane % WORD_BITS)) & 1;
+}
+
+std::span<const int32_t> BatchEvaluator::getIntLanes(const CircuitGate& gate, size_t outputIndex) const {
+    const CompiledCircuit::SlotIndex slot = getEvaluatedSlot(gate, outputIndex, CircuitGate::Int);
+    return {intRow(slot), lanesCount};
+}
+
+int32_t BatchEvaluator::getInt(const CircuitGate& gate, size_t lane, size_t outputIndex) const {
+    if (lane >= lanesCount) {
+        throw std::runtime_error("lane index out of range");
+    }
+
+    return getIntLanes(gate, outputIndex)[lane];
+}
+
+std::span<const BatchEvaluator::Word> BatchEvaluator::getBoolLanes(uint32_t gateIndex, size_t outputIndex) const {
+    const CompiledCircuit::SlotIndex slot = getEvaluatedSlot(gateIndex, outputIndex, CircuitGate::Bool);
+    return {boolRow(slot), wordsCount};
+}
+
+std::span<const int32_t> BatchEvaluator::getIntLanes(uint32_t gateIndex, size_t outputIndex) const {
+    const CompiledCircuit::SlotIndex slot = getEvaluatedSlot(gateIndex, outputIndex, CircuitGate::Int);
+    return {intRow(slot), lanesCount};
+}
+
+CompiledCircuit::SlotIndex BatchEvaluator::getSourceSlot(const CircuitGate& gate, CircuitGate::PinType type) const {
+    const std::optional<uint32_t> gateIndex = circuit.getGateIndex(gate);
+    if (!gateIndex) {
+        throw std::runtime_error("only compiled source gates can be driven");
+    }
+
+    return getSourceSlot(*gateIndex, type);
+}
+
+CompiledCircuit::SlotIndex BatchEvaluator::getEvaluatedSlot(const CircuitGate& gate, size_t outputIndex,
+                                                            CircuitGate::PinType type) const {
+    if (!circuit.isEvaluable(gate)) {
+        throw std::runtime_error("gate is not evaluated by this circuit");
+    }
+
+    const CompiledCircuit::SlotIndex slot = circuit.getSlot(gate, outputIndex);
+    if (slot == CompiledCircuit::NO_SLOT || circuit.getSlotType(slot) != type) {
+        throw std::runtime_error("requested value does not match the pin type");
+    }
+
+    return slot;
+}
+
+CompiledCircuit::SlotIndex BatchEvaluator::getSourceSlot(uint32_t gateIndex, CircuitGate::PinType type) const {
+    // the same gates which `CompiledCircuit::setConstant()` accepts
+    if (!circuit.isConstant(gateIndex)) {
+        throw std::runtime_error("only compiled source gates can be driven");
+    }
+
+    const CompiledCircuit::SlotIndex slot = circuit.getSlot(gateIndex, 0);
+    if (circuit.getSlotType(slot) != type) {
+        throw std::runtime_error("driven value does not match the gate's output type");
+    }
+
+    return slot;
+}
+
+CompiledCircuit::SlotIndex BatchEvaluator::getEvaluatedSlot(uint32_t gateIndex, size_t outputIndex,
+                                                            CircuitGate::PinType type) const {
+    if (gateIndex >= circuit.getGatesCount()) {
+        throw std::runtime_error("gate is not evaluated by this circuit");
+    }
+
+    const CompiledCircuit::SlotIndex slot = circuit.getSlot(gateIndex, outputIndex);
+    if (slot >= circuit.getProgram().evaluableSlotsCount) {
+        throw std::runtime_error("gate is not evaluated by this circuit");
+    }
+    if (circuit.getSlotType(slot) != type) {
+        throw std::runtime_error("requested value does not match the pin type");
+    }
+
+    return slot;
+}
@@ -0,0 +1,114 @@
+#ifndef CIRCUIT_BATCH_EVALUATOR_H
+#define CIRCUIT_BATCH_EVALUATOR_H
+
+#include "compiled-circuit.h"
+#include <span>
+
+/**
+ * Evaluates a compiled circuit for many independent input patterns ("lanes") in a single sweep.
+ * Every Bool net is a bit vector packed into 64-bit words, so a boolean gate handles 64 patterns
+ * per machine word. Every Int net is a column holding one value per lane (structure-of-arrays),
+ * and comparisons pack their results straight into the Bool word layout. The per-gate kernels
+ * are plain loops over whole rows and are left for the compiler to vectorize.
+ *
+ * Source gates (ConstBool and ConstInt) evaluate to their compiled value in every lane unless they
+ * have been driven with explicit per-lane values. Registers hold their current state in every lane.
+ */
+class BatchEvaluator {
+public:
+    using Word = uint64_t;
+    constexpr static size_t WORD_BITS = 64;
+
+private:
+    const CompiledCircuit &circuit;
+    size_t lanesCount, wordsCount;
+
+    std::vector<uint32_t> slotRows;
+    std::vector<Word> boolValues;
+    std::vector<int32_t> intValues;
+    std::vector<bool> drivenSlots;
+
+public:
+    BatchEvaluator(const CompiledCircuit& _circuit, size_t _lanesCount);
+
+    [[nodiscard]]
+    size_t getLanesCount() const { return lanesCount; }
+
+    [[nodiscard]]
+    size_t getWordsCount() const { return wordsCount; }
+
+    void driveBool(const CircuitGate& gate, std::span<const Word> lanes);
+
+    void driveInt(const CircuitGate& gate, std::span<const int32_t> lanes);
+
+    void driveBool(uint32_t gateIndex, std::span<const Word> lanes);
+
+    void driveInt(uint32_t gateIndex, std::span<const int32_t> lanes);
+
+    /**
+     * Drives an Int source with the same value in every lane.
+     */
+    void driveInt(const CircuitGate& gate, int32_t value);
+
+    /**
+     * Drives the given Bool sources so that lane `i` receives input pattern `firstPattern + i`,
+     * input `k` taking bit `k` of the pattern. `firstPattern` must be a multiple of 64, and there
+     * can be at most 64 inputs.
+     */
+    void driveExhaustive(const std::vector<const CircuitGate*>& inputs, uint64_t firstPattern);
+
+    /**
+     * Makes a driven source gate evaluate to its own constant value again.
+     */
+    void release(const CircuitGate& gate);
+
+    void run();
+
+    [[nodiscard]]
+    std::span<const Word> getBoolLanes(const CircuitGate& gate, size_t outputIndex = 0) const;
+
+    [[nodiscard]]
+    bool getBool(const CircuitGate& gate, size_t lane, size_t outputIndex = 0) const;
+
+    [[nodiscard]]
+    std::span<const int32_t> getIntLanes(const CircuitGate& gate, size_t outputIndex = 0) const;
+
+    [[nodiscard]]
+    int32_t getInt(const CircuitGate& gate, size_t lane, size_t outputIndex = 0) const;
+
+    [[nodiscard]]
+    std::span<const Word> getBoolLanes(uint32_t gateIndex, size_t outputIndex = 0) const;
+
+    [[nodiscard]]
+    std::span<const int32_t> getIntLanes(uint32_t gateIndex, size_t outputIndex = 0) const;
+
+private:
+    [[nodiscard]]
+    CompiledCircuit::SlotIndex getSourceSlot(const CircuitGate& gate, CircuitGate::PinType type) const;
+
+    [[nodiscard]]
+    CompiledCircuit::SlotIndex getSourceSlot(uint32_t gateIndex, CircuitGate::PinType type) const;
+
+    [[nodiscard]]
+    CompiledCircuit::SlotIndex getEvaluatedSlot(const CircuitGate& gate, size_t outputIndex,
+                                                CircuitGate::PinType type) const;
+
+    [[nodiscard]]
+    CompiledCircuit::SlotIndex getEvaluatedSlot(uint32_t gateIndex, size_t outputIndex,
+                                                CircuitGate::PinType type) const;
+
+    Word *boolRow(CompiledCircuit::SlotIndex slot) { return &boolValues[slotRows[slot] * wordsCount]; }
+
+    [[nodiscard]]
+    const Word *boolRow(CompiledCircuit::SlotIndex slot) const { return &boolValues[slotRows[slot] * wordsCount]; }
+
+    // int rows are padded to whole words so that comparisons can always pack 64 lanes at a time
+    int32_t *intRow(CompiledCircuit::SlotIndex slot) { return &intValues[slotRows[slot] * wordsCount * WORD_BITS]; }
+
+    [[nodiscard]]
+    const int32_t *intRow(CompiledCircuit::SlotIndex slot) const {
+        return &intValues[slotRows[slot] * wordsCount * WORD_BITS];
+    }
+};
+
+#endif //CIRCUIT_BATCH_EVALUATOR_H
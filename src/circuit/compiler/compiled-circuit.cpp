@@ -0,0 +1,626 @@
+#include "compiled-circuit.h"
+#include "../hierarchy/circuit-definition.h"
+#include "../visitor.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+struct CircuitVisitor_OpCode : public CircuitVisitor {
+    CompiledCircuit::Instruction instruction;
+    // what a sub-circuit instance expands to
+    const CircuitDefinition *definition = nullptr;
+
+    void visit(CircuitGate_ConstTrue& gate) override {
+        (void) gate;
+        instruction.op = CompiledCircuit::ConstTrue;
+    }
+
+    void visit(CircuitGate_ConstBool& gate) override {
+        instruction.op = CompiledCircuit::ConstBool;
+        instruction.imm = gate.value;
+    }
+
+    void visit(CircuitGate_Not& gate) override {
+        (void) gate;
+        instruction.op = CompiledCircuit::Not;
+    }
+
+    void visit(CircuitGate_And& gate) override {
+        (void) gate;
+        instruction.op = CompiledCircuit::And;
+    }
+
+    void visit(CircuitGate_Register& gate) override {
+        instruction.op = CompiledCircuit::Register;
+        instruction.imm = gate.value;
+    }
+
+    void visit(CircuitGate_ConstInt& gate) override {
+        instruction.op = CompiledCircuit::ConstInt;
+        instruction.imm = gate.value;
+    }
+
+    void visit(CircuitGate_Add& gate) override {
+        (void) gate;
+        instruction.op = CompiledCircuit::Add;
+    }
+
+    void visit(CircuitGate_Mul& gate) override {
+        (void) gate;
+        instruction.op = CompiledCircuit::Mul;
+    }
+
+    void visit(CircuitGate_CmpLe& gate) override {
+        (void) gate;
+        instruction.op = CompiledCircuit::CmpLe;
+    }
+
+    void visit(CircuitGate_IntRegister& gate) override {
+        instruction.op = CompiledCircuit::Register;
+        instruction.imm = gate.value;
+    }
+
+    void visit(CircuitGate_SubCircuit& gate) override {
+        instruction.op = CompiledCircuit::Copy;
+        definition = &gate.getDefinition();
+    }
+};
+
+static std::vector<CircuitGate::GateID> getAllGates(const Circuit& circuit) {
+    std::vector<CircuitGate::GateID> roots(circuit.getGatesCount());
+    for (CircuitGate::GateID id = 0; id < roots.size(); id++) {
+        roots[id] = id;
+    }
+
+    return roots;
+}
+
+CompiledCircuit::Snapshot::Snapshot(const Circuit& circuit, const std::vector<CircuitGate::GateID>& _roots,
+                                    bool _reuseCachedValues)
+        : roots(_roots), reuseCachedValues(_reuseCachedValues), revision(circuit.getRevision()) {
+    const CircuitValidation &validation = circuit.validate();
+    const std::span<CircuitGate *const> allGates = circuit.getGates();
+    gates.assign(allGates.begin(), allGates.end());
+    records.resize(gates.size());
+
+    // gates are stored in the order they were added and so are their pins, so copying all of them
+    // reads memory sequentially, which is much faster than walking the fan-in of the roots here
+    for (CircuitGate::GateID id = 0; id < gates.size(); id++) {
+        CircuitGate &gate = *gates[id];
+        Gate &record = records[id];
+
+        CircuitVisitor_OpCode visitor;
+        gate.acceptVisitor(visitor);
+        record.instruction = visitor.instruction;
+        record.definition = visitor.definition;
+        record.isEvaluable = validation.isEvaluable(id);
+
+        record.firstInput = sources.size();
+        record.inputsCount = gate.getInputsCount();
+        for (const auto &input : gate.getInputs()) {
+            sources.push_back({input.destGate, static_cast<uint32_t>(input.destSlotIndex)});
+        }
+
+        record.firstOutput = outputs.size();
+        record.outputsCount = gate.getOutputsCount();
+        for (size_t i = 0; i < gate.getOutputsCount(); i++) {
+            outputs.push_back(gate.getOutput(i));
+        }
+    }
+}
+
+void CompiledCircuit::Snapshot::collect() {
+    std::vector<uint32_t> ids;
+    std::vector<CircuitGate *> collectedGates;
+    std::vector<Gate> collectedRecords;
+    std::vector<Source> collectedSources;
+    std::vector<CircuitGate::OutputPin> collectedOutputs;
+    gateIndices.assign(records.size(), NO_INDEX);
+
+    auto addGate = [&](uint32_t id) {
+        uint32_t &index = gateIndices[id];
+        if (index != NO_INDEX) return;
+
+        const std::span<const CircuitGate::OutputPin> pins = getOutputs(id);
+        const bool isEvaluated = std::all_of(pins.begin(), pins.end(), [](const auto &pin) { return pin.isEval; });
+        index = ids.size();
+        ids.push_back(id);
+        cachedGates.push_back(reuseCachedValues && records[id].inputsCount > 0 && isEvaluated);
+    };
+
+    for (CircuitGate::GateID root : roots) {
+        addGate(root);
+    }
+
+    // the vector grows while we walk it, which makes this a breadth-first search over the fan-in
+    for (size_t i = 0; i < ids.size(); i++) {
+        Gate record = records[ids[i]];
+        const std::span<const CircuitGate::OutputPin> pins = getOutputs(ids[i]);
+
+        record.firstOutput = collectedOutputs.size();
+        collectedOutputs.insert(collectedOutputs.end(), pins.begin(), pins.end());
+
+        record.firstInput = collectedSources.size();
+        if (!cachedGates[i]) {
+            for (const Source &source : getSources(ids[i])) {
+                if (source.gate == CircuitGate::NO_GATE) {
+                    collectedSources.push_back({NO_INDEX, 0});
+                    continue;
+                }
+
+                addGate(source.gate);
+                collectedSources.push_back({gateIndices[source.gate], source.output});
+            }
+        }
+        record.inputsCount = collectedSources.size() - record.firstInput;
+
+        collectedGates.push_back(gates[ids[i]]);
+        collectedRecords.push_back(record);
+    }
+
+    gates = std::move(collectedGates);
+    records = std::move(collectedRecords);
+    sources = std::move(collectedSources);
+    outputs = std::move(collectedOutputs);
+}
+
+CompiledCircuit::CompiledCircuit(const Circuit& circuit, const std::vector<CircuitGate::GateID>& roots,
+                                 bool reuseCachedValues)
+        : CompiledCircuit(Snapshot(circuit, roots, reuseCachedValues)) { }
+
+CompiledCircuit::CompiledCircuit(const Circuit& circuit) : CompiledCircuit(Snapshot(circuit, getAllGates(circuit))) { }
+
+CompiledCircuit::CompiledCircuit(Snapshot&& snapshot) : revision(snapshot.revision) {
+    snapshot.collect();
+    gates = std::move(snapshot.gates);
+    gateIndices = std::move(snapshot.gateIndices);
+    cachedGates = std::move(snapshot.cachedGates);
+    emitInstructions(snapshot);
+    bindStorage();
+}
+
+void CompiledCircuit::bindStorage() {
+    program.instructions = storage.instructions;
+    program.levelOffsets = storage.levelOffsets;
+    program.slotTypes = storage.slotTypes;
+    program.gateSlotBase = storage.gateSlotBase;
+    program.gateInstructions = storage.gateInstructions;
+    values.resize(storage.slotTypes.size());
+    findRegisters();
+}
+
+CompiledCircuit::CompiledCircuit(const Program& borrowedProgram) : program(borrowedProgram) {
+    values.resize(program.slotTypes.size());
+    findRegisters();
+}
+
+void CompiledCircuit::findRegisters() {
+    registerInstructions.clear();
+    for (uint32_t i = 0; i < program.instructions.size(); i++) {
+        if (program.instructions[i].op == Register) {
+            registerInstructions.push_back(i);
+        }
+    }
+}
+
+void CompiledCircuit::emitInstructions(const Snapshot& snapshot) {
+    const size_t n = gates.size();
+    const std::vector<Snapshot::Gate> &records = snapshot.records;
+    auto &[instructions, levelOffsets, slotTypes, gateSlotBase, gateInstructions] = storage;
+
+    // fan-out lists in CSR form: consumers of gate `g` are fanout[fanoutBegin[g] .. fanoutBegin[g + 1])
+    std::vector<uint32_t> fanoutBegin(n + 1, 0);
+    std::vector<uint32_t> pendingInputs(n, 0);
+    std::vector<bool> blocked(n, false);
+    std::vector<bool> registers(n, false);
+    std::vector<const CircuitDefinition::Body *> bodies(n, nullptr);
+
+    // a register's input is only read on clock edges, so it neither blocks the register nor orders it
+    for (uint32_t g = 0; g < n; g++) {
+        if (cachedGates[g]) continue;
+
+        registers[g] = records[g].instruction.op == Register;
+        bodies[g] = records[g].definition ? &records[g].definition->getBody() : nullptr;
+    }
+
+    // what can be evaluated is decided by validation alone; cached values are known either way
+    for (uint32_t g = 0; g < n; g++) {
+        blocked[g] = !cachedGates[g] && !records[g].isEvaluable;
+    }
+
+    for (uint32_t g = 0; g < n; g++) {
+        if (cachedGates[g] || registers[g]) continue;
+
+        for (const Snapshot::Source &source : snapshot.getSources(g)) {
+            if (source.gate == NO_INDEX) continue;
+
+            fanoutBegin[source.gate + 1]++;
+            pendingInputs[g]++;
+        }
+    }
+
+    for (size_t g = 0; g < n; g++) {
+        fanoutBegin[g + 1] += fanoutBegin[g];
+    }
+
+    std::vector<uint32_t> fanout(fanoutBegin[n]);
+    std::vector<uint32_t> cursor(fanoutBegin.begin(), fanoutBegin.end() - 1);
+
+    for (uint32_t g = 0; g < n; g++) {
+        if (cachedGates[g] || registers[g]) continue;
+
+        for (const Snapshot::Source &source : snapshot.getSources(g)) {
+            if (source.gate != NO_INDEX) {
+                fanout[cursor[source.gate]++] = g;
+            }
+        }
+    }
+
+    // Kahn's algorithm. Blocked gates are never scheduled, so neither is anything downstream of
+    // them; the same holds for gates on a cycle, whose pending count never drops to zero.
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> levels(n, 0);
+    // the first level at which the outputs of a gate can be read
+    std::vector<uint32_t> readyLevels(n, 0);
+    order.reserve(n);
+
+    // Instances are levelized instruction by instruction, each one as soon as the inputs it reads
+    // are ready, so that a late input (like a rippling carry) only delays what depends on it. The
+    // levels of all parts of instance `g` start at partLevels[firstPartLevel[g]].
+    std::vector<uint32_t> partLevels;
+    std::vector<uint32_t> firstPartLevel(n, 0);
+    uint32_t maxLevel = 0;
+
+    auto levelizeInstance = [&](uint32_t g) {
+        const CircuitDefinition::Body &body = *bodies[g];
+        const size_t first = partLevels.size();
+        firstPartLevel[g] = first;
+
+        auto getReadyLevel = [&](uint32_t code) -> uint32_t {
+            if (code == NO_SLOT) return 0;
+            if (code & CircuitDefinition::Body::PORT) {
+                return readyLevels[snapshot.getSources(g)[code & ~CircuitDefinition::Body::PORT].gate];
+            }
+            return partLevels[first + code] + 1;
+        };
+
+        for (const Instruction &instruction : body.instructions) {
+            partLevels.push_back(std::max(getReadyLevel(instruction.in0), getReadyLevel(instruction.in1)));
+            maxLevel = std::max(maxLevel, partLevels.back());
+        }
+
+        // the copies of the outputs share a level, which keeps their slots next to each other; the
+        // gates reading the outputs read the instructions computing them instead, and may share it too
+        uint32_t outputLevel = 0;
+        for (uint32_t code : body.outputs) {
+            outputLevel = std::max(outputLevel, getReadyLevel(code));
+        }
+        partLevels.insert(partLevels.end(), body.outputs.size(), outputLevel);
+
+        return outputLevel;
+    };
+
+    for (uint32_t g = 0; g < n; g++) {
+        if (!blocked[g] && pendingInputs[g] == 0) {
+            order.push_back(g);
+        }
+    }
+
+    for (size_t i = 0; i < order.size(); i++) {
+        const uint32_t g = order[i];
+        const uint32_t outputLevel = bodies[g] ? levelizeInstance(g) : levels[g];
+        readyLevels[g] = bodies[g] ? outputLevel : outputLevel + 1;
+        maxLevel = std::max(maxLevel, outputLevel);
+
+        for (uint32_t f = fanoutBegin[g]; f < fanoutBegin[g + 1]; f++) {
+            const uint32_t consumer = fanout[f];
+            levels[consumer] = std::max(levels[consumer], readyLevels[g]);
+
+            if (--pendingInputs[consumer] == 0 && !blocked[consumer]) {
+                order.push_back(consumer);
+            }
+        }
+    }
+
+    // Every scheduled gate becomes a few consecutive "parts", each one instruction: an instance its
+    // body followed by the copies of its outputs, a cached gate one constant per output, and any
+    // other gate just itself.
+    auto getPartsCount = [&](uint32_t g) -> uint32_t {
+        if (bodies[g]) return bodies[g]->instructions.size() + records[g].outputsCount;
+        return cachedGates[g] ? records[g].outputsCount : 1;
+    };
+
+    auto getPartLevel = [&](uint32_t g, uint32_t part) {
+        return bodies[g] ? partLevels[firstPartLevel[g] + part] : levels[g];
+    };
+
+    std::vector<uint32_t> firstPart(n, 0);
+    uint32_t partsCount = 0;
+    for (uint32_t g : order) {
+        if (!bodies[g] && !cachedGates[g] && records[g].outputsCount != 1) {
+            throw std::runtime_error("only single-output gates can be compiled");
+        }
+
+        firstPart[g] = partsCount;
+        partsCount += getPartsCount(g);
+    }
+
+    // counting sort by level, which keeps the copies of an instance's outputs together
+    const size_t levelsCount = order.empty() ? 0 : maxLevel + 1;
+    levelOffsets.assign(levelsCount + 1, 0);
+    for (uint32_t g : order) {
+        for (uint32_t part = 0; part < getPartsCount(g); part++) {
+            levelOffsets[getPartLevel(g, part) + 1]++;
+        }
+    }
+
+    for (size_t l = 0; l < levelsCount; l++) {
+        levelOffsets[l + 1] += levelOffsets[l];
+    }
+
+    // position of every part in the schedule, and the other way round
+    std::vector<uint32_t> positions(partsCount);
+    std::vector<std::pair<uint32_t, uint32_t>> sorted(partsCount);
+    cursor.assign(levelOffsets.begin(), levelOffsets.end() - 1);
+    for (uint32_t g : order) {
+        for (uint32_t part = 0; part < getPartsCount(g); part++) {
+            const uint32_t position = cursor[getPartLevel(g, part)]++;
+            positions[firstPart[g] + part] = position;
+            sorted[position] = {g, part};
+        }
+    }
+
+    // slots are handed out in execution order so that the sweep writes memory sequentially;
+    // gates which did not make it into the schedule get theirs at the very end
+    gateSlotBase.assign(n, NO_SLOT);
+    slotTypes.resize(partsCount);
+
+    for (uint32_t position = 0; position < partsCount; position++) {
+        const auto [g, part] = sorted[position];
+        const uint32_t bodySize = bodies[g] ? bodies[g]->instructions.size() : 0;
+
+        if (part < bodySize) {
+            slotTypes[position] = bodies[g]->types[part];
+            continue;
+        }
+
+        if (part == bodySize) {
+            gateSlotBase[g] = position;
+        }
+        slotTypes[position] = snapshot.getOutputs(g)[part - bodySize].type;
+    }
+
+    program.evaluableSlotsCount = slotTypes.size();
+
+    for (uint32_t g = 0; g < n; g++) {
+        if (gateSlotBase[g] != NO_SLOT) continue;
+
+        gateSlotBase[g] = slotTypes.size();
+        for (const CircuitGate::OutputPin &output : snapshot.getOutputs(g)) {
+            slotTypes.push_back(output.type);
+        }
+    }
+
+    // where output `o` of gate `g` is computed, which for a scheduled instance is not its copy but
+    // the instruction the copy reads
+    auto getOutputSlot = [&](uint32_t g, size_t o) {
+        while (bodies[g] && gateSlotBase[g] < program.evaluableSlotsCount) {
+            const uint32_t code = bodies[g]->outputs[o];
+            if (!(code & CircuitDefinition::Body::PORT)) {
+                return positions[firstPart[g] + code];
+            }
+
+            const Snapshot::Source &source = snapshot.getSources(g)[code & ~CircuitDefinition::Body::PORT];
+            g = source.gate;
+            o = source.output;
+        }
+
+        return gateSlotBase[g] + static_cast<SlotIndex>(o);
+    };
+
+    instructions.reserve(partsCount);
+    instructionGates.reserve(partsCount);
+    gateInstructions.assign(n, NO_INSTRUCTION);
+
+    for (const auto &[g, part] : sorted) {
+        const std::span<const Snapshot::Source> sources = snapshot.getSources(g);
+        const SlotIndex out = instructions.size();
+
+        auto inputSlot = [&](size_t index) {
+            return getOutputSlot(sources[index].gate, sources[index].output);
+        };
+
+        if (cachedGates[g]) {
+            const CircuitGate::OutputPin &pin = snapshot.getOutputs(g)[part];
+            Instruction instruction;
+            instruction.op = pin.type == CircuitGate::Bool ? ConstBool : ConstInt;
+            instruction.out = out;
+            instruction.imm = pin.value;
+
+            if (part == 0) {
+                gateInstructions[g] = out;
+            }
+            instructions.push_back(instruction);
+            instructionGates.push_back(g);
+            continue;
+        }
+
+        if (bodies[g]) {
+            const CircuitDefinition::Body &body = *bodies[g];
+            auto operand = [&](uint32_t code) {
+                if (code == NO_SLOT) return NO_SLOT;
+                if (code & CircuitDefinition::Body::PORT) return inputSlot(code & ~CircuitDefinition::Body::PORT);
+                return positions[firstPart[g] + code];
+            };
+
+            Instruction instruction;
+            if (part < body.instructions.size()) {
+                instruction = body.instructions[part];
+                instruction.in0 = operand(instruction.in0);
+                instruction.in1 = operand(instruction.in1);
+                instructionGates.push_back(NO_INDEX);
+            } else {
+                instruction.op = Copy;
+                instruction.in0 = operand(body.outputs[part - body.instructions.size()]);
+                if (part == body.instructions.size()) {
+                    gateInstructions[g] = out;
+                }
+                instructionGates.push_back(g);
+            }
+
+            instruction.out = out;
+            instructions.push_back(instruction);
+            continue;
+        }
+
+        Instruction instruction = records[g].instruction;
+        instruction.out = out;
+
+        if (registers[g]) {
+            const bool hasInput = sources[0].gate != NO_INDEX;
+            if (hasInput && inputSlot(0) < program.evaluableSlotsCount) {
+                instruction.in0 = inputSlot(0);
+            }
+        } else if (!sources.empty()) {
+            instruction.in0 = inputSlot(0);
+        }
+        if (sources.size() > 1) {
+            instruction.in1 = inputSlot(1);
+        }
+
+        gateInstructions[g] = out;
+        instructions.push_back(instruction);
+        instructionGates.push_back(g);
+    }
+}
+
+void CompiledCircuit::run() {
+    runRange(0, program.instructions.size());
+}
+
+void CompiledCircuit::runRange(size_t begin, size_t end) {
+    int32_t *v = values.data();
+
+    for (size_t i = begin; i < end; i++) {
+        const Instruction &ins = program.instructions[i];
+        v[ins.out] = evaluate(ins, v);
+    }
+}
+
+void CompiledCircuit::clock() {
+    // every input is read before any state changes, as all of them come from `values`
+    for (uint32_t i : registerInstructions) {
+        Instruction &instruction = program.instructions[i];
+        if (instruction.in0 != NO_SLOT) {
+            instruction.imm = values[instruction.in0];
+        }
+    }
+}
+
+void CompiledCircuit::updateConstants() {
+    for (size_t i = 0; i < instructionGates.size(); i++) {
+        Instruction &instruction = program.instructions[i];
+        if (instruction.op != ConstInt && instruction.op != ConstBool) continue;
+        // constants made up by the optimizer have no gate of their own
+        if (instructionGates[i] == NO_INDEX || cachedGates[instructionGates[i]]) continue;
+
+        CircuitVisitor_OpCode visitor;
+        gates[instructionGates[i]]->acceptVisitor(visitor);
+        instruction.imm = visitor.instruction.imm;
+    }
+}
+
+void CompiledCircuit::setConstant(const CircuitGate& gate, int32_t value) {
+    const std::optional<uint32_t> gateIndex = getGateIndex(gate);
+    if (!gateIndex) {
+        throw std::runtime_error("gate is not a compiled constant");
+    }
+
+    setConstant(*gateIndex, value);
+}
+
+void CompiledCircuit::setConstant(uint32_t gateIndex, int32_t value) {
+    if (!isConstant(gateIndex)) {
+        throw std::runtime_error("gate is not a compiled constant");
+    }
+
+    Instruction &instruction = program.instructions[program.gateInstructions[gateIndex]];
+    instruction.imm = instruction.op == ConstBool ? value != 0 : value;
+}
+
+bool CompiledCircuit::isConstant(uint32_t gateIndex) const {
+    const bool isCached = gateIndex < cachedGates.size() && cachedGates[gateIndex];
+    if (gateIndex >= getGatesCount() || program.gateInstructions[gateIndex] == NO_INSTRUCTION || isCached) {
+        return false;
+    }
+
+    const OpCode op = program.instructions[program.gateInstructions[gateIndex]].op;
+    return op == ConstInt || op == ConstBool;
+}
+
+void CompiledCircuit::storeResults() const {
+    for (uint32_t g = 0; g < gates.size(); g++) {
+        if (program.gateSlotBase[g] >= program.evaluableSlotsCount) continue;
+
+        CircuitGate &gate = *gates[g];
+
+        for (size_t i = 0; i < gate.outputsCount; i++) {
+            gate.storeOutput(i, values[program.gateSlotBase[g] + i]);
+        }
+    }
+}
+
+std::optional<std::variant<int, bool>> CompiledCircuit::getValue(const CircuitGate& gate, size_t outputIndex) const {
+    return getSlotValue(getSlot(gate, outputIndex));
+}
+
+std::optional<std::variant<int, bool>> CompiledCircuit::getSlotValue(SlotIndex slot) const {
+    if (slot >= program.evaluableSlotsCount) return std::nullopt;
+
+    if (program.slotTypes[slot] == CircuitGate::Bool) {
+        return values[slot] != 0;
+    }
+    return values[slot];
+}
+
+CompiledCircuit::SlotIndex CompiledCircuit::getSlot(const CircuitGate& gate, size_t outputIndex) const {
+    const std::optional<uint32_t> gateIndex = getGateIndex(gate);
+    if (!gateIndex || outputIndex >= gate.getOutputsCount()) return NO_SLOT;
+
+    return getSlot(*gateIndex, outputIndex);
+}
+
+CompiledCircuit::SlotIndex CompiledCircuit::getSlot(uint32_t gateIndex, size_t outputIndex) const {
+    if (gateIndex >= program.gateSlotBase.size()) {
+        throw std::runtime_error("gate " + std::to_string(gateIndex) + " is not compiled");
+    }
+    if (outputIndex >= getOutputsCount(gateIndex)) {
+        throw std::runtime_error("gate " + std::to_string(gateIndex) + " has no output " + std::to_string(outputIndex));
+    }
+
+    return program.gateSlotBase[gateIndex] + static_cast<SlotIndex>(outputIndex);
+}
+
+std::optional<uint32_t> CompiledCircuit::getGateIndex(const CircuitGate& gate) const {
+    if (gate.getId() >= gateIndices.size()) return std::nullopt;
+
+    const uint32_t index = gateIndices[gate.getId()];
+    if (index == NO_INDEX || gates[index] != &gate) return std::nullopt;
+
+    return index;
+}
+
+bool CompiledCircuit::isEvaluable(const CircuitGate& gate) const {
+    return gate.getOutputsCount() > 0 && getSlot(gate, 0) < program.evaluableSlotsCount;
+}
+
+std::vector<CircuitGate::GateID> CompiledCircuit::getBlockedGates() const {
+    std::vector<CircuitGate::GateID> blocked;
+    for (uint32_t g = 0; g < gates.size(); g++) {
+        if (program.gateSlotBase[g] >= program.evaluableSlotsCount) {
+            blocked.push_back(gates[g]->getId());
+        }
+    }
+
+    return blocked;
+}
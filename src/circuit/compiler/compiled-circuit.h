@@ -0,0 +1,352 @@
+#ifndef CIRCUIT_COMPILED_CIRCUIT_H
+#define CIRCUIT_COMPILED_CIRCUIT_H
+
+#include "../circuit.h"
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <variant>
+#include <vector>
+
+class CircuitDefinition;
+
+/**
+ * Flat, levelized form of a gate graph. Every output pin is assigned a value slot and every
+ * evaluable gate becomes one instruction reading and writing slots by index. Instructions are
+ * sorted by level (longest path from a source), so one linear sweep evaluates the whole circuit.
+ *
+ * Gates which cannot be evaluated (an unconnected or mistyped input somewhere in their fan-in, or
+ * a combinational cycle, as found by `Circuit::validate()`) are not emitted; their slots simply
+ * never hold a value.
+ *
+ * When compiling with `reuseCachedValues`, the fan-in walk stops at gates whose output pins are
+ * already evaluated and those gates are emitted as constants holding the cached values, so only
+ * the invalidated part of the graph is recomputed.
+ *
+ * The compiled program itself is a handful of flat arrays (`Program`). A circuit can also be built
+ * around arrays it does not own, e.g. ones mapped straight from a binary netlist file, in which case
+ * there are no gate objects behind it and it is addressed by gate index instead.
+ *
+ * Registers are sources of the sweep, like constants: their instruction writes the stored state,
+ * kept in its immediate, and reads its input slot only when `clock()` latches it. Their inputs do not
+ * count towards levels, so feedback through registers is not a cycle.
+ *
+ * A sub-circuit instance is replaced by the compiled body of its definition, whose instructions
+ * belong to no gate and are levelized one by one, like the gates they came from. One Copy
+ * instruction per output then gives the instance consecutive output slots, while the gates reading
+ * the outputs read the instructions computing them, leaving the copies off every path.
+ *
+ * `CircuitOptimizer` can rewrite the program afterwards, in which case several gates may share
+ * one slot and instructions no longer correspond to gates one to one.
+ */
+class CompiledCircuit {
+public:
+    using SlotIndex = uint32_t;
+    constexpr static SlotIndex NO_SLOT = UINT32_MAX;
+    constexpr static uint32_t NO_INSTRUCTION = UINT32_MAX;
+    constexpr static uint32_t NO_INDEX = UINT32_MAX;
+
+    enum OpCode : uint8_t { ConstTrue, ConstBool, Not, And, ConstInt, Add, Mul, CmpLe, Register, Copy };
+
+    struct Instruction {
+        OpCode op;
+        SlotIndex in0 = NO_SLOT, in1 = NO_SLOT;
+        SlotIndex out = NO_SLOT;
+        int32_t imm = 0;
+    };
+
+    struct Program {
+        std::span<Instruction> instructions;
+        std::span<const uint64_t> levelOffsets;
+        std::span<const CircuitGate::PinType> slotTypes;
+        std::span<const SlotIndex> gateSlotBase;
+        std::span<const uint32_t> gateInstructions;
+        SlotIndex evaluableSlotsCount = 0;
+    };
+
+    /**
+     * What compilation reads from the gates, copied out of the circuit in one sequential pass over
+     * all of them. Compiling a snapshot does not touch the circuit, so it may be done on another
+     * thread while the circuit is being edited, and `getRevision()` tells afterwards whether the
+     * result still describes the circuit.
+     */
+    class Snapshot {
+        struct Gate {
+            // the opcode and immediate of the gate
+            Instruction instruction;
+            const CircuitDefinition *definition = nullptr;
+            uint32_t firstInput = 0, inputsCount = 0;
+            uint32_t firstOutput = 0, outputsCount = 0;
+            bool isEvaluable = false;
+        };
+
+        // where an input reads from: a GateID until `collect()`, a gate index after it
+        struct Source {
+            uint32_t gate;
+            uint32_t output;
+        };
+
+        std::vector<CircuitGate::GateID> roots;
+        bool reuseCachedValues;
+        uint64_t revision;
+
+        std::vector<CircuitGate *> gates;
+        std::vector<Gate> records;
+        std::vector<Source> sources;
+        std::vector<CircuitGate::OutputPin> outputs;
+        // filled in by `collect()`
+        std::vector<uint32_t> gateIndices;
+        std::vector<bool> cachedGates;
+
+        /**
+         * Narrows the snapshot down to the roots and their fan-in, indexed like the compiled gates.
+         */
+        void collect();
+
+        [[nodiscard]]
+        std::span<const Source> getSources(uint32_t g) const {
+            return {sources.data() + records[g].firstInput, records[g].inputsCount};
+        }
+
+        [[nodiscard]]
+        std::span<const CircuitGate::OutputPin> getOutputs(uint32_t g) const {
+            return {outputs.data() + records[g].firstOutput, records[g].outputsCount};
+        }
+
+        friend class CompiledCircuit;
+
+    public:
+        /**
+         * See the constructor of CompiledCircuit taking the same arguments.
+         */
+        Snapshot(const Circuit& circuit, const std::vector<CircuitGate::GateID>& roots, bool reuseCachedValues = false);
+
+        [[nodiscard]]
+        uint64_t getRevision() const { return revision; }
+    };
+
+private:
+    std::vector<CircuitGate *> gates;
+    // index of every compiled gate by GateID, NO_INDEX for gates of the circuit which were not compiled
+    std::vector<uint32_t> gateIndices;
+    std::vector<uint32_t> instructionGates;
+    std::vector<bool> cachedGates;
+    std::vector<uint32_t> registerInstructions;
+
+    struct {
+        std::vector<Instruction> instructions;
+        std::vector<uint64_t> levelOffsets;
+        std::vector<CircuitGate::PinType> slotTypes;
+        std::vector<SlotIndex> gateSlotBase;
+        std::vector<uint32_t> gateInstructions;
+    } storage;
+
+    Program program;
+
+    std::vector<int32_t> values;
+
+    uint64_t revision = 0;
+
+    friend class CircuitOptimizer;
+    friend class NativeEvaluator;
+    friend class EventSimulator;
+    friend class TraceRecorder;
+
+public:
+    /**
+     * Compiles every gate in `roots` together with its transitive fan-in. Gates are indexed in
+     * the order they are found, starting with the roots.
+     */
+    CompiledCircuit(const Circuit& circuit, const std::vector<CircuitGate::GateID>& roots, bool reuseCachedValues = false);
+
+    /**
+     * Compiles the whole circuit. Gate indices are the same as the gates' IDs.
+     */
+    explicit CompiledCircuit(const Circuit& circuit);
+
+    /**
+     * Compiles a snapshot taken earlier, without looking at the circuit it was taken of.
+     */
+    explicit CompiledCircuit(Snapshot&& snapshot);
+
+    /**
+     * Wraps an already compiled program without copying it. The arrays must outlive the circuit.
+     */
+    explicit CompiledCircuit(const Program& borrowedProgram);
+
+    CompiledCircuit(const CompiledCircuit&) = delete;
+
+    CompiledCircuit(CompiledCircuit&&) = default;
+
+    /**
+     * What `op` computes from the values `a` and `b` of its operands, or from its immediate. Every
+     * scalar evaluation of the opcodes goes through this, so that they all agree on the details:
+     * integers wrap around on overflow and Bool results are always 0 or 1.
+     */
+    [[nodiscard]]
+    static int32_t evaluate(OpCode op, int32_t imm, int32_t a, int32_t b) {
+        switch (op) {
+            case ConstTrue:
+                return 1;
+            case ConstBool:
+            case ConstInt:
+            case Register:
+                return imm;
+            case Not:
+                return !a;
+            case And:
+                return a & b;
+            case Add:
+                return static_cast<int32_t>(static_cast<uint32_t>(a) + static_cast<uint32_t>(b));
+            case Mul:
+                return static_cast<int32_t>(static_cast<uint32_t>(a) * static_cast<uint32_t>(b));
+            case CmpLe:
+                return a <= b;
+            case Copy:
+                return a;
+        }
+
+        return 0;
+    }
+
+    /**
+     * Evaluates one instruction, reading only the operands its opcode uses from `values`.
+     */
+    [[nodiscard]]
+    static int32_t evaluate(const Instruction& instruction, const int32_t *values) {
+        switch (instruction.op) {
+            case Not:
+            case Copy:
+                return evaluate(instruction.op, instruction.imm, values[instruction.in0], 0);
+            case And:
+            case Add:
+            case Mul:
+            case CmpLe:
+                return evaluate(instruction.op, instruction.imm, values[instruction.in0], values[instruction.in1]);
+            default:
+                return evaluate(instruction.op, instruction.imm, 0, 0);
+        }
+    }
+
+    void run();
+
+    /**
+     * Executes instructions `[begin, end)` only. Instructions within one level never depend on each
+     * other, so disjoint ranges of the same level may be run concurrently.
+     */
+    void runRange(size_t begin, size_t end);
+
+    /**
+     * A clock edge: every register stores the value its input had in the last run, and the next
+     * run starts from there. Registers with nothing evaluable at their input keep their state.
+     */
+    void clock();
+
+    /**
+     * Re-reads the values of all constant gates, so that edits made after compilation are
+     * picked up by the next `run()` without recompiling.
+     */
+    void updateConstants();
+
+    /**
+     * Overrides the value of a compiled ConstInt or ConstBool gate for subsequent runs, without
+     * touching the gate itself.
+     */
+    void setConstant(const CircuitGate& gate, int32_t value);
+
+    void setConstant(uint32_t gateIndex, int32_t value);
+
+    /**
+     * Whether the gate is compiled to a ConstInt or ConstBool instruction of its own, which
+     * `setConstant()` can override. Cached gates and ConstTrue are not.
+     */
+    [[nodiscard]]
+    bool isConstant(uint32_t gateIndex) const;
+
+    /**
+     * Copies every computed value back into the output pins of the compiled gates.
+     */
+    void storeResults() const;
+
+    [[nodiscard]]
+    std::optional<std::variant<int, bool>> getValue(const CircuitGate& gate, size_t outputIndex) const;
+
+    [[nodiscard]]
+    std::optional<std::variant<int, bool>> getSlotValue(SlotIndex slot) const;
+
+    [[nodiscard]]
+    SlotIndex getSlot(const CircuitGate& gate, size_t outputIndex) const;
+
+    /**
+     * Throws for gates which were not compiled and outputs the gate does not have.
+     */
+    [[nodiscard]]
+    SlotIndex getSlot(uint32_t gateIndex, size_t outputIndex) const;
+
+    [[nodiscard]]
+    std::optional<uint32_t> getGateIndex(const CircuitGate& gate) const;
+
+    [[nodiscard]]
+    bool isEvaluable(const CircuitGate& gate) const;
+
+    [[nodiscard]]
+    std::vector<CircuitGate::GateID> getBlockedGates() const;
+
+    [[nodiscard]]
+    const std::vector<CircuitGate *>& getGates() const { return gates; }
+
+    [[nodiscard]]
+    const Program& getProgram() const { return program; }
+
+    [[nodiscard]]
+    std::span<const Instruction> getInstructions() const { return program.instructions; }
+
+    [[nodiscard]]
+    size_t getLevelsCount() const { return program.levelOffsets.size() - 1; }
+
+    /**
+     * Instructions of level `l` are `[offsets[l], offsets[l + 1])`.
+     */
+    [[nodiscard]]
+    std::span<const uint64_t> getLevelOffsets() const { return program.levelOffsets; }
+
+    [[nodiscard]]
+    size_t getGatesCount() const { return program.gateSlotBase.size(); }
+
+    /**
+     * A circuit built around a borrowed program, like one loaded from a binary netlist, has no gates
+     * behind it, and all of its gates have a single output.
+     */
+    [[nodiscard]]
+    size_t getOutputsCount(uint32_t gateIndex) const {
+        return gates.empty() ? 1 : gates[gateIndex]->getOutputsCount();
+    }
+
+    [[nodiscard]]
+    size_t getSlotsCount() const { return program.slotTypes.size(); }
+
+    [[nodiscard]]
+    CircuitGate::PinType getSlotType(SlotIndex slot) const { return program.slotTypes[slot]; }
+
+    [[nodiscard]]
+    const std::vector<uint32_t>& getRegisterInstructions() const { return registerInstructions; }
+
+    /**
+     * The revision of the circuit when it was compiled, see `Circuit::getRevision()`.
+     */
+    [[nodiscard]]
+    uint64_t getRevision() const { return revision; }
+
+private:
+    void bindStorage();
+
+    void findRegisters();
+
+    /**
+     * Gates validation did not find evaluable when the snapshot was taken are left out, together with
+     * everything reading them.
+     */
+    void emitInstructions(const Snapshot& snapshot);
+};
+
+#endif //CIRCUIT_COMPILED_CIRCUIT_H
@@ -0,0 +1,165 @@
+#include "cone-evaluator.h"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+using Instruction = CompiledCircuit::Instruction;
+
+ConeEvaluator::ConeEvaluator(CompiledCircuit& _circuit) : circuit(_circuit) {
+    const std::span<const Instruction> instructions = circuit.getInstructions();
+    const size_t slotsCount = circuit.getSlotsCount();
+
+    slotInstructions.assign(slotsCount, CompiledCircuit::NO_INSTRUCTION);
+    readersBegin.assign(slotsCount + 1, 0);
+
+    // registers read their input on clock edges only, which `clock()` takes care of
+    auto forEachRead = [&](auto &&callback) {
+        for (uint32_t i = 0; i < instructions.size(); i++) {
+            const Instruction &ins = instructions[i];
+            if (ins.op == CompiledCircuit::Register) continue;
+
+            if (ins.in0 != CompiledCircuit::NO_SLOT) callback(ins.in0, i);
+            if (ins.in1 != CompiledCircuit::NO_SLOT && ins.in1 != ins.in0) callback(ins.in1, i);
+        }
+    };
+
+    for (uint32_t i = 0; i < instructions.size(); i++) {
+        slotInstructions[instructions[i].out] = i;
+    }
+
+    forEachRead([&](CompiledCircuit::SlotIndex slot, uint32_t) { readersBegin[slot + 1]++; });
+    for (size_t s = 0; s < slotsCount; s++) {
+        readersBegin[s + 1] += readersBegin[s];
+    }
+
+    readers.resize(readersBegin[slotsCount]);
+    std::vector<uint32_t> cursor(readersBegin.begin(), readersBegin.end() - 1);
+    forEachRead([&](CompiledCircuit::SlotIndex slot, uint32_t i) { readers[cursor[slot]++] = i; });
+
+    cached.assign(slotsCount, false);
+    cone.assign((instructions.size() + 63) / 64, 0);
+}
+
+size_t ConeEvaluator::evaluate(std::span<const CompiledCircuit::SlotIndex> slots) {
+    const std::span<const Instruction> instructions = circuit.getInstructions();
+    const CompiledCircuit::SlotIndex evaluableSlotsCount = circuit.getProgram().evaluableSlotsCount;
+
+    // slots are marked as soon as they are found, their values are in place before returning
+    auto request = [&](CompiledCircuit::SlotIndex slot) {
+        if (slot >= evaluableSlotsCount || cached[slot]) return;
+        cached[slot] = true;
+        pending.push_back(slot);
+    };
+
+    for (CompiledCircuit::SlotIndex slot : slots) {
+        request(slot);
+    }
+
+    size_t count = 0;
+    uint32_t first = UINT32_MAX, last = 0;
+    while (!pending.empty()) {
+        const uint32_t i = slotInstructions[pending.back()];
+        pending.pop_back();
+
+        cone[i / 64] |= uint64_t(1) << (i % 64);
+        first = std::min(first, i);
+        last = std::max(last, i);
+        count++;
+
+        const Instruction &ins = instructions[i];
+        if (ins.op == CompiledCircuit::Register) continue;
+
+        if (ins.in0 != CompiledCircuit::NO_SLOT) request(ins.in0);
+        if (ins.in1 != CompiledCircuit::NO_SLOT) request(ins.in1);
+    }
+
+    if (count == 0) return 0;
+
+    // instruction order is a topological order, and consecutive instructions run as one range
+    for (size_t w = first / 64; w <= last / 64; w++) {
+        while (const uint64_t bits = cone[w]) {
+            const int begin = std::countr_zero(bits);
+            const int end = begin + std::countr_one(bits >> begin);
+
+            circuit.runRange(w * 64 + begin, w * 64 + end);
+            cone[w] = end == 64 ? 0 : bits & (~uint64_t(0) << end);
+        }
+    }
+
+    evaluationsCount += count;
+    return count;
+}
+
+std::optional<std::variant<int, bool>> ConeEvaluator::getValue(uint32_t gateIndex, size_t outputIndex) {
+    if (gateIndex >= circuit.getGatesCount()) {
+        throw std::runtime_error("gate is not compiled");
+    }
+
+    const CompiledCircuit::SlotIndex slot = circuit.getSlot(gateIndex, outputIndex);
+    evaluate({&slot, 1});
+    return circuit.getSlotValue(slot);
+}
+
+void ConeEvaluator::setConstant(uint32_t gateIndex, int32_t value) {
+    const CompiledCircuit::Program &program = circuit.getProgram();
+    if (gateIndex >= circuit.getGatesCount() || program.gateInstructions[gateIndex] == CompiledCircuit::NO_INSTRUCTION) {
+        throw std::runtime_error("gate is not a compiled constant");
+    }
+
+    // setting the value a constant already has changes nothing
+    const Instruction &ins = program.instructions[program.gateInstructions[gateIndex]];
+    const int32_t previous = ins.imm;
+    circuit.setConstant(gateIndex, value);
+
+    if (ins.imm != previous) {
+        invalidateFanout(ins.out);
+    }
+}
+
+void ConeEvaluator::clock() {
+    const std::span<const Instruction> instructions = circuit.getInstructions();
+
+    std::vector<CompiledCircuit::SlotIndex> inputs;
+    std::vector<int32_t> states;
+    for (uint32_t i : circuit.getRegisterInstructions()) {
+        if (instructions[i].in0 != CompiledCircuit::NO_SLOT) inputs.push_back(instructions[i].in0);
+        states.push_back(instructions[i].imm);
+    }
+
+    evaluate(inputs);
+    circuit.clock();
+
+    for (size_t r = 0; r < states.size(); r++) {
+        const Instruction &ins = instructions[circuit.getRegisterInstructions()[r]];
+        if (ins.imm != states[r]) {
+            invalidateFanout(ins.out);
+        }
+    }
+}
+
+void ConeEvaluator::invalidate() {
+    std::fill(cached.begin(), cached.end(), false);
+}
+
+void ConeEvaluator::invalidateFanout(CompiledCircuit::SlotIndex slot) {
+    const std::span<const Instruction> instructions = circuit.getInstructions();
+
+    // nothing reading a slot which is not cached can be cached itself
+    if (slot >= cached.size() || !cached[slot]) return;
+    cached[slot] = false;
+    pending.push_back(slot);
+
+    while (!pending.empty()) {
+        const CompiledCircuit::SlotIndex changed = pending.back();
+        pending.pop_back();
+
+        for (uint32_t r = readersBegin[changed]; r < readersBegin[changed + 1]; r++) {
+            const CompiledCircuit::SlotIndex out = instructions[readers[r]].out;
+            if (cached[out]) {
+                cached[out] = false;
+                pending.push_back(out);
+            }
+        }
+    }
+}
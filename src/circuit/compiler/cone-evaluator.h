@@ -0,0 +1,82 @@
+#ifndef CIRCUIT_CONE_EVALUATOR_H
+#define CIRCUIT_CONE_EVALUATOR_H
+
+#include "compiled-circuit.h"
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <variant>
+#include <vector>
+
+/**
+ * Evaluates a compiled circuit on demand, one requested net at a time. Only the instructions in the
+ * fan-in cone of the requested slots run, and every slot they compute stays cached until something
+ * in its own fan-in changes, so overlapping cones are computed once and probing a few nets of a large
+ * circuit costs as much as those nets' cones.
+ *
+ * Values live in the compiled circuit, where they can be read as usual once requested. While the
+ * evaluator exists, constants must be changed and registers clocked through it, which invalidates
+ * the cached slots depending on them.
+ */
+class ConeEvaluator {
+    CompiledCircuit &circuit;
+
+    std::vector<uint32_t> slotInstructions;
+    // instructions reading every slot during a run, in CSR form
+    std::vector<uint32_t> readersBegin, readers;
+
+    // a slot is only ever cached together with its whole fan-in
+    std::vector<bool> cached;
+    std::vector<uint32_t> pending;
+    // instructions still to run, one bit each
+    std::vector<uint64_t> cone;
+
+    uint64_t evaluationsCount = 0;
+
+public:
+    /**
+     * Nothing is evaluated until it is requested.
+     */
+    explicit ConeEvaluator(CompiledCircuit& _circuit);
+
+    /**
+     * Computes the given slots and everything they depend on which is not cached yet. Returns how
+     * many instructions that took. Slots which cannot be evaluated are skipped.
+     */
+    size_t evaluate(std::span<const CompiledCircuit::SlotIndex> slots);
+
+    /**
+     * Evaluates one output of a gate and returns its value, nothing if it cannot be evaluated.
+     */
+    std::optional<std::variant<int, bool>> getValue(uint32_t gateIndex, size_t outputIndex = 0);
+
+    /**
+     * Changes the value of a compiled ConstInt or ConstBool gate, invalidating its fan-out.
+     */
+    void setConstant(uint32_t gateIndex, int32_t value);
+
+    /**
+     * A clock edge: evaluates the inputs of all registers, latches them and invalidates the fan-out
+     * of every register whose state changed.
+     */
+    void clock();
+
+    /**
+     * Forgets every cached value.
+     */
+    void invalidate();
+
+    [[nodiscard]]
+    bool isCached(CompiledCircuit::SlotIndex slot) const { return slot < cached.size() && cached[slot]; }
+
+    /**
+     * Instructions run so far, the measure of how much work the requests took.
+     */
+    [[nodiscard]]
+    uint64_t getEvaluationsCount() const { return evaluationsCount; }
+
+private:
+    void invalidateFanout(CompiledCircuit::SlotIndex slot);
+};
+
+#endif //CIRCUIT_CONE_EVALUATOR_H
@@ -0,0 +1,279 @@
+#include "equivalence-checker.h"
+
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+
+using Word = BatchEvaluator::Word;
+constexpr static size_t WORD_BITS = BatchEvaluator::WORD_BITS;
+
+// integers random vectors pick every now and then, where comparisons and overflow tend to go wrong
+constexpr static int32_t INTERESTING_INTS[] = {
+        0, 1, -1, 2, -2, std::numeric_limits<int32_t>::max(), std::numeric_limits<int32_t>::min(),
+        std::numeric_limits<int32_t>::max() - 1, std::numeric_limits<int32_t>::min() + 1,
+};
+
+static CircuitGate::PinType getNetType(const CompiledCircuit& circuit, const EquivalenceChecker::Net& net) {
+    if (net.gateIndex >= circuit.getGatesCount()
+        || circuit.getSlot(net.gateIndex, net.outputIndex) >= circuit.getProgram().evaluableSlotsCount) {
+        throw std::runtime_error("compared net is not evaluated");
+    }
+
+    return circuit.getSlotType(circuit.getSlot(net.gateIndex, net.outputIndex));
+}
+
+EquivalenceChecker::EquivalenceChecker(const CompiledCircuit& first, const CompiledCircuit& second,
+                                       std::vector<std::array<uint32_t, 2>> _inputs,
+                                       std::vector<std::array<Net, 2>> _outputs, uint64_t seed, size_t lanesCount)
+    : circuits{&first, &second}, inputs(std::move(_inputs)), outputs(std::move(_outputs)),
+      batches{BatchEvaluator(first, lanesCount), BatchEvaluator(second, lanesCount)}, randomState(seed) {
+    // whole words keep lanes past the end out of signatures
+    if (lanesCount % WORD_BITS != 0) {
+        throw std::runtime_error("equivalence checking needs a multiple of 64 lanes");
+    }
+
+    for (const auto &input : inputs) {
+        const CircuitGate::PinType type = getNetType(first, {input[0]});
+        if (getNetType(second, {input[1]}) != type) {
+            throw std::runtime_error("matched inputs have different types");
+        }
+        inputTypes.push_back(type);
+    }
+
+    for (const auto &output : outputs) {
+        if (getNetType(first, output[0]) != getNetType(second, output[1])) {
+            throw std::runtime_error("matched outputs have different types");
+        }
+    }
+
+    boolLanes.assign(inputs.size(), std::vector<Word>(batches[0].getWordsCount()));
+    intLanes.assign(inputs.size(), std::vector<int32_t>(lanesCount));
+}
+
+std::optional<EquivalenceChecker::Counterexample> EquivalenceChecker::check(uint64_t count) {
+    const size_t lanes = getLanesCount();
+    const uint64_t end = vectorsCount + count;
+
+    while (vectorsCount < end) {
+        const size_t active = std::min<uint64_t>(lanes, end - vectorsCount);
+        runBatch(vectorsCount, true);
+
+        // the earliest lane in which any output differs
+        size_t firstLane = active, firstOutput = 0;
+        for (size_t o = 0; o < outputs.size(); o++) {
+            const Net &a = outputs[o][0], &b = outputs[o][1];
+
+            if (getNetType(*circuits[0], a) == CircuitGate::Bool) {
+                const std::span<const Word> x = batches[0].getBoolLanes(a.gateIndex, a.outputIndex);
+                const std::span<const Word> y = batches[1].getBoolLanes(b.gateIndex, b.outputIndex);
+
+                for (size_t w = 0; w * WORD_BITS < firstLane; w++) {
+                    if (const Word difference = x[w] ^ y[w]) {
+                        const size_t lane = w * WORD_BITS + std::countr_zero(difference);
+                        if (lane < firstLane) {
+                            firstLane = lane;
+                            firstOutput = o;
+                        }
+                        break;
+                    }
+                }
+            } else {
+                const std::span<const int32_t> x = batches[0].getIntLanes(a.gateIndex, a.outputIndex);
+                const std::span<const int32_t> y = batches[1].getIntLanes(b.gateIndex, b.outputIndex);
+
+                const auto [lastX, lastY] = std::mismatch(x.begin(), x.begin() + firstLane, y.begin());
+                if (lastX != x.begin() + firstLane) {
+                    firstLane = lastX - x.begin();
+                    firstOutput = o;
+                }
+            }
+        }
+
+        if (firstLane < active) {
+            Counterexample counterexample{vectorsCount + firstLane, {}, firstOutput, {}};
+            for (size_t i = 0; i < inputs.size(); i++) {
+                counterexample.inputs.push_back(inputTypes[i] == CircuitGate::Bool
+                                                ? int32_t((boolLanes[i][firstLane / WORD_BITS] >> (firstLane % WORD_BITS)) & 1)
+                                                : intLanes[i][firstLane]);
+            }
+            for (size_t c = 0; c < 2; c++) {
+                counterexample.values[c] = getLaneValue(c, outputs[firstOutput][c], firstLane);
+            }
+
+            vectorsCount += firstLane + 1;
+            return counterexample;
+        }
+
+        vectorsCount += active;
+    }
+
+    return std::nullopt;
+}
+
+std::vector<EquivalenceChecker::NetMatch> EquivalenceChecker::findCandidateNets() {
+    runBatch(0, false);
+
+    auto forEachNet = [&](size_t c, auto &&callback) {
+        const CompiledCircuit &circuit = *circuits[c];
+
+        for (uint32_t g = 0; g < circuit.getGatesCount(); g++) {
+            for (size_t o = 0; o < circuit.getOutputsCount(g); o++) {
+                if (circuit.getSlot(g, o) >= circuit.getProgram().evaluableSlotsCount) continue;
+                callback(Net{g, o});
+            }
+        }
+    };
+
+    // FNV-1a over the values of every lane, or nothing for a constant net
+    auto getSignature = [&](size_t c, const Net& net) -> std::optional<uint64_t> {
+        uint64_t hash = 0xcbf29ce484222325;
+        auto mix = [&](uint64_t value) { hash = (hash ^ value) * 0x100000001b3; };
+
+        if (getNetType(*circuits[c], net) == CircuitGate::Bool) {
+            const std::span<const Word> lanes = batches[c].getBoolLanes(net.gateIndex, net.outputIndex);
+            if ((lanes[0] == 0 || lanes[0] == ~Word(0)) && std::equal(lanes.begin() + 1, lanes.end(), lanes.begin())) {
+                return std::nullopt;
+            }
+            std::for_each(lanes.begin(), lanes.end(), mix);
+        } else {
+            const std::span<const int32_t> lanes = batches[c].getIntLanes(net.gateIndex, net.outputIndex);
+            if (std::equal(lanes.begin() + 1, lanes.end(), lanes.begin())) {
+                return std::nullopt;
+            }
+            for (int32_t value : lanes) mix(static_cast<uint32_t>(value));
+        }
+
+        return hash;
+    };
+
+    std::unordered_multimap<uint64_t, Net> firstNets;
+    forEachNet(0, [&](const Net& net) {
+        if (const std::optional<uint64_t> signature = getSignature(0, net)) {
+            firstNets.emplace(*signature, net);
+        }
+    });
+
+    std::vector<NetMatch> matches;
+    forEachNet(1, [&](const Net& net) {
+        const std::optional<uint64_t> signature = getSignature(1, net);
+        if (!signature) return;
+
+        // hashes can collide, so the values themselves decide
+        const size_t first = matches.size();
+        const auto [begin, end] = firstNets.equal_range(*signature);
+        for (auto it = begin; it != end; ++it) {
+            const Net &candidate = it->second;
+            const CircuitGate::PinType type = getNetType(*circuits[1], net);
+            if (getNetType(*circuits[0], candidate) != type) continue;
+
+            const bool isEqual = type == CircuitGate::Bool
+                    ? std::ranges::equal(batches[0].getBoolLanes(candidate.gateIndex, candidate.outputIndex),
+                                         batches[1].getBoolLanes(net.gateIndex, net.outputIndex))
+                    : std::ranges::equal(batches[0].getIntLanes(candidate.gateIndex, candidate.outputIndex),
+                                         batches[1].getIntLanes(net.gateIndex, net.outputIndex));
+            if (isEqual) {
+                matches.push_back({candidate, net});
+            }
+        }
+
+        // every net equal to this one is reported, the one of the same gate first, as in two versions
+        // of one netlist that is the likeliest counterpart; the rest follow in the first circuit's order
+        auto isSameNet = [&](const NetMatch& match) {
+            return match.first.gateIndex == net.gateIndex && match.first.outputIndex == net.outputIndex;
+        };
+        std::sort(matches.begin() + first, matches.end(), [&](const NetMatch& a, const NetMatch& b) {
+            if (isSameNet(a) != isSameNet(b)) return isSameNet(a);
+            return std::tie(a.first.gateIndex, a.first.outputIndex) < std::tie(b.first.gateIndex, b.first.outputIndex);
+        });
+    });
+
+    return matches;
+}
+
+void EquivalenceChecker::runBatch(uint64_t firstVector, bool withCorners) {
+    const size_t lanes = getLanesCount();
+    const uint64_t cornersEnd = withCorners ? getCornersCount() : 0;
+
+    for (size_t i = 0; i < inputs.size(); i++) {
+        if (inputTypes[i] == CircuitGate::Bool) {
+            std::vector<Word> &words = boolLanes[i];
+            for (Word &word : words) {
+                word = nextRandom();
+            }
+
+            for (uint64_t vector = firstVector; vector < std::min<uint64_t>(cornersEnd, firstVector + lanes); vector++) {
+                const size_t lane = vector - firstVector;
+                const Word bit = Word(1) << (lane % WORD_BITS);
+                words[lane / WORD_BITS] = getCornerValue(vector, i) ? words[lane / WORD_BITS] | bit
+                                                                    : words[lane / WORD_BITS] & ~bit;
+            }
+        } else {
+            std::vector<int32_t> &values = intLanes[i];
+            for (size_t lane = 0; lane < lanes; lane++) {
+                const uint64_t vector = firstVector + lane;
+                values[lane] = vector < cornersEnd ? getCornerValue(vector, i) : nextRandomInt();
+            }
+        }
+
+        for (size_t c = 0; c < 2; c++) {
+            if (inputTypes[i] == CircuitGate::Bool) {
+                batches[c].driveBool(inputs[i][c], boolLanes[i]);
+            } else {
+                batches[c].driveInt(inputs[i][c], intLanes[i]);
+            }
+        }
+    }
+
+    batches[0].run();
+    batches[1].run();
+}
+
+int32_t EquivalenceChecker::getCornerValue(uint64_t vector, size_t input) const {
+    const bool isBool = inputTypes[input] == CircuitGate::Bool;
+    const int32_t ones = isBool ? 1 : -1;
+
+    switch (vector) {
+        case 0: return 0;
+        case 1: return ones;
+        case 2: return isBool ? 0 : std::numeric_limits<int32_t>::max();
+        case 3: return isBool ? 1 : std::numeric_limits<int32_t>::min();
+        case 4: return 1;
+        default: break;
+    }
+
+    // every input alone set, then every input alone cleared
+    const uint64_t k = vector - 5;
+    if (k < inputs.size()) {
+        return k == input ? 1 : 0;
+    }
+    return k - inputs.size() == input ? 0 : ones;
+}
+
+int32_t EquivalenceChecker::nextRandomInt() {
+    const uint64_t random = nextRandom();
+    if ((random >> 32) % 4 == 0) {
+        return INTERESTING_INTS[(random >> 40) % std::size(INTERESTING_INTS)];
+    }
+
+    return static_cast<int32_t>(static_cast<uint32_t>(random));
+}
+
+uint64_t EquivalenceChecker::nextRandom() {
+    // splitmix64
+    uint64_t z = randomState += 0x9e3779b97f4a7c15;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+}
+
+int32_t EquivalenceChecker::getLaneValue(size_t circuit, const Net& net, size_t lane) const {
+    if (getNetType(*circuits[circuit], net) == CircuitGate::Bool) {
+        const std::span<const Word> words = batches[circuit].getBoolLanes(net.gateIndex, net.outputIndex);
+        return static_cast<int32_t>((words[lane / WORD_BITS] >> (lane % WORD_BITS)) & 1);
+    }
+
+    return batches[circuit].getIntLanes(net.gateIndex, net.outputIndex)[lane];
+}
@@ -0,0 +1,103 @@
+#ifndef CIRCUIT_EQUIVALENCE_CHECKER_H
+#define CIRCUIT_EQUIVALENCE_CHECKER_H
+
+#include "batch-evaluator.h"
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+/**
+ * Compares two compiled circuits by simulation: both are driven with the same vectors, a batch of
+ * lanes at a time, until some pair of matched outputs differs. Corner cases come first (all zeros,
+ * all ones, integer extremes, every input alone set or alone cleared), then random vectors, whose
+ * integers are biased towards small and extreme values. Passing proves nothing, but a single
+ * failing vector is a counterexample.
+ *
+ * Inputs are compiled constants, matched by pairs; constants left out keep their own values.
+ */
+class EquivalenceChecker {
+public:
+    struct Net {
+        uint32_t gateIndex;
+        size_t outputIndex = 0;
+    };
+
+    struct Counterexample {
+        uint64_t vector;
+        std::vector<int32_t> inputs;
+        // the first matched output which differs, and its value in each circuit
+        size_t output;
+        std::array<int32_t, 2> values;
+    };
+
+    /**
+     * A net of the first circuit and one of the second which had the same value in every lane of a
+     * batch of random vectors.
+     */
+    struct NetMatch {
+        Net first, second;
+    };
+
+private:
+    std::array<const CompiledCircuit *, 2> circuits;
+    std::vector<std::array<uint32_t, 2>> inputs;
+    std::vector<std::array<Net, 2>> outputs;
+    std::vector<CircuitGate::PinType> inputTypes;
+
+    std::array<BatchEvaluator, 2> batches;
+    uint64_t randomState;
+    uint64_t vectorsCount = 0;
+
+    // the values driven in the current batch, by input
+    std::vector<std::vector<BatchEvaluator::Word>> boolLanes;
+    std::vector<std::vector<int32_t>> intLanes;
+
+public:
+    EquivalenceChecker(const CompiledCircuit& first, const CompiledCircuit& second,
+                       std::vector<std::array<uint32_t, 2>> _inputs, std::vector<std::array<Net, 2>> _outputs,
+                       uint64_t seed = 1, size_t lanesCount = 4096);
+
+    /**
+     * Simulates up to `count` more vectors and returns the first one on which the circuits differ.
+     */
+    std::optional<Counterexample> check(uint64_t count);
+
+    /**
+     * Simulates one batch of random vectors and pairs up nets of the two circuits by their values,
+     * leaving out nets which stayed constant. These are candidates for being equivalent, e.g. the
+     * points where an optimized circuit still agrees with the reference. A net of the second circuit
+     * is paired with every net of the first one equal to it, the one of the same gate index first.
+     */
+    std::vector<NetMatch> findCandidateNets();
+
+    /**
+     * How many vectors `check()` has simulated so far, the same in both circuits.
+     */
+    [[nodiscard]]
+    uint64_t getVectorsCount() const { return vectorsCount; }
+
+    [[nodiscard]]
+    size_t getLanesCount() const { return batches[0].getLanesCount(); }
+
+private:
+    /**
+     * Fills every lane with vectors `firstVector` onwards, corner cases included, and runs both circuits.
+     */
+    void runBatch(uint64_t firstVector, bool withCorners);
+
+    [[nodiscard]]
+    size_t getCornersCount() const { return 5 + 2 * inputs.size(); }
+
+    [[nodiscard]]
+    int32_t getCornerValue(uint64_t vector, size_t input) const;
+
+    int32_t nextRandomInt();
+
+    uint64_t nextRandom();
+
+    [[nodiscard]]
+    int32_t getLaneValue(size_t circuit, const Net& net, size_t lane) const;
+};
+
+#endif //CIRCUIT_EQUIVALENCE_CHECKER_H
@@ -0,0 +1,198 @@
+#include "event-simulator.h"
+
+#include <bit>
+#include <stdexcept>
+
+using Instruction = CompiledCircuit::Instruction;
+
+// fills `edges` with the values of `pairs` grouped by key, `begin` becoming the CSR offsets
+static void buildCsr(size_t keysCount, const std::vector<std::pair<uint32_t, uint32_t>>& pairs,
+                     std::vector<uint32_t>& begin, std::vector<uint32_t>& edges) {
+    begin.assign(keysCount + 1, 0);
+    for (const auto &[key, value] : pairs) {
+        begin[key + 1]++;
+    }
+    for (size_t k = 0; k < keysCount; k++) {
+        begin[k + 1] += begin[k];
+    }
+
+    edges.resize(pairs.size());
+    std::vector<uint32_t> cursor(begin.begin(), begin.end() - 1);
+    for (const auto &[key, value] : pairs) {
+        edges[cursor[key]++] = value;
+    }
+}
+
+EventSimulator::EventSimulator(CompiledCircuit& _circuit) : circuit(_circuit) {
+    const std::span<const Instruction> instructions = circuit.getInstructions();
+    const size_t slotsCount = circuit.getSlotsCount();
+
+    std::vector<std::pair<uint32_t, uint32_t>> reads, latches;
+    for (uint32_t i = 0; i < instructions.size(); i++) {
+        const Instruction &ins = instructions[i];
+
+        if (ins.op == CompiledCircuit::Register) {
+            if (ins.in0 != CompiledCircuit::NO_SLOT) latches.emplace_back(ins.in0, i);
+            continue;
+        }
+
+        if (ins.in0 != CompiledCircuit::NO_SLOT) reads.emplace_back(ins.in0, i);
+        if (ins.in1 != CompiledCircuit::NO_SLOT && ins.in1 != ins.in0) reads.emplace_back(ins.in1, i);
+    }
+
+    buildCsr(slotsCount, reads, readersBegin, readers);
+    buildCsr(slotsCount, latches, latchersBegin, latchers);
+
+    delays.assign(instructions.size(), 1);
+    activeStamps.assign(instructions.size(), 0);
+    wheel.resize(2);
+
+    circuit.run();
+    projected = circuit.values;
+
+    // nothing is known about how the inputs relate to the states yet
+    isDirtyRegister.assign(instructions.size(), false);
+    for (uint32_t i : circuit.getRegisterInstructions()) {
+        if (instructions[i].in0 != CompiledCircuit::NO_SLOT) {
+            isDirtyRegister[i] = true;
+            dirtyRegisters.push_back(i);
+        }
+    }
+}
+
+void EventSimulator::setDelay(const CircuitGate& gate, uint32_t delay) {
+    const std::optional<uint32_t> gateIndex = circuit.getGateIndex(gate);
+    if (!gateIndex) {
+        throw std::runtime_error("gate is not compiled");
+    }
+
+    setDelay(*gateIndex, delay);
+}
+
+void EventSimulator::setDelay(uint32_t gateIndex, uint32_t delay) {
+    if (gateIndex >= circuit.getGatesCount()
+        || circuit.getProgram().gateInstructions[gateIndex] == CompiledCircuit::NO_INSTRUCTION) {
+        throw std::runtime_error("gate has no instruction of its own");
+    }
+    if (delay == 0) {
+        throw std::runtime_error("delays must be at least one tick");
+    }
+
+    // events are at most the longest delay ahead, so a wheel longer than that never wraps onto itself
+    if (delay >= wheel.size()) {
+        growWheel(std::bit_ceil(size_t(delay) + 1));
+    }
+
+    delays[circuit.getProgram().gateInstructions[gateIndex]] = delay;
+}
+
+void EventSimulator::setConstant(const CircuitGate& gate, int32_t value) {
+    const std::optional<uint32_t> gateIndex = circuit.getGateIndex(gate);
+    if (!gateIndex) {
+        throw std::runtime_error("gate is not a compiled constant");
+    }
+
+    setConstant(*gateIndex, value);
+}
+
+void EventSimulator::setConstant(uint32_t gateIndex, int32_t value) {
+    circuit.setConstant(gateIndex, value);
+
+    const Instruction &ins = circuit.program.instructions[circuit.program.gateInstructions[gateIndex]];
+    schedule(ins.out, ins.imm, 0);
+}
+
+void EventSimulator::clock() {
+    // a register's input only matters if it changed, and every input is read before any state changes
+    for (uint32_t i : dirtyRegisters) {
+        Instruction &ins = circuit.program.instructions[i];
+        isDirtyRegister[i] = false;
+
+        const int32_t next = circuit.values[ins.in0];
+        if (next != ins.imm) {
+            ins.imm = next;
+            schedule(ins.out, next, delays[i]);
+        }
+    }
+
+    dirtyRegisters.clear();
+}
+
+EventSimulator::Time EventSimulator::settle() {
+    const Time start = now;
+
+    while (pendingEvents > 0) {
+        processTick();
+        now++;
+    }
+
+    return now - start;
+}
+
+EventSimulator::Time EventSimulator::step() {
+    clock();
+    return settle();
+}
+
+void EventSimulator::schedule(CompiledCircuit::SlotIndex slot, int32_t value, uint32_t delay) {
+    // an instruction's events leave in the order it computed them, so comparing against the last
+    // one scheduled is enough to drop the ones which would not change anything
+    if (projected[slot] == value) return;
+
+    projected[slot] = value;
+    wheel[(now + delay) & (wheel.size() - 1)].push_back({slot, value});
+    pendingEvents++;
+}
+
+void EventSimulator::processTick() {
+    std::vector<Event> &bucket = wheel[now & (wheel.size() - 1)];
+    int32_t *values = circuit.values.data();
+
+    // apply all changes of this tick first, so that an instruction with several changed inputs
+    // is evaluated only once, with all of them
+    for (const Event &event : bucket) {
+        if (values[event.slot] == event.value) continue;
+        values[event.slot] = event.value;
+
+        for (uint32_t r = readersBegin[event.slot]; r < readersBegin[event.slot + 1]; r++) {
+            const uint32_t reader = readers[r];
+            if (activeStamps[reader] != now + 1) {
+                activeStamps[reader] = now + 1;
+                active.push_back(reader);
+            }
+        }
+
+        for (uint32_t l = latchersBegin[event.slot]; l < latchersBegin[event.slot + 1]; l++) {
+            const uint32_t latcher = latchers[l];
+            if (!isDirtyRegister[latcher]) {
+                isDirtyRegister[latcher] = true;
+                dirtyRegisters.push_back(latcher);
+            }
+        }
+    }
+
+    eventsCount += bucket.size();
+    pendingEvents -= bucket.size();
+    bucket.clear();
+
+    const std::span<const Instruction> instructions = circuit.getInstructions();
+    for (uint32_t i : active) {
+        schedule(instructions[i].out, CompiledCircuit::evaluate(instructions[i], values), delays[i]);
+    }
+
+    evaluationsCount += active.size();
+    active.clear();
+}
+
+void EventSimulator::growWheel(size_t minSize) {
+    std::vector<std::vector<Event>> grown(minSize);
+
+    // bucket `b` holds the events of the first tick from now on which maps to it
+    for (size_t b = 0; b < wheel.size(); b++) {
+        const Time time = now + ((b - now) & (wheel.size() - 1));
+        std::vector<Event> &bucket = grown[time & (minSize - 1)];
+        bucket.insert(bucket.end(), wheel[b].begin(), wheel[b].end());
+    }
+
+    wheel = std::move(grown);
+}
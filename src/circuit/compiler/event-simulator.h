@@ -0,0 +1,117 @@
+#ifndef CIRCUIT_EVENT_SIMULATOR_H
+#define CIRCUIT_EVENT_SIMULATOR_H
+
+#include "compiled-circuit.h"
+#include <cstdint>
+#include <vector>
+
+/**
+ * Simulates a compiled circuit event by event, so that a clock cycle costs as much as the activity
+ * it causes rather than the size of the circuit. A value change is an event on a timing wheel, a
+ * ring of buckets with one per tick. Applying the events of a tick re-evaluates only the
+ * instructions reading the changed slots, and those whose output changes schedule events of their
+ * own, as many ticks later as their delay.
+ *
+ * Every instruction takes one tick unless given a delay of its own, so paths of different lengths
+ * settle at different times and glitches show. Delays are transport delays: every change gets
+ * through, however short the pulse.
+ *
+ * Values live in the compiled circuit, which is run once in full when the simulator is created and
+ * can be read as usual at any time. While the simulator exists, constants must be changed and
+ * registers clocked through it rather than through the circuit.
+ */
+class EventSimulator {
+public:
+    using Time = uint64_t;
+
+private:
+    struct Event {
+        CompiledCircuit::SlotIndex slot;
+        int32_t value;
+    };
+
+    CompiledCircuit &circuit;
+
+    // instructions reading every slot during a run, and registers latching it, in CSR form
+    std::vector<uint32_t> readersBegin, readers;
+    std::vector<uint32_t> latchersBegin, latchers;
+
+    std::vector<uint32_t> delays;
+
+    // the value every slot will have once the scheduled events are applied
+    std::vector<int32_t> projected;
+
+    std::vector<std::vector<Event>> wheel;
+    size_t pendingEvents = 0;
+    Time now = 0;
+
+    // instructions to evaluate in the current tick, each stamped with the tick it was queued in
+    std::vector<uint32_t> active;
+    std::vector<Time> activeStamps;
+
+    // registers whose input changed since the last clock edge; only these can latch anything new
+    std::vector<uint32_t> dirtyRegisters;
+    std::vector<bool> isDirtyRegister;
+
+    uint64_t eventsCount = 0;
+    uint64_t evaluationsCount = 0;
+
+public:
+    explicit EventSimulator(CompiledCircuit& _circuit);
+
+    /**
+     * Sets the delay of the gate in ticks, at least one. The gate must have an instruction of its
+     * own, which is every compiled gate unless the circuit was optimized.
+     */
+    void setDelay(const CircuitGate& gate, uint32_t delay);
+
+    void setDelay(uint32_t gateIndex, uint32_t delay);
+
+    /**
+     * Changes the value of a compiled ConstInt or ConstBool gate. The change is applied at the
+     * current tick, by the next `settle()`.
+     */
+    void setConstant(const CircuitGate& gate, int32_t value);
+
+    void setConstant(uint32_t gateIndex, int32_t value);
+
+    /**
+     * A clock edge: every register stores the current value of its input, the new state reaching
+     * its output after the register's delay.
+     */
+    void clock();
+
+    /**
+     * Processes events until there are none left. Returns how many ticks that took.
+     */
+    Time settle();
+
+    /**
+     * One clock cycle, i.e. a clock edge followed by everything it sets in motion.
+     */
+    Time step();
+
+    [[nodiscard]]
+    Time getTime() const { return now; }
+
+    /**
+     * Events processed so far, including the ones which turned out not to change anything.
+     */
+    [[nodiscard]]
+    uint64_t getEventsCount() const { return eventsCount; }
+
+    /**
+     * Instruction evaluations so far, the measure of how much work the simulation took.
+     */
+    [[nodiscard]]
+    uint64_t getEvaluationsCount() const { return evaluationsCount; }
+
+private:
+    void schedule(CompiledCircuit::SlotIndex slot, int32_t value, uint32_t delay);
+
+    void processTick();
+
+    void growWheel(size_t minSize);
+};
+
+#endif //CIRCUIT_EVENT_SIMULATOR_H
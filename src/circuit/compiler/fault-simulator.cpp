@@ -0,0 +1,244 @@
+#include "fault-simulator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+constexpr static FaultSimulator::Word ALL_LANES = ~FaultSimulator::Word(0);
+
+FaultSimulator::FaultSimulator(const CompiledCircuit& _circuit, std::vector<CompiledCircuit::SlotIndex> _observedSlots,
+                               size_t _wordsCount)
+    : circuit(_circuit), observedSlots(std::move(_observedSlots)), wordsCount(_wordsCount) {
+    if (wordsCount == 0) {
+        throw std::runtime_error("fault simulation needs at least one word of lanes");
+    }
+
+    const CompiledCircuit::Program &program = circuit.getProgram();
+    for (CompiledCircuit::SlotIndex slot : observedSlots) {
+        if (slot >= program.evaluableSlotsCount) {
+            throw std::runtime_error("observed slot is not evaluated");
+        }
+    }
+
+    std::vector<uint32_t> slotInstructions(circuit.getSlotsCount(), CompiledCircuit::NO_INSTRUCTION);
+    for (uint32_t i = 0; i < program.instructions.size(); i++) {
+        slotInstructions[program.instructions[i].out] = i;
+        immediates.push_back(program.instructions[i].imm);
+    }
+
+    for (uint32_t g = 0; g < circuit.getGatesCount(); g++) {
+        for (uint32_t o = 0; o < circuit.getOutputsCount(g); o++) {
+            CompiledCircuit::SlotIndex slot = circuit.getSlot(g, o);
+            if (slot >= program.evaluableSlotsCount) continue;
+
+            while (program.instructions[slotInstructions[slot]].op == CompiledCircuit::Copy) {
+                slot = program.instructions[slotInstructions[slot]].in0;
+            }
+
+            for (bool stuckAtOne : {false, true}) {
+                faults.push_back({g, o, stuckAtOne});
+                faultInstructions.push_back(slotInstructions[slot]);
+            }
+        }
+    }
+
+    size_t boolRowsCount = 0, intRowsCount = 0;
+    slotRows.resize(circuit.getSlotsCount());
+
+    for (CompiledCircuit::SlotIndex slot = 0; slot < circuit.getSlotsCount(); slot++) {
+        slotRows[slot] = circuit.getSlotType(slot) == CircuitGate::Bool ? boolRowsCount++ : intRowsCount++;
+    }
+
+    boolValues.resize(boolRowsCount * wordsCount);
+    intValues.resize(intRowsCount * wordsCount * WORD_BITS);
+
+    reset();
+}
+
+size_t FaultSimulator::simulate(std::span<const uint32_t> inputGates, std::span<const int32_t> values, size_t count) {
+    if (values.size() < inputGates.size() * count) {
+        throw std::runtime_error("vectors do not match the inputs");
+    }
+
+    const CompiledCircuit::Program &program = circuit.getProgram();
+    for (uint32_t gateIndex : inputGates) {
+        const uint32_t instruction = gateIndex < circuit.getGatesCount()
+                                     ? program.gateInstructions[gateIndex]
+                                     : CompiledCircuit::NO_INSTRUCTION;
+        if (instruction == CompiledCircuit::NO_INSTRUCTION
+            || (program.instructions[instruction].op != CompiledCircuit::ConstBool
+                && program.instructions[instruction].op != CompiledCircuit::ConstInt)) {
+            throw std::runtime_error("only compiled constants can be driven");
+        }
+    }
+
+    const size_t faultLanes = getLanesCount() - 1;
+    const size_t detectedBefore = getDetectedCount();
+    std::vector<Word> differences(wordsCount);
+
+    // once every fault is detected, the rest of the vectors only need counting
+    for (size_t v = 0; v < count && !remaining.empty(); v++) {
+        for (size_t k = 0; k < inputGates.size(); k++) {
+            const uint32_t instruction = program.gateInstructions[inputGates[k]];
+            const int32_t value = values[k * count + v];
+            immediates[instruction] = program.instructions[instruction].op == CompiledCircuit::ConstBool ? value != 0 : value;
+        }
+
+        // every sweep takes the next faults still undetected, so later sweeps only see the survivors
+        size_t kept = 0;
+        for (size_t first = 0; first < remaining.size(); first += faultLanes) {
+            const size_t last = std::min(remaining.size(), first + faultLanes);
+
+            injections.clear();
+            for (size_t f = first; f < last; f++) {
+                const uint32_t fault = remaining[f];
+                injections.push_back({faultInstructions[fault], static_cast<uint32_t>(f - first + 1),
+                                      faults[fault].stuckAtOne});
+            }
+            std::sort(injections.begin(), injections.end(), [](const Injection &a, const Injection &b) {
+                return a.instruction < b.instruction;
+            });
+
+            sweep();
+            findDifferences(differences);
+
+            for (size_t f = first; f < last; f++) {
+                const size_t lane = f - first + 1;
+                if ((differences[lane / WORD_BITS] >> (lane % WORD_BITS)) & 1) {
+                    detectingVectors[remaining[f]] = vectorsCount + v;
+                } else {
+                    remaining[kept++] = remaining[f];
+                }
+            }
+        }
+
+        remaining.resize(kept);
+    }
+
+    vectorsCount += count;
+    return getDetectedCount() - detectedBefore;
+}
+
+void FaultSimulator::reset() {
+    remaining.resize(faults.size());
+    for (uint32_t f = 0; f < faults.size(); f++) {
+        remaining[f] = f;
+    }
+
+    detectingVectors.assign(faults.size(), std::nullopt);
+    vectorsCount = 0;
+}
+
+void FaultSimulator::sweep() {
+    const size_t n = wordsCount;
+    const size_t rowLength = wordsCount * WORD_BITS;
+    const std::span<const CompiledCircuit::Instruction> instructions = circuit.getInstructions();
+    auto injection = injections.begin();
+
+    for (uint32_t i = 0; i < instructions.size(); i++) {
+        const CompiledCircuit::Instruction &ins = instructions[i];
+
+        switch (ins.op) {
+            case CompiledCircuit::ConstTrue:
+                std::fill_n(boolRow(ins.out), n, ALL_LANES);
+                break;
+            case CompiledCircuit::ConstBool:
+                std::fill_n(boolRow(ins.out), n, immediates[i] ? ALL_LANES : 0);
+                break;
+            case CompiledCircuit::Not: {
+                Word *out = boolRow(ins.out);
+                const Word *a = boolRow(ins.in0);
+                for (size_t w = 0; w < n; w++) {
+                    out[w] = ~a[w];
+                }
+                break;
+            }
+            case CompiledCircuit::And: {
+                Word *out = boolRow(ins.out);
+                const Word *a = boolRow(ins.in0);
+                const Word *b = boolRow(ins.in1);
+                for (size_t w = 0; w < n; w++) {
+                    out[w] = a[w] & b[w];
+                }
+                break;
+            }
+            case CompiledCircuit::ConstInt:
+                std::fill_n(intRow(ins.out), rowLength, immediates[i]);
+                break;
+            case CompiledCircuit::Add: {
+                int32_t *out = intRow(ins.out);
+                const int32_t *a = intRow(ins.in0);
+                const int32_t *b = intRow(ins.in1);
+                for (size_t l = 0; l < rowLength; l++) {
+                    out[l] = CompiledCircuit::evaluate(CompiledCircuit::Add, 0, a[l], b[l]);
+                }
+                break;
+            }
+            case CompiledCircuit::Mul: {
+                int32_t *out = intRow(ins.out);
+                const int32_t *a = intRow(ins.in0);
+                const int32_t *b = intRow(ins.in1);
+                for (size_t l = 0; l < rowLength; l++) {
+                    out[l] = CompiledCircuit::evaluate(CompiledCircuit::Mul, 0, a[l], b[l]);
+                }
+                break;
+            }
+            case CompiledCircuit::CmpLe: {
+                Word *out = boolRow(ins.out);
+                const int32_t *a = intRow(ins.in0);
+                const int32_t *b = intRow(ins.in1);
+                for (size_t w = 0; w < n; w++) {
+                    Word mask = 0;
+                    for (size_t bit = 0; bit < WORD_BITS; bit++) {
+                        const size_t lane = w * WORD_BITS + bit;
+                        mask |= Word(CompiledCircuit::evaluate(CompiledCircuit::CmpLe, 0, a[lane], b[lane])) << bit;
+                    }
+                    out[w] = mask;
+                }
+                break;
+            }
+            case CompiledCircuit::Register:
+                if (circuit.getSlotType(ins.out) == CircuitGate::Bool) {
+                    std::fill_n(boolRow(ins.out), n, immediates[i] ? ALL_LANES : 0);
+                } else {
+                    std::fill_n(intRow(ins.out), rowLength, immediates[i]);
+                }
+                break;
+            case CompiledCircuit::Copy:
+                if (circuit.getSlotType(ins.out) == CircuitGate::Bool) {
+                    std::copy_n(boolRow(ins.in0), n, boolRow(ins.out));
+                } else {
+                    std::copy_n(intRow(ins.in0), rowLength, intRow(ins.out));
+                }
+                break;
+        }
+
+        for (; injection != injections.end() && injection->instruction == i; ++injection) {
+            if (circuit.getSlotType(ins.out) == CircuitGate::Bool) {
+                Word &word = boolRow(ins.out)[injection->lane / WORD_BITS];
+                const Word bit = Word(1) << (injection->lane % WORD_BITS);
+                word = injection->stuckAtOne ? word | bit : word & ~bit;
+            } else {
+                intRow(ins.out)[injection->lane] = injection->stuckAtOne ? -1 : 0;
+            }
+        }
+    }
+}
+
+void FaultSimulator::findDifferences(std::vector<Word>& differences) const {
+    std::fill(differences.begin(), differences.end(), 0);
+
+    for (CompiledCircuit::SlotIndex slot : observedSlots) {
+        if (circuit.getSlotType(slot) == CircuitGate::Bool) {
+            const Word *row = boolRow(slot);
+            const Word good = row[0] & 1 ? ALL_LANES : 0;
+            for (size_t w = 0; w < wordsCount; w++) {
+                differences[w] |= row[w] ^ good;
+            }
+        } else {
+            const int32_t *row = intRow(slot);
+            for (size_t l = 1; l < getLanesCount(); l++) {
+                differences[l / WORD_BITS] |= Word(row[l] != row[0]) << (l % WORD_BITS);
+            }
+        }
+    }
+}
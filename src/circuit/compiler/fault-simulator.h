@@ -0,0 +1,128 @@
+#ifndef CIRCUIT_FAULT_SIMULATOR_H
+#define CIRCUIT_FAULT_SIMULATOR_H
+
+#include "compiled-circuit.h"
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+/**
+ * Grades input vectors by the single stuck-at faults they detect. Every output pin of every compiled
+ * gate may be stuck at 0 or at 1 (a Bool pin at false or true, an Int pin at 0 or all ones), and a
+ * vector detects a fault if some observed slot then differs from the fault-free circuit.
+ *
+ * Faulty machines are simulated in parallel, one per lane of rows laid out like BatchEvaluator's:
+ * lane 0 is the fault-free machine and every other lane has one fault injected right after the
+ * instruction computing its pin, so one sweep over the program grades `getLanesCount() - 1` faults.
+ * Detected faults are dropped, and the remaining ones are packed into as few sweeps as they fill.
+ *
+ * Every vector is a single combinational run, registers holding their compiled state. A fault on an
+ * instance's output pin is one on the net computing it, and when the optimizer merged several gates
+ * into one slot, a fault on any of their pins is one on all of them.
+ */
+class FaultSimulator {
+public:
+    using Word = uint64_t;
+    constexpr static size_t WORD_BITS = 64;
+
+    struct Fault {
+        uint32_t gateIndex;
+        uint32_t outputIndex;
+        bool stuckAtOne;
+    };
+
+private:
+    struct Injection {
+        uint32_t instruction;
+        uint32_t lane;
+        bool stuckAtOne;
+    };
+
+    const CompiledCircuit &circuit;
+    std::vector<CompiledCircuit::SlotIndex> observedSlots;
+    size_t wordsCount;
+
+    std::vector<Fault> faults;
+    // the instruction computing the pin of every fault
+    std::vector<uint32_t> faultInstructions;
+
+    // faults not detected yet, and the vector which first detected every other one
+    std::vector<uint32_t> remaining;
+    std::vector<std::optional<uint64_t>> detectingVectors;
+    uint64_t vectorsCount = 0;
+
+    std::vector<uint32_t> slotRows;
+    std::vector<Word> boolValues;
+    std::vector<int32_t> intValues;
+
+    // immediates of the program, with the inputs of the current vector written over them
+    std::vector<int32_t> immediates;
+    std::vector<Injection> injections;
+
+public:
+    /**
+     * Enumerates the faults of every evaluable gate. `wordsCount` words of lanes are simulated per sweep.
+     */
+    FaultSimulator(const CompiledCircuit& _circuit, std::vector<CompiledCircuit::SlotIndex> _observedSlots,
+                   size_t _wordsCount = 4);
+
+    [[nodiscard]]
+    size_t getLanesCount() const { return wordsCount * WORD_BITS; }
+
+    [[nodiscard]]
+    const std::vector<Fault>& getFaults() const { return faults; }
+
+    /**
+     * Applies `count` vectors to the given source gates, gate `inputGates[k]` taking
+     * `values[k * count + v]` in vector `v`, as StimulusReader lays them out. Returns how many faults
+     * were detected for the first time.
+     */
+    size_t simulate(std::span<const uint32_t> inputGates, std::span<const int32_t> values, size_t count);
+
+    /**
+     * Forgets what was detected, to grade another set of vectors from scratch.
+     */
+    void reset();
+
+    [[nodiscard]]
+    size_t getDetectedCount() const { return faults.size() - remaining.size(); }
+
+    [[nodiscard]]
+    double getCoverage() const { return faults.empty() ? 1.0 : double(getDetectedCount()) / double(faults.size()); }
+
+    /**
+     * Index of the first vector which detected the fault, counting every vector simulated since the
+     * last reset.
+     */
+    [[nodiscard]]
+    std::optional<uint64_t> getDetectingVector(size_t fault) const { return detectingVectors[fault]; }
+
+    [[nodiscard]]
+    uint64_t getVectorsCount() const { return vectorsCount; }
+
+private:
+    /**
+     * Runs the program once over all lanes with the current injections.
+     */
+    void sweep();
+
+    /**
+     * Lanes in which some observed slot differs from lane 0.
+     */
+    void findDifferences(std::vector<Word>& differences) const;
+
+    Word *boolRow(CompiledCircuit::SlotIndex slot) { return &boolValues[slotRows[slot] * wordsCount]; }
+
+    [[nodiscard]]
+    const Word *boolRow(CompiledCircuit::SlotIndex slot) const { return &boolValues[slotRows[slot] * wordsCount]; }
+
+    int32_t *intRow(CompiledCircuit::SlotIndex slot) { return &intValues[slotRows[slot] * wordsCount * WORD_BITS]; }
+
+    [[nodiscard]]
+    const int32_t *intRow(CompiledCircuit::SlotIndex slot) const {
+        return &intValues[slotRows[slot] * wordsCount * WORD_BITS];
+    }
+};
+
+#endif //CIRCUIT_FAULT_SIMULATOR_H
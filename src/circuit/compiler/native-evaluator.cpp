@@ -0,0 +1,191 @@
+#include "native-evaluator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <dlfcn.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+// a net read by generated code, either a local of the current function or a stored value
+struct NativeNet {
+    CompiledCircuit::SlotIndex slot;
+    bool isLocal;
+};
+
+static std::ostream& operator<<(std::ostream& out, const NativeNet& net) {
+    if (net.isLocal) {
+        return out << 'n' << net.slot;
+    }
+
+    return out << "v[" << net.slot << ']';
+}
+
+static bool isConstantOp(CompiledCircuit::OpCode op) {
+    return op == CompiledCircuit::ConstBool || op == CompiledCircuit::ConstInt || op == CompiledCircuit::Register;
+}
+
+NativeEvaluator::NativeEvaluator(CompiledCircuit& _circuit, const std::string& compiler) : circuit(_circuit) {
+    const std::span<const CompiledCircuit::Instruction> instructions = circuit.getInstructions();
+    for (uint32_t i = 0; i < instructions.size(); i++) {
+        if (isConstantOp(instructions[i].op)) {
+            constantInstructions.push_back(i);
+        }
+    }
+    constants.resize(constantInstructions.size());
+
+    try {
+        build(compiler);
+    } catch (const std::exception &e) {
+        error = e.what();
+    }
+}
+
+NativeEvaluator::~NativeEvaluator() {
+    if (library) {
+        dlclose(library);
+    }
+}
+
+void NativeEvaluator::run() {
+    if (!function) {
+        circuit.run();
+        return;
+    }
+
+    const std::span<const CompiledCircuit::Instruction> instructions = circuit.getInstructions();
+    for (size_t k = 0; k < constantInstructions.size(); k++) {
+        constants[k] = instructions[constantInstructions[k]].imm;
+    }
+
+    function(circuit.values.data(), constants.data());
+}
+
+std::string NativeEvaluator::getDefaultCompiler() {
+    const char *cxx = std::getenv("CXX");
+    return cxx && *cxx ? cxx : "c++";
+}
+
+std::string NativeEvaluator::generateSource(const CompiledCircuit& circuit) {
+    const std::span<const CompiledCircuit::Instruction> instructions = circuit.getInstructions();
+    const size_t functionsCount = (instructions.size() + FUNCTION_SIZE - 1) / FUNCTION_SIZE;
+
+    std::ostringstream source;
+    source << "#include <cstdint>\n"
+              "typedef int32_t i32;\n"
+              "typedef uint32_t u32;\n";
+
+    uint32_t constantIndex = 0;
+    for (size_t f = 0; f < functionsCount; f++) {
+        const size_t begin = f * FUNCTION_SIZE;
+        const size_t end = std::min(begin + FUNCTION_SIZE, instructions.size());
+
+        // nets computed within this function are locals, the rest was stored by earlier functions;
+        // `build()` checks that instruction `i` writes slot `i`
+        auto operand = [&](CompiledCircuit::SlotIndex slot) {
+            return NativeNet{slot, slot >= begin && slot < end};
+        };
+
+        source << "\n__attribute__((noinline)) static void part" << f << "(i32 *__restrict v, const i32 *c) {\n";
+
+        for (size_t i = begin; i < end; i++) {
+            const CompiledCircuit::Instruction &ins = instructions[i];
+            source << "    const i32 n" << ins.out << " = ";
+
+            switch (ins.op) {
+                case CompiledCircuit::ConstTrue:
+                    source << "1";
+                    break;
+                case CompiledCircuit::ConstBool:
+                case CompiledCircuit::ConstInt:
+                case CompiledCircuit::Register:
+                    source << "c[" << constantIndex++ << "]";
+                    break;
+                case CompiledCircuit::Not:
+                    source << "!" << operand(ins.in0);
+                    break;
+                case CompiledCircuit::And:
+                    source << operand(ins.in0) << " & " << operand(ins.in1);
+                    break;
+                case CompiledCircuit::Add:
+                    source << "(i32) ((u32) " << operand(ins.in0) << " + (u32) " << operand(ins.in1) << ")";
+                    break;
+                case CompiledCircuit::Mul:
+                    source << "(i32) ((u32) " << operand(ins.in0) << " * (u32) " << operand(ins.in1) << ")";
+                    break;
+                case CompiledCircuit::CmpLe:
+                    source << operand(ins.in0) << " <= " << operand(ins.in1);
+                    break;
+                case CompiledCircuit::Copy:
+                    source << operand(ins.in0);
+                    break;
+            }
+
+            source << ";\n    v[" << ins.out << "] = n" << ins.out << ";\n";
+        }
+
+        source << "}\n";
+    }
+
+    source << "\nextern \"C\" void circuit_run(i32 *v, const i32 *c) {\n";
+    for (size_t f = 0; f < functionsCount; f++) {
+        source << "    part" << f << "(v, c);\n";
+    }
+    source << "}\n";
+
+    return source.str();
+}
+
+void NativeEvaluator::build(const std::string& compiler) {
+    namespace fs = std::filesystem;
+
+    // slots are handed out in execution order, which lets every function tell its own nets apart
+    const std::span<const CompiledCircuit::Instruction> instructions = circuit.getInstructions();
+    for (uint32_t i = 0; i < instructions.size(); i++) {
+        if (instructions[i].out != i) {
+            throw std::runtime_error("native code needs slots assigned in execution order");
+        }
+    }
+
+    std::string directoryTemplate = (fs::temp_directory_path() / "circuit-native-XXXXXX").string();
+    if (!mkdtemp(directoryTemplate.data())) {
+        throw std::runtime_error("cannot create a temporary directory");
+    }
+
+    const fs::path directory = directoryTemplate;
+    const fs::path sourcePath = directory / "circuit.cpp";
+    const fs::path libraryPath = directory / "circuit.so";
+    const fs::path logPath = directory / "build.log";
+
+    try {
+        std::ofstream(sourcePath) << generateSource(circuit);
+
+        const std::string command = compiler + " -O1 -shared -fPIC -w -o '" + libraryPath.string() + "' '"
+                                    + sourcePath.string() + "' > '" + logPath.string() + "' 2>&1";
+
+        if (std::system(command.c_str()) != 0) {
+            std::ifstream log(logPath);
+            std::string firstLine;
+            std::getline(log, firstLine);
+            throw std::runtime_error("building native code with `" + compiler + "` failed"
+                                     + (firstLine.empty() ? "" : ": " + firstLine));
+        }
+
+        library = dlopen(libraryPath.c_str(), RTLD_NOW | RTLD_LOCAL);
+        if (!library) {
+            throw std::runtime_error(std::string("loading native code failed: ") + dlerror());
+        }
+
+        function = reinterpret_cast<Function>(dlsym(library, "circuit_run"));
+        if (!function) {
+            throw std::runtime_error("native code does not export circuit_run");
+        }
+    } catch (...) {
+        fs::remove_all(directory);
+        throw;
+    }
+
+    // the loaded library stays mapped after its file is gone
+    fs::remove_all(directory);
+}
@@ -0,0 +1,74 @@
+#ifndef CIRCUIT_NATIVE_EVALUATOR_H
+#define CIRCUIT_NATIVE_EVALUATOR_H
+
+#include "compiled-circuit.h"
+#include <string>
+#include <vector>
+
+/**
+ * Runs a compiled circuit as native code. The program is translated into C++ source, straight-line
+ * code with one local per net, which is built into a shared object by the system's compiler and
+ * loaded with `dlopen`. Huge circuits are split into functions of at most FUNCTION_SIZE instructions,
+ * so that the compiler copes with them; nets crossing functions go through the circuit's values.
+ *
+ * Constants and register states are read from the circuit's instructions on every run, so
+ * `setConstant()`, `updateConstants()` and `clock()` keep working without building anything
+ * again. The structure of the program must not change though, so optimize the circuit before
+ * creating the evaluator.
+ *
+ * If there is no compiler, or building or loading the code fails, `run()` falls back to the
+ * interpreter and `getError()` tells why.
+ */
+class NativeEvaluator {
+    using Function = void (*)(int32_t *values, const int32_t *constants);
+
+    CompiledCircuit &circuit;
+    void *library = nullptr;
+    Function function = nullptr;
+    std::string error;
+
+    // instructions whose immediate the generated code reads, in the order it reads them
+    std::vector<uint32_t> constantInstructions;
+    std::vector<int32_t> constants;
+
+    constexpr static size_t FUNCTION_SIZE = 512;
+
+public:
+    /**
+     * Builds the native code right away, which may take a while for big circuits. `compiler` is
+     * the command invoking a C++ compiler, by default $CXX or `c++`.
+     */
+    explicit NativeEvaluator(CompiledCircuit& _circuit, const std::string& compiler = getDefaultCompiler());
+
+    ~NativeEvaluator();
+
+    NativeEvaluator(const NativeEvaluator&) = delete;
+
+    NativeEvaluator& operator=(const NativeEvaluator&) = delete;
+
+    void run();
+
+    [[nodiscard]]
+    bool isNative() const { return function != nullptr; }
+
+    /**
+     * Why native code is not used, if it isn't.
+     */
+    [[nodiscard]]
+    const std::string& getError() const { return error; }
+
+    /**
+     * The C++ source implementing the circuit, exporting `void circuit_run(int32_t *values,
+     * const int32_t *constants)`.
+     */
+    [[nodiscard]]
+    static std::string generateSource(const CompiledCircuit& circuit);
+
+    [[nodiscard]]
+    static std::string getDefaultCompiler();
+
+private:
+    void build(const std::string& compiler);
+};
+
+#endif //CIRCUIT_NATIVE_EVALUATOR_H
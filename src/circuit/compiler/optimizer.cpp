@@ -0,0 +1,524 @@
+#include "optimizer.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+using OpCode = CompiledCircuit::OpCode;
+
+constexpr static uint32_t NO_NODE = UINT32_MAX;
+
+static bool isBoolOp(OpCode op) {
+    return op == CompiledCircuit::ConstTrue || op == CompiledCircuit::ConstBool || op == CompiledCircuit::Not
+           || op == CompiledCircuit::And || op == CompiledCircuit::CmpLe;
+}
+
+static bool isCommutative(OpCode op) {
+    return op == CompiledCircuit::And || op == CompiledCircuit::Add || op == CompiledCircuit::Mul;
+}
+
+/**
+ * The program as a graph of instructions ("nodes") in execution order, so that every node reads
+ * only nodes before it. Passes either rewrite a node in place or replace it with an earlier node,
+ * redirecting all of its readers there.
+ *
+ * Registers are inputs which read nothing during a run; the node they latch is kept apart in `next`,
+ * as it may come anywhere in the program and no pass may treat it as an operand.
+ *
+ * The Copy nodes of a sub-circuit instance are its outputs, which have to keep consecutive slots.
+ * They are never rewritten, and are kept or removed all together.
+ */
+struct OptimizerGraph {
+    struct Node {
+        OpCode op;
+        uint32_t in0 = NO_NODE, in1 = NO_NODE;
+        uint32_t next = NO_NODE;
+        int32_t imm = 0;
+        bool isInput = false;
+        bool isOutput = false;
+        // index of the gate the instruction was emitted for
+        uint32_t gate = CompiledCircuit::NO_INDEX;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> replacements;
+    // node computing the value of every compiled gate, NO_NODE for gates which are not evaluable
+    std::vector<uint32_t> gateNodes;
+
+    uint32_t resolve(uint32_t node) {
+        if (node == NO_NODE) return node;
+
+        uint32_t root = node;
+        while (replacements[root] != root) {
+            root = replacements[root];
+        }
+        while (replacements[node] != root) {
+            node = std::exchange(replacements[node], root);
+        }
+
+        return root;
+    }
+
+    [[nodiscard]]
+    bool isReplaced(uint32_t node) const { return replacements[node] != node; }
+
+    void replace(uint32_t node, uint32_t with) { replacements[node] = resolve(with); }
+
+    /**
+     * Returns the node with its inputs pointing at the nodes which replaced them.
+     */
+    Node& visit(uint32_t node) {
+        Node &n = nodes[node];
+        n.in0 = resolve(n.in0);
+        n.in1 = resolve(n.in1);
+        n.next = resolve(n.next);
+        return n;
+    }
+
+    [[nodiscard]]
+    bool isConstant(uint32_t node) const {
+        const Node &n = nodes[node];
+        return !n.isInput && (n.op == CompiledCircuit::ConstTrue || n.op == CompiledCircuit::ConstBool
+                              || n.op == CompiledCircuit::ConstInt);
+    }
+
+    [[nodiscard]]
+    int32_t getConstant(uint32_t node) const {
+        return nodes[node].op == CompiledCircuit::ConstTrue ? 1 : nodes[node].imm;
+    }
+
+    [[nodiscard]]
+    bool isConstant(uint32_t node, int32_t value) const { return isConstant(node) && getConstant(node) == value; }
+
+    void makeConstant(uint32_t node, int32_t value) {
+        Node &n = nodes[node];
+        n.op = isBoolOp(n.op) ? CompiledCircuit::ConstBool : CompiledCircuit::ConstInt;
+        n.imm = value;
+        n.in0 = n.in1 = NO_NODE;
+    }
+
+    bool isNegationOf(uint32_t node, uint32_t of) {
+        return nodes[node].op == CompiledCircuit::Not && resolve(nodes[node].in0) == of;
+    }
+};
+
+static size_t foldConstants(OptimizerGraph& graph) {
+    size_t folded = 0;
+
+    for (uint32_t i = 0; i < graph.nodes.size(); i++) {
+        if (graph.isReplaced(i)) continue;
+
+        const OptimizerGraph::Node &node = graph.visit(i);
+        if (node.isOutput || node.in0 == NO_NODE || !graph.isConstant(node.in0)) continue;
+        if (node.in1 != NO_NODE && !graph.isConstant(node.in1)) continue;
+
+        const int32_t a = graph.getConstant(node.in0);
+        const int32_t b = node.in1 != NO_NODE ? graph.getConstant(node.in1) : 0;
+        graph.makeConstant(i, CompiledCircuit::evaluate(node.op, node.imm, a, b));
+        folded++;
+    }
+
+    return folded;
+}
+
+static size_t removeDoubleNegations(OptimizerGraph& graph) {
+    size_t removed = 0;
+
+    for (uint32_t i = 0; i < graph.nodes.size(); i++) {
+        if (graph.isReplaced(i)) continue;
+
+        const OptimizerGraph::Node &node = graph.visit(i);
+        if (node.op != CompiledCircuit::Not) continue;
+
+        const OptimizerGraph::Node &inner = graph.nodes[node.in0];
+        if (inner.op == CompiledCircuit::Not) {
+            graph.replace(i, inner.in0);
+            removed++;
+        }
+    }
+
+    return removed;
+}
+
+static size_t simplifyAlgebra(OptimizerGraph& graph) {
+    size_t simplified = 0;
+
+    for (uint32_t i = 0; i < graph.nodes.size(); i++) {
+        if (graph.isReplaced(i)) continue;
+
+        const OptimizerGraph::Node &node = graph.visit(i);
+        const uint32_t a = node.in0, b = node.in1;
+        bool isSimplified = true;
+
+        if (node.op == CompiledCircuit::And) {
+            if (a == b) {
+                graph.replace(i, a);
+            } else if (graph.isConstant(a, 0) || graph.isConstant(b, 0)
+                       || graph.isNegationOf(a, b) || graph.isNegationOf(b, a)) {
+                graph.makeConstant(i, 0);
+            } else if (graph.isConstant(a, 1)) {
+                graph.replace(i, b);
+            } else if (graph.isConstant(b, 1)) {
+                graph.replace(i, a);
+            } else {
+                isSimplified = false;
+            }
+        } else if (node.op == CompiledCircuit::Add) {
+            if (graph.isConstant(a, 0)) {
+                graph.replace(i, b);
+            } else if (graph.isConstant(b, 0)) {
+                graph.replace(i, a);
+            } else {
+                isSimplified = false;
+            }
+        } else if (node.op == CompiledCircuit::Mul) {
+            if (graph.isConstant(a, 0) || graph.isConstant(b, 0)) {
+                graph.makeConstant(i, 0);
+            } else if (graph.isConstant(a, 1)) {
+                graph.replace(i, b);
+            } else if (graph.isConstant(b, 1)) {
+                graph.replace(i, a);
+            } else {
+                isSimplified = false;
+            }
+        } else if (node.op == CompiledCircuit::CmpLe && a == b) {
+            graph.makeConstant(i, 1);
+        } else {
+            isSimplified = false;
+        }
+
+        simplified += isSimplified;
+    }
+
+    return simplified;
+}
+
+struct NodeKey {
+    OpCode op;
+    uint32_t in0, in1;
+    int32_t imm;
+
+    bool operator==(const NodeKey&) const = default;
+};
+
+struct NodeKeyHash {
+    size_t operator()(const NodeKey& key) const {
+        uint64_t h = key.op;
+        h = h * 0x9E3779B97F4A7C15 + key.in0;
+        h = h * 0x9E3779B97F4A7C15 + key.in1;
+        h = h * 0x9E3779B97F4A7C15 + static_cast<uint32_t>(key.imm);
+        return static_cast<size_t>(h ^ (h >> 29));
+    }
+};
+
+static size_t mergeEquivalentGates(OptimizerGraph& graph) {
+    size_t merged = 0;
+    std::unordered_map<NodeKey, uint32_t, NodeKeyHash> seen;
+    seen.reserve(graph.nodes.size());
+
+    for (uint32_t i = 0; i < graph.nodes.size(); i++) {
+        if (graph.isReplaced(i)) continue;
+
+        const OptimizerGraph::Node &node = graph.visit(i);
+        // inputs have an identity of their own, even if two of them currently hold the same value
+        if (node.isInput || node.isOutput) continue;
+
+        NodeKey key = {node.op, node.in0, node.in1, node.imm};
+        if (key.op == CompiledCircuit::ConstTrue) {
+            key = {CompiledCircuit::ConstBool, NO_NODE, NO_NODE, 1};
+        }
+        if (isCommutative(key.op) && key.in0 > key.in1) {
+            std::swap(key.in0, key.in1);
+        }
+
+        const auto [it, isNew] = seen.try_emplace(key, i);
+        if (!isNew) {
+            graph.replace(i, it->second);
+            merged++;
+        }
+    }
+
+    return merged;
+}
+
+struct OptimizationPass {
+    bool OptimizationOptions::*enabled;
+    size_t OptimizationStats::*rewrites;
+    size_t (*run)(OptimizerGraph&);
+};
+
+constexpr static OptimizationPass PASSES[] = {
+        {&OptimizationOptions::foldConstants, &OptimizationStats::foldedConstants, foldConstants},
+        {&OptimizationOptions::removeDoubleNegations, &OptimizationStats::removedDoubleNegations, removeDoubleNegations},
+        {&OptimizationOptions::simplifyAlgebra, &OptimizationStats::simplifiedGates, simplifyAlgebra},
+        {&OptimizationOptions::mergeEquivalentGates, &OptimizationStats::mergedGates, mergeEquivalentGates},
+};
+
+OptimizationStats CircuitOptimizer::run(CompiledCircuit& circuit, const std::vector<uint32_t>& outputGates) const {
+    const CompiledCircuit::Program &program = circuit.program;
+    const size_t n = program.instructions.size();
+    const size_t gatesCount = program.gateSlotBase.size();
+
+    OptimizationStats stats;
+    stats.instructionsBefore = n;
+
+    // build the graph
+    OptimizerGraph graph;
+    std::vector<uint32_t> slotNodes(program.slotTypes.size(), NO_NODE);
+    std::vector<uint32_t> instructionGates(n, CompiledCircuit::NO_INDEX);
+
+    for (uint32_t i = 0; i < n; i++) {
+        slotNodes[program.instructions[i].out] = i;
+    }
+
+    std::vector<bool> keptInputs(gatesCount);
+    for (uint32_t g : options.keptInputs) {
+        if (g < gatesCount) {
+            keptInputs[g] = true;
+        }
+    }
+    for (uint32_t g = 0; g < gatesCount; g++) {
+        const uint32_t first = program.gateInstructions[g];
+        if (first == CompiledCircuit::NO_INSTRUCTION) continue;
+
+        // the outputs of an instance are all copied by consecutive instructions
+        const size_t outputsCount = program.instructions[first].op == CompiledCircuit::Copy
+                                    ? circuit.getOutputsCount(g) : 1;
+        for (uint32_t o = 0; o < outputsCount; o++) {
+            instructionGates[first + o] = g;
+        }
+    }
+
+    auto toNode = [&](CompiledCircuit::SlotIndex slot) {
+        return slot == CompiledCircuit::NO_SLOT ? NO_NODE : slotNodes[slot];
+    };
+
+    graph.nodes.resize(n);
+    graph.replacements.resize(n);
+    for (uint32_t i = 0; i < n; i++) {
+        const CompiledCircuit::Instruction &instruction = program.instructions[i];
+        const uint32_t gate = instructionGates[i];
+        const bool isCached = gate < circuit.cachedGates.size() && circuit.cachedGates[gate];
+
+        OptimizerGraph::Node &node = graph.nodes[i];
+        node.op = instruction.op;
+        node.in0 = toNode(instruction.in0);
+        node.in1 = toNode(instruction.in1);
+        node.imm = instruction.imm;
+        node.gate = gate;
+        node.isInput = (node.op == CompiledCircuit::ConstBool || node.op == CompiledCircuit::ConstInt)
+                       && !isCached && (!options.foldInputs || (gate < gatesCount && keptInputs[gate]));
+        node.isOutput = node.op == CompiledCircuit::Copy;
+
+        // the state of a register changes on every clock edge, so it is never folded either
+        if (node.op == CompiledCircuit::Register) {
+            node.next = std::exchange(node.in0, NO_NODE);
+            node.isInput = true;
+        }
+        graph.replacements[i] = i;
+    }
+
+    graph.gateNodes.resize(gatesCount);
+    for (uint32_t g = 0; g < gatesCount; g++) {
+        const CompiledCircuit::SlotIndex slot = program.gateSlotBase[g];
+        graph.gateNodes[g] = slot < program.evaluableSlotsCount ? slotNodes[slot] : NO_NODE;
+    }
+
+    // rewrite until nothing changes any more
+    for (size_t round = 0; round < MAX_ROUNDS; round++) {
+        size_t rewrites = 0;
+
+        for (const OptimizationPass &pass : PASSES) {
+            if (!(options.*pass.enabled)) continue;
+
+            const size_t passRewrites = pass.run(graph);
+            stats.*pass.rewrites += passRewrites;
+            rewrites += passRewrites;
+        }
+
+        if (rewrites == 0) break;
+    }
+
+    auto isSiblingOutput = [&](uint32_t node, uint32_t of) {
+        return graph.nodes[node].isOutput && graph.nodes[node].gate == graph.nodes[of].gate
+               && graph.nodes[of].gate != CompiledCircuit::NO_INDEX;
+    };
+
+    // a node is live if it computes the value of a kept gate or feeds one which does; inputs are
+    // always kept, so that they can still be set, and so is whatever registers latch
+    std::vector<bool> live(n, false);
+    size_t remaining = 0;
+
+    for (uint32_t i = 0; i < n; i++) {
+        if (graph.isReplaced(i)) continue;
+
+        graph.visit(i);
+        remaining++;
+        live[i] = !options.removeDeadGates || graph.nodes[i].isInput;
+    }
+
+    if (options.removeDeadGates) {
+        auto markGate = [&](uint32_t g) {
+            const uint32_t node = graph.resolve(graph.gateNodes[g]);
+            if (node != NO_NODE) {
+                live[node] = true;
+            }
+        };
+
+        if (outputGates.empty()) {
+            for (uint32_t g = 0; g < gatesCount; g++) {
+                markGate(g);
+            }
+        } else {
+            for (uint32_t g : outputGates) {
+                if (g >= gatesCount) {
+                    throw std::runtime_error("output gate index out of range");
+                }
+                markGate(g);
+            }
+        }
+
+        // registers may latch nodes after them, so a single backward sweep is not enough
+        std::vector<uint32_t> stack;
+        for (uint32_t i = 0; i < n; i++) {
+            if (live[i]) stack.push_back(i);
+        }
+
+        auto mark = [&](uint32_t node) {
+            if (node != NO_NODE && !live[node]) {
+                live[node] = true;
+                stack.push_back(node);
+            }
+        };
+
+        while (!stack.empty()) {
+            const uint32_t i = stack.back();
+            const OptimizerGraph::Node &node = graph.nodes[i];
+            stack.pop_back();
+
+            mark(node.in0);
+            mark(node.in1);
+            mark(node.next);
+
+            // an instance keeps either all of its outputs or none
+            if (node.isOutput) {
+                if (i > 0 && isSiblingOutput(i - 1, i)) mark(i - 1);
+                if (i + 1 < n && isSiblingOutput(i + 1, i)) mark(i + 1);
+            }
+        }
+    }
+
+    // levelize the remaining nodes, same as the compiler does
+    std::vector<uint32_t> levels(n, 0);
+    uint32_t maxLevel = 0;
+    size_t liveCount = 0;
+
+    for (uint32_t i = 0; i < n; i++) {
+        if (!live[i]) continue;
+
+        const OptimizerGraph::Node &node = graph.nodes[i];
+        if (node.in0 != NO_NODE) levels[i] = std::max(levels[i], levels[node.in0] + 1);
+        if (node.in1 != NO_NODE) levels[i] = std::max(levels[i], levels[node.in1] + 1);
+        maxLevel = std::max(maxLevel, levels[i]);
+        liveCount++;
+
+        // the outputs of an instance share the level of the deepest one, so that they stay next to
+        // each other in the schedule; anything reading them comes after the last one
+        if (node.isOutput && !(i + 1 < n && isSiblingOutput(i + 1, i))) {
+            uint32_t first = i;
+            while (first > 0 && isSiblingOutput(first - 1, i)) {
+                levels[i] = std::max(levels[i], levels[--first]);
+            }
+            std::fill(levels.begin() + first, levels.begin() + i, levels[i]);
+        }
+    }
+
+    stats.removedDeadGates = remaining - liveCount;
+    stats.instructionsAfter = liveCount;
+
+    decltype(circuit.storage) storage;
+    auto &[instructions, levelOffsets, slotTypes, gateSlotBase, gateInstructions] = storage;
+
+    const size_t levelsCount = liveCount == 0 ? 0 : maxLevel + 1;
+    levelOffsets.assign(levelsCount + 1, 0);
+    for (uint32_t i = 0; i < n; i++) {
+        if (live[i]) levelOffsets[levels[i] + 1]++;
+    }
+    for (size_t l = 0; l < levelsCount; l++) {
+        levelOffsets[l + 1] += levelOffsets[l];
+    }
+
+    std::vector<uint32_t> sorted(liveCount);
+    std::vector<uint64_t> cursor(levelOffsets.begin(), levelOffsets.end() - 1);
+    for (uint32_t i = 0; i < n; i++) {
+        if (live[i]) sorted[cursor[levels[i]]++] = i;
+    }
+
+    // every node has exactly one output, so its slot is its position in the schedule
+    std::vector<CompiledCircuit::SlotIndex> nodeSlots(n, CompiledCircuit::NO_SLOT);
+    for (uint32_t k = 0; k < liveCount; k++) {
+        const uint32_t i = sorted[k];
+        nodeSlots[i] = k;
+
+        // registers and copies are the only nodes which come in both types; they keep the one they had
+        if (graph.nodes[i].op == CompiledCircuit::Register || graph.nodes[i].op == CompiledCircuit::Copy) {
+            slotTypes.push_back(program.slotTypes[program.instructions[i].out]);
+        } else {
+            slotTypes.push_back(isBoolOp(graph.nodes[i].op) ? CircuitGate::Bool : CircuitGate::Int);
+        }
+    }
+
+    const auto evaluableSlotsCount = static_cast<CompiledCircuit::SlotIndex>(slotTypes.size());
+
+    gateSlotBase.resize(gatesCount);
+    for (uint32_t g = 0; g < gatesCount; g++) {
+        const uint32_t node = graph.resolve(graph.gateNodes[g]);
+        if (node != NO_NODE && live[node]) {
+            gateSlotBase[g] = nodeSlots[node];
+            continue;
+        }
+
+        // gates which are no longer evaluated get slots past the evaluable ones, like blocked gates
+        const CompiledCircuit::SlotIndex oldSlot = program.gateSlotBase[g];
+        gateSlotBase[g] = slotTypes.size();
+        for (size_t o = 0; o < circuit.getOutputsCount(g); o++) {
+            slotTypes.push_back(program.slotTypes[oldSlot + o]);
+        }
+    }
+
+    std::vector<uint32_t> newInstructionGates;
+    newInstructionGates.reserve(liveCount);
+    instructions.reserve(liveCount);
+    gateInstructions.assign(gatesCount, CompiledCircuit::NO_INSTRUCTION);
+
+    for (uint32_t i : sorted) {
+        const OptimizerGraph::Node &node = graph.nodes[i];
+
+        CompiledCircuit::Instruction instruction;
+        instruction.op = node.op;
+        instruction.in0 = node.in0 == NO_NODE ? CompiledCircuit::NO_SLOT : nodeSlots[node.in0];
+        if (node.next != NO_NODE) {
+            instruction.in0 = nodeSlots[node.next];
+        }
+        instruction.in1 = node.in1 == NO_NODE ? CompiledCircuit::NO_SLOT : nodeSlots[node.in1];
+        instruction.out = nodeSlots[i];
+        instruction.imm = node.imm;
+
+        // only inputs and outputs of instances still belong to their gate; everything else may be
+        // shared or rewritten
+        const bool isOwned = (node.isInput || node.isOutput) && node.gate != CompiledCircuit::NO_INDEX;
+        if (isOwned && gateInstructions[node.gate] == CompiledCircuit::NO_INSTRUCTION) {
+            gateInstructions[node.gate] = instructions.size();
+        }
+        newInstructionGates.push_back(isOwned ? node.gate : CompiledCircuit::NO_INDEX);
+        instructions.push_back(instruction);
+    }
+
+    circuit.storage = std::move(storage);
+    circuit.instructionGates = std::move(newInstructionGates);
+    circuit.program.evaluableSlotsCount = evaluableSlotsCount;
+    circuit.bindStorage();
+
+    return stats;
+}
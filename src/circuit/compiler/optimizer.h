@@ -0,0 +1,62 @@
+#ifndef CIRCUIT_OPTIMIZER_H
+#define CIRCUIT_OPTIMIZER_H
+
+#include "compiled-circuit.h"
+#include <cstddef>
+#include <vector>
+
+struct OptimizationOptions {
+    bool foldConstants = true;
+    bool removeDoubleNegations = true;
+    bool simplifyAlgebra = true;
+    bool mergeEquivalentGates = true;
+    bool removeDeadGates = true;
+
+    // ConstBool and ConstInt gates are inputs, which `setConstant()` and the batch evaluator can
+    // still change, so by default nothing is folded into the gates reading them. With this set their
+    // current values are taken as final, and they can no longer be changed after optimizing.
+    bool foldInputs = false;
+
+    // with foldInputs, the input gates which are left to take values all the same, by gate index
+    std::vector<uint32_t> keptInputs;
+};
+
+struct OptimizationStats {
+    size_t instructionsBefore = 0;
+    size_t instructionsAfter = 0;
+
+    // rewrites made by each pass, summed over all rounds
+    size_t foldedConstants = 0;
+    size_t removedDoubleNegations = 0;
+    size_t simplifiedGates = 0;
+    size_t mergedGates = 0;
+    size_t removedDeadGates = 0;
+};
+
+/**
+ * Rewrites a compiled program into an equivalent, smaller one. The rewriting passes (constant
+ * folding, double negation removal, algebraic simplification and structural hashing, which merges
+ * gates computing the same function of the same inputs) are repeated until none of them changes
+ * anything, as each one can create work for the others. Dead gate elimination runs last.
+ *
+ * Gates whose instruction was merged into another one or simplified away keep their value: their
+ * slot becomes the slot of the instruction now computing it. Input gates are never rewritten, so
+ * they can still be set and driven, and neither are registers, whose state changes every clock
+ * cycle. Only gates which reach neither a requested output nor a register stop being evaluable.
+ */
+class CircuitOptimizer {
+    OptimizationOptions options;
+
+    constexpr static size_t MAX_ROUNDS = 16;
+
+public:
+    explicit CircuitOptimizer(const OptimizationOptions& _options = {}) : options(_options) { }
+
+    /**
+     * Optimizes `circuit` in place, keeping the values of the gates with the given indices.
+     * With no outputs given, the values of all compiled gates are kept.
+     */
+    OptimizationStats run(CompiledCircuit& circuit, const std::vector<uint32_t>& outputGates = {}) const;
+};
+
+#endif //CIRCUIT_OPTIMIZER_H
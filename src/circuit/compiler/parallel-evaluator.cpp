@@ -0,0 +1,30 @@
+#include "parallel-evaluator.h"
+
+#include <algorithm>
+
+ParallelEvaluator::ParallelEvaluator(CompiledCircuit& _circuit, size_t threadsCount)
+    : circuit(_circuit), pool(threadsCount) {
+}
+
+void ParallelEvaluator::run() {
+    const std::span<const uint64_t> offsets = circuit.getLevelOffsets();
+
+    for (size_t level = 0; level < circuit.getLevelsCount(); level++) {
+        const size_t begin = offsets[level];
+        const size_t end = offsets[level + 1];
+        const size_t size = end - begin;
+
+        if (size < MIN_PARALLEL_LEVEL_SIZE || pool.getParticipantsCount() == 1) {
+            circuit.runRange(begin, end);
+            continue;
+        }
+
+        const size_t chunksCount = std::min(size / MIN_CHUNK_SIZE, pool.getParticipantsCount() * CHUNKS_PER_THREAD);
+        const size_t chunkSize = (size + chunksCount - 1) / chunksCount;
+
+        pool.parallelFor(chunksCount, [&](size_t chunk) {
+            const size_t chunkBegin = begin + chunk * chunkSize;
+            circuit.runRange(chunkBegin, std::min(chunkBegin + chunkSize, end));
+        });
+    }
+}
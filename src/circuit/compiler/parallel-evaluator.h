@@ -0,0 +1,27 @@
+#ifndef CIRCUIT_PARALLEL_EVALUATOR_H
+#define CIRCUIT_PARALLEL_EVALUATOR_H
+
+#include "compiled-circuit.h"
+#include "thread-pool.h"
+
+/**
+ * Runs a compiled circuit level by level, splitting every sufficiently wide level into chunks
+ * which are spread over a work-stealing thread pool. Each instruction writes only its own slot
+ * and reads slots of earlier levels, so the results are identical to `CompiledCircuit::run()`.
+ */
+class ParallelEvaluator {
+    CompiledCircuit &circuit;
+    ThreadPool pool;
+
+    // levels narrower than this are not worth the synchronization and run on the calling thread
+    constexpr static size_t MIN_PARALLEL_LEVEL_SIZE = 4096;
+    constexpr static size_t MIN_CHUNK_SIZE = 1024;
+    constexpr static size_t CHUNKS_PER_THREAD = 4;
+
+public:
+    explicit ParallelEvaluator(CompiledCircuit& _circuit, size_t threadsCount = std::thread::hardware_concurrency());
+
+    void run();
+};
+
+#endif //CIRCUIT_PARALLEL_EVALUATOR_H
@@ -0,0 +1,101 @@
+#include "thread-pool.h"
+
+ThreadPool::ThreadPool(size_t threadsCount) {
+    // queue 0 belongs to whoever calls parallelFor(), the rest to the workers
+    const size_t workersCount = threadsCount > 1 ? threadsCount - 1 : 0;
+
+    for (size_t i = 0; i <= workersCount; i++) {
+        queues.push_back(std::make_unique<TaskQueue>());
+    }
+
+    for (size_t i = 1; i <= workersCount; i++) {
+        threads.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::parallelFor(size_t tasksCount, const std::function<void(size_t)>& task) {
+    if (tasksCount == 0) return;
+
+    currentTask = &task;
+    remainingTasks = tasksCount;
+
+    for (size_t i = 0; i < tasksCount; i++) {
+        TaskQueue &queue = *queues[i % queues.size()];
+        std::lock_guard lock(queue.mutex);
+        queue.tasks.push_back(i);
+    }
+
+    {
+        std::lock_guard lock(mutex);
+        generation++;
+    }
+    wakeUp.notify_all();
+
+    while (remainingTasks > 0) {
+        if (!runOneTask(0)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void ThreadPool::workerLoop(size_t queueIndex) {
+    uint64_t seenGeneration = 0;
+
+    while (true) {
+        {
+            std::unique_lock lock(mutex);
+            wakeUp.wait(lock, [&] { return stopping || generation != seenGeneration; });
+            if (stopping) return;
+            seenGeneration = generation;
+        }
+
+        while (remainingTasks > 0) {
+            if (!runOneTask(queueIndex)) {
+                std::this_thread::yield();
+            }
+        }
+    }
+}
+
+bool ThreadPool::runOneTask(size_t queueIndex) {
+    size_t task = 0;
+    bool found = false;
+
+    {
+        TaskQueue &own = *queues[queueIndex];
+        std::lock_guard lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = own.tasks.back();
+            own.tasks.pop_back();
+            found = true;
+        }
+    }
+
+    for (size_t i = 1; !found && i < queues.size(); i++) {
+        TaskQueue &victim = *queues[(queueIndex + i) % queues.size()];
+        std::lock_guard lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            found = true;
+        }
+    }
+
+    if (!found) return false;
+
+    (*currentTask)(task);
+    remainingTasks--;
+    return true;
+}
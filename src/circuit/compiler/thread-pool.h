@@ -0,0 +1,61 @@
+#ifndef CIRCUIT_THREAD_POOL_H
+#define CIRCUIT_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed set of worker threads executing batches of indexed tasks. Every participant (the workers
+ * and the thread which submitted the batch) owns a task queue: it takes work from the back of its
+ * own queue and, once that is empty, steals from the front of the others, so uneven tasks even out.
+ */
+class ThreadPool {
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+
+    std::vector<std::unique_ptr<TaskQueue>> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    uint64_t generation = 0;
+    bool stopping = false;
+
+    const std::function<void(size_t)> *currentTask = nullptr;
+    std::atomic<size_t> remainingTasks = 0;
+
+public:
+    explicit ThreadPool(size_t threadsCount = std::thread::hardware_concurrency());
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * Number of threads taking part in a batch, including the caller of `parallelFor()`.
+     */
+    [[nodiscard]]
+    size_t getParticipantsCount() const { return queues.size(); }
+
+    /**
+     * Calls `task(i)` for every `i` in `[0, tasksCount)` and returns once all of them finished.
+     */
+    void parallelFor(size_t tasksCount, const std::function<void(size_t)>& task);
+
+private:
+    void workerLoop(size_t queueIndex);
+
+    bool runOneTask(size_t queueIndex);
+};
+
+#endif //CIRCUIT_THREAD_POOL_H
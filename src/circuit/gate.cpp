@@ -1,37 +1,211 @@
 #include "gate.h"
 
-bool CircuitGate::canEval() const {
-    for (const auto &input : inputs) {
-        if (!input.destGate) {
-            std::cout << getId() << " failed! no input\n";
-            return false;
+#include <stdexcept>
+
+uint64_t CircuitGate::lastEpoch = 0;
+
+CircuitGate::CircuitGate(CircuitGraph& _graph, std::initializer_list<PinType> inTypes,
+                         std::initializer_list<PinType> outTypes, Position _pos)
+    : CircuitGate(_graph, std::span(inTypes.begin(), inTypes.size()), std::span(outTypes.begin(), outTypes.size()),
+                  _pos) { }
+
+CircuitGate::CircuitGate(CircuitGraph& _graph, std::span<const PinType> inTypes, std::span<const PinType> outTypes,
+                         Position _pos)
+    : graph(&_graph), id(_graph.gates.size()), firstInput(_graph.inputs.size()), firstOutput(_graph.outputs.size()),
+      inputsCount(inTypes.size()), outputsCount(outTypes.size()), pos(_pos) {
+    if (inTypes.size() > MAX_PINS || outTypes.size() > MAX_PINS) {
+        throw std::runtime_error("too many pins");
+    }
+
+    for (PinType type : inTypes) {
+        InputPin &pin = graph->inputs.emplace_back();
+        pin.type = type;
+        pin.owner = id;
+    }
+
+    for (PinType type : outTypes) {
+        graph->outputs.add(type);
+    }
+
+    graph->gates.push_back(this);
+    graph->revision++;
+}
+
+void CircuitGate::removeFanout(PinIndex pin) {
+    for (PinIndex *link = &firstFanout; *link != NO_PIN; link = &graph->inputs[*link].nextFanout) {
+        if (*link == pin) {
+            *link = graph->inputs[pin].nextFanout;
+            graph->inputs[pin].nextFanout = NO_PIN;
+            return;
         }
     }
+}
+
+CircuitGate::OutputPin CircuitGate::getOutput(size_t index) const {
+    const PinValues &values = graph->outputs;
+    const PinIndex pin = firstOutput + index;
+
+    OutputPin output;
+    output.type = values.getType(pin);
+    output.isEval = values.isEvaluated(pin);
+    output.value = output.type == Bool ? values.getBool(pin) : values.getInt(pin);
+    return output;
+}
+
+bool CircuitGate::isEvaluated() const {
+    for (size_t i = 0; i < outputsCount; i++) {
+        if (!graph->outputs.isEvaluated(firstOutput + i)) return false;
+    }
 
     return true;
 }
 
-void CircuitGate::clearCaches() {
-    for (auto &output : outputs) {
-        output.isEval = false;
+void CircuitGate::storeOutput(size_t index, int32_t value) const {
+    if (getOutputType(index) == Bool) {
+        graph->outputs.setBool(firstOutput + index, value != 0);
+    } else {
+        graph->outputs.setInt(firstOutput + index, value);
+    }
+}
+
+void CircuitGate::invalidateOutputs() const {
+    for (size_t i = 0; i < outputsCount; i++) {
+        graph->outputs.invalidate(firstOutput + i);
+    }
+}
+
+void CircuitGate::updateInput(GateID destGate, size_t destSlotIndex, size_t index) {
+    if (index >= inputsCount) {
+        throw std::runtime_error("index too large in updateInput");
+    }
+    if (destGate != NO_GATE && (destGate >= graph->gates.size()
+                                || destSlotIndex >= graph->gates[destGate]->getOutputsCount())) {
+        throw std::runtime_error("no such output in updateInput");
+    }
+
+    const PinIndex pinIndex = firstInput + index;
+    InputPin &pin = graph->inputs[pinIndex];
+
+    if (pin.destGate != NO_GATE) {
+        graph->gates[pin.destGate]->removeFanout(pinIndex);
+    }
+
+    pin.destGate = destGate;
+    pin.destSlotIndex = destSlotIndex;
+
+    if (destGate != NO_GATE) {
+        CircuitGate &source = *graph->gates[destGate];
+        pin.nextFanout = source.firstFanout;
+        source.firstFanout = pinIndex;
     }
 
-    for (const auto &input : inputs) {
-        if (input.destGate) {
-            input.destGate->clearCaches();
+    graph->revision++;
+    invalidate();
+}
+
+void CircuitGate::invalidate() {
+    std::vector<CircuitGate *> stack = {this};
+
+    while (!stack.empty()) {
+        CircuitGate *gate = stack.back();
+        stack.pop_back();
+
+        gate->invalidateOutputs();
+
+        // an evaluated gate always has an evaluated fan-in, so an unevaluated consumer means its
+        // whole fan-out cone has already been invalidated
+        gate->forEachFanout([&](CircuitGate &consumer) {
+            if (consumer.isEvaluated()) {
+                stack.push_back(&consumer);
+            }
+        });
+    }
+}
+
+void CircuitGate::clearCaches() {
+    const uint64_t epoch = newEpoch();
+    std::vector<CircuitGate *> stack = {this};
+    visitEpoch = epoch;
+
+    while (!stack.empty()) {
+        CircuitGate *gate = stack.back();
+        stack.pop_back();
+
+        // the fan-out goes too, so that no evaluated gate is left with an unevaluated input; it is
+        // walked only as far as it is still evaluated, which keeps the whole clearing linear
+        gate->invalidate();
+
+        for (const auto &input : gate->getInputs()) {
+            if (input.destGate == NO_GATE) continue;
+
+            CircuitGate *source = graph->gates[input.destGate];
+            if (source->visitEpoch != epoch) {
+                source->visitEpoch = epoch;
+                stack.push_back(source);
+            }
         }
     }
 }
 
 void CircuitGate::print() const {
-    std::cout << getId();
-    for (const auto &output : outputs) {
-        std::cout << " " << std::boolalpha;
-        std::visit([](auto &v) { std::cout << v; }, output.value);
+    const uint64_t epoch = newEpoch();
+    std::vector<const CircuitGate *> stack = {this};
+
+    while (!stack.empty()) {
+        const CircuitGate *gate = stack.back();
+        stack.pop_back();
+
+        std::cout << gate->getId();
+
+        // a gate reachable along several paths is only expanded the first time it is printed
+        if (gate->visitEpoch == epoch) {
+            std::cout << " (see above)\n";
+            continue;
+        }
+        gate->visitEpoch = epoch;
+
+        for (size_t i = 0; i < gate->outputsCount; i++) {
+            const OutputPin output = gate->getOutput(i);
+            std::cout << " " << std::boolalpha;
+            if (output.type == Bool) {
+                std::cout << (output.value != 0);
+            } else {
+                std::cout << output.value;
+            }
+        }
+        std::cout << "\n";
+
+        const std::span<const InputPin> inputs = gate->getInputs();
+        for (auto it = inputs.rbegin(); it != inputs.rend(); it++) {
+            if (it->destGate != NO_GATE) {
+                stack.push_back(graph->gates[it->destGate]);
+            }
+        }
     }
-    std::cout << "\n";
+}
 
-    for (const auto &input : inputs) {
-        input.destGate->print();
+PinValues::PinIndex PinValues::add(CircuitGate::PinType type) {
+    if (type != CircuitGate::Int && type != CircuitGate::Bool) {
+        throw std::runtime_error("output pins are either Int or Bool");
     }
+
+    const PinIndex pin = pinsCount++;
+    if (pin % WORD_BITS == 0) {
+        intRanks.push_back(ints.size());
+        intPins.push_back(0);
+        evaluated.push_back(0);
+        bools.push_back(0);
+    }
+
+    if (type == CircuitGate::Int) {
+        intPins.back() |= Word(1) << (pin % WORD_BITS);
+        ints.push_back(0);
+    }
+
+    return pin;
+}
+
+size_t PinValues::getMemoryUsage() const {
+    return (intPins.capacity() + evaluated.capacity() + bools.capacity()) * sizeof(Word)
+           + intRanks.capacity() * sizeof(uint32_t) + ints.capacity() * sizeof(int32_t);
 }
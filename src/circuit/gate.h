@@ -1,62 +1,93 @@
 #ifndef CIRCUIT_GATE_H
 #define CIRCUIT_GATE_H
 
-#include "../../deps/imgui/imgui.h"
-#include <memory>
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 #include <iostream>
-#include <variant>
 
 struct CircuitVisitor;
+struct CircuitGraph;
 
+/**
+ * A gate of a circuit. Gates are owned by a `Circuit` and refer to each other by `GateID`, which is
+ * the gate's index in its circuit. Their pins live in flat arrays shared by the whole circuit.
+ */
 struct CircuitGate {
-    using GateID = int;
-    using GatePtr = std::shared_ptr<CircuitGate>;
-    enum PinType {UNSET, Any, Int, Bool};
+    using GateID = uint32_t;
+    using PinIndex = uint32_t;
+    constexpr static GateID NO_GATE = UINT32_MAX;
+    constexpr static PinIndex NO_PIN = UINT32_MAX;
+    constexpr static size_t MAX_PINS = UINT8_MAX;
+    enum PinType : uint8_t {UNSET, Any, Int, Bool};
 
     struct InputPin {
         PinType type = UNSET;
-        GatePtr destGate;
-        size_t destSlotIndex = 0;
+        uint16_t destSlotIndex = 0;
+        GateID destGate = NO_GATE;
+        GateID owner = NO_GATE;
+
+        // next input pin connected to the same gate as this one, forming the fan-out list of `destGate`
+        PinIndex nextFanout = NO_PIN;
+    };
+
+    /**
+     * Where the gate is drawn by the editor, in canvas coordinates. The core only keeps it, so that
+     * netlists can store the layout.
+     */
+    struct Position {
+        float x = 0, y = 0;
     };
 
+    /**
+     * A copy of the state of an output pin, which is stored split by type, see `PinValues`. The value
+     * of a Bool pin is 0 or 1.
+     */
     struct OutputPin {
         PinType type = UNSET;
-        std::variant<int, bool> value;
         bool isEval = false;
+        int32_t value = 0;
     };
 
     friend struct CircuitVisitor_Eval;
+    friend class CompiledCircuit;
 
 private:
-    static GateID nextId;
+    static uint64_t lastEpoch;
+    CircuitGraph *graph;
     GateID id;
-    std::vector<InputPin> inputs;
-    std::vector<OutputPin> outputs;
-    size_t inputsCount, outputsCount;
+    PinIndex firstInput, firstOutput;
+    PinIndex firstFanout = NO_PIN;
+    uint8_t inputsCount, outputsCount;
+    mutable uint64_t visitEpoch = 0;
 
 public:
-    ImVec2 pos;
-
-    explicit CircuitGate(std::initializer_list<PinType> inTypes, std::initializer_list<PinType> outTypes, ImVec2 _pos)
-        : id(nextId++), inputsCount(inTypes.size()), outputsCount(outTypes.size()), pos(_pos) {
-        inputs.resize(inputsCount);
-        outputs.resize(outputsCount);
-
-        auto it = inTypes.begin();
-        for (size_t i = 0; i < inputsCount; i++, it++) {
-            inputs[i].type = *it;
-        }
-
-        it = outTypes.begin();
-        for (size_t i = 0; i < outputsCount; i++, it++) {
-            outputs[i].type = *it;
-        }
-    }
+    Position pos;
+
+    /**
+     * Registers the gate in `graph`. Gates are only meant to be created through `Circuit::add`,
+     * which also provides the storage for them.
+     */
+    explicit CircuitGate(CircuitGraph& _graph, std::initializer_list<PinType> inTypes,
+                         std::initializer_list<PinType> outTypes, Position _pos);
+
+    /**
+     * Same as above, for gates whose pins are only known at runtime. Throws if there are more
+     * than MAX_PINS inputs or outputs.
+     */
+    explicit CircuitGate(CircuitGraph& _graph, std::span<const PinType> inTypes, std::span<const PinType> outTypes,
+                         Position _pos);
 
     virtual ~CircuitGate() = default;
 
+    CircuitGate(const CircuitGate&) = delete;
+
+    CircuitGate& operator=(const CircuitGate&) = delete;
+
     [[nodiscard]]
     GateID getId() const { return id; }
 
@@ -67,41 +98,219 @@ public:
     size_t getOutputsCount() const { return outputsCount; }
 
     [[nodiscard]]
-    const std::vector<InputPin>& getInputs() const { return inputs; }
+    std::span<const InputPin> getInputs() const;
 
     [[nodiscard]]
-    const InputPin& getInput(size_t index) const { return inputs[index]; }
+    const InputPin& getInput(size_t index) const;
 
     [[nodiscard]]
-    const OutputPin& getOutput(size_t index) const { return outputs[index]; }
+    OutputPin getOutput(size_t index) const;
 
     [[nodiscard]]
-    const OutputPin& getOutputForInput(size_t index) {
-        return inputs[index].destGate->getOutput(inputs[index].destSlotIndex);
-    }
+    PinType getOutputType(size_t index) const;
+
+    [[nodiscard]]
+    CircuitGate& getInputGate(size_t index) const;
+
+    [[nodiscard]]
+    OutputPin getOutputForInput(size_t index) const;
 
     [[nodiscard]]
     virtual std::string getName() const = 0;
 
-    void updateInput(GatePtr destGate, size_t destSlotIndex, size_t index) {
-        if (index >= inputsCount) {
-            throw std::runtime_error("index too large in updateInput");
-        }
+    [[nodiscard]]
+    bool hasFanouts() const { return firstFanout != NO_PIN; }
 
-        inputs[index].destGate = destGate;
-        inputs[index].destSlotIndex = destSlotIndex;
-    }
+    /**
+     * Calls `fn(CircuitGate& consumer)` once for every input pin connected to this gate.
+     */
+    template<typename F>
+    void forEachFanout(F&& fn) const;
 
     [[nodiscard]]
-    bool canEval() const;
+    bool isEvaluated() const;
+
+    /**
+     * Connects input `index` to output `destSlotIndex` of gate `destGate`, or disconnects it if
+     * `destGate` is NO_GATE.
+     */
+    void updateInput(GateID destGate, size_t destSlotIndex, size_t index);
+
+    /**
+     * Discards the cached outputs of this gate and of its whole transitive fan-out, leaving every
+     * other cached value intact. Must be called whenever something the outputs depend on changes.
+     */
+    void invalidate();
 
     virtual void acceptVisitor(CircuitVisitor& visitor) = 0;
 
+    /**
+     * Returns a fresh traversal epoch. A gate whose `visitEpoch` equals the current epoch has
+     * already been seen by the ongoing traversal, which keeps walks over shared sub-DAGs linear.
+     */
+    static uint64_t newEpoch() { return ++lastEpoch; }
+
+    /**
+     * Discards the cached outputs of this gate and of its whole transitive fan-in, together with
+     * everything depending on them, so that all of it is evaluated again from scratch.
+     */
     void clearCaches();
 
     void print() const;
+
+private:
+    [[nodiscard]]
+    PinIndex getSourcePin(size_t index) const;
+
+    /**
+     * Typed reads and writes for evaluation, which knows the pin types from the gate types and skips
+     * checking them. Writing an output marks it as evaluated.
+     */
+    template<typename T>
+    [[nodiscard]]
+    T getInputValue(size_t index) const;
+
+    template<typename T>
+    void setOutputValue(size_t index, T value) const;
+
+    /**
+     * Writes an output of either type, a Bool one being set by any nonzero value.
+     */
+    void storeOutput(size_t index, int32_t value) const;
+
+    void invalidateOutputs() const;
+
+    void removeFanout(PinIndex pin);
+};
+
+/**
+ * The values of every output pin of a circuit, indexed by pin. Each type has storage of its own: Bool
+ * values are a packed bitset, Int values a dense array of the Int pins alone, and whether a pin is
+ * evaluated is a separate bitmap. Pins only ever get appended and never change type, so the position
+ * of an Int value is the number of Int pins before it, counted once per word of the type bitmap.
+ */
+class PinValues {
+    using Word = uint64_t;
+    using PinIndex = CircuitGate::PinIndex;
+    constexpr static size_t WORD_BITS = 64;
+
+    std::vector<Word> intPins, evaluated, bools;
+    // the Int pins before every word of `intPins`
+    std::vector<uint32_t> intRanks;
+    std::vector<int32_t> ints;
+    size_t pinsCount = 0;
+
+public:
+    /**
+     * Appends an unevaluated pin. Output pins are either Int or Bool.
+     */
+    PinIndex add(CircuitGate::PinType type);
+
+    [[nodiscard]]
+    size_t size() const { return pinsCount; }
+
+    [[nodiscard]]
+    CircuitGate::PinType getType(PinIndex pin) const {
+        return getBit(intPins, pin) ? CircuitGate::Int : CircuitGate::Bool;
+    }
+
+    [[nodiscard]]
+    bool isEvaluated(PinIndex pin) const { return getBit(evaluated, pin); }
+
+    [[nodiscard]]
+    bool getBool(PinIndex pin) const { return getBit(bools, pin); }
+
+    [[nodiscard]]
+    int32_t getInt(PinIndex pin) const { return ints[getIntIndex(pin)]; }
+
+    void setBool(PinIndex pin, bool value) {
+        const Word bit = Word(1) << (pin % WORD_BITS);
+        bools[pin / WORD_BITS] = (bools[pin / WORD_BITS] & ~bit) | (Word(value) << (pin % WORD_BITS));
+        evaluated[pin / WORD_BITS] |= bit;
+    }
+
+    void setInt(PinIndex pin, int32_t value) {
+        ints[getIntIndex(pin)] = value;
+        evaluated[pin / WORD_BITS] |= Word(1) << (pin % WORD_BITS);
+    }
+
+    void invalidate(PinIndex pin) { evaluated[pin / WORD_BITS] &= ~(Word(1) << (pin % WORD_BITS)); }
+
+    [[nodiscard]]
+    size_t getMemoryUsage() const;
+
+private:
+    static bool getBit(const std::vector<Word>& bits, PinIndex pin) {
+        return (bits[pin / WORD_BITS] >> (pin % WORD_BITS)) & 1;
+    }
+
+    [[nodiscard]]
+    size_t getIntIndex(PinIndex pin) const {
+        const Word before = (Word(1) << (pin % WORD_BITS)) - 1;
+        return intRanks[pin / WORD_BITS] + std::popcount(intPins[pin / WORD_BITS] & before);
+    }
 };
 
-using CircuitGatePtr = std::shared_ptr<CircuitGate>;
+/**
+ * The gate table and the pins of every gate of one circuit, stored back to back. Owned by `Circuit`,
+ * which keeps it at a stable address so that gates can point to it.
+ */
+struct CircuitGraph {
+    std::vector<CircuitGate *> gates;
+    std::vector<CircuitGate::InputPin> inputs;
+    PinValues outputs;
+
+    // bumped by every change to the gates or their links
+    uint64_t revision = 0;
+};
+
+inline std::span<const CircuitGate::InputPin> CircuitGate::getInputs() const {
+    return {graph->inputs.data() + firstInput, inputsCount};
+}
+
+inline const CircuitGate::InputPin& CircuitGate::getInput(size_t index) const {
+    return graph->inputs[firstInput + index];
+}
+
+inline CircuitGate::PinType CircuitGate::getOutputType(size_t index) const {
+    return graph->outputs.getType(firstOutput + index);
+}
+
+inline CircuitGate& CircuitGate::getInputGate(size_t index) const {
+    return *graph->gates[getInput(index).destGate];
+}
+
+inline CircuitGate::OutputPin CircuitGate::getOutputForInput(size_t index) const {
+    return getInputGate(index).getOutput(getInput(index).destSlotIndex);
+}
+
+inline CircuitGate::PinIndex CircuitGate::getSourcePin(size_t index) const {
+    return getInputGate(index).firstOutput + getInput(index).destSlotIndex;
+}
+
+template<typename T>
+T CircuitGate::getInputValue(size_t index) const {
+    if constexpr (std::is_same_v<T, bool>) {
+        return graph->outputs.getBool(getSourcePin(index));
+    } else {
+        return graph->outputs.getInt(getSourcePin(index));
+    }
+}
+
+template<typename T>
+void CircuitGate::setOutputValue(size_t index, T value) const {
+    if constexpr (std::is_same_v<T, bool>) {
+        graph->outputs.setBool(firstOutput + index, value);
+    } else {
+        graph->outputs.setInt(firstOutput + index, value);
+    }
+}
+
+template<typename F>
+void CircuitGate::forEachFanout(F&& fn) const {
+    for (PinIndex pin = firstFanout; pin != NO_PIN; pin = graph->inputs[pin].nextFanout) {
+        fn(*graph->gates[graph->inputs[pin].owner]);
+    }
+}
 
 #endif //CIRCUIT_GATE_H
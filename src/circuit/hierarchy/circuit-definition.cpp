@@ -0,0 +1,109 @@
+#include "circuit-definition.h"
+#include "../compiler/optimizer.h"
+
+#include <stdexcept>
+
+using Instruction = CompiledCircuit::Instruction;
+
+CircuitDefinition::CircuitDefinition(std::string _name, Circuit _circuit, std::vector<Port> _inputs,
+                                     std::vector<Port> _outputs)
+    : name(std::move(_name)), circuit(std::move(_circuit)), inputs(std::move(_inputs)), outputs(std::move(_outputs)),
+      compiled(circuit) {
+    if (inputs.size() > CircuitGate::MAX_PINS || outputs.size() > CircuitGate::MAX_PINS) {
+        throw std::runtime_error("definition '" + name + "' has too many ports");
+    }
+    if (outputs.empty()) {
+        throw std::runtime_error("definition '" + name + "' has no outputs");
+    }
+
+    for (const Port &port : inputs) {
+        if (port.gate >= circuit.getGatesCount() || port.outputIndex != 0) {
+            throw std::runtime_error("no such input '" + port.name + "' in definition '" + name + "'");
+        }
+        inputTypes.push_back(circuit[port.gate].getOutputType(0));
+    }
+
+    std::vector<uint32_t> outputGates;
+    for (const Port &port : outputs) {
+        if (port.gate >= circuit.getGatesCount() || port.outputIndex >= circuit[port.gate].getOutputsCount()) {
+            throw std::runtime_error("no such output '" + port.name + "' in definition '" + name + "'");
+        }
+        outputTypes.push_back(circuit[port.gate].getOutputType(port.outputIndex));
+        outputGates.push_back(port.gate);
+    }
+
+    // paid once per definition rather than once per instance; the input ports are kept as they are
+    CircuitOptimizer().run(compiled, outputGates);
+    buildBody();
+}
+
+void CircuitDefinition::buildBody() {
+    const CompiledCircuit::Program &program = compiled.getProgram();
+
+    // the operand standing for every slot of the compiled definition
+    std::vector<uint32_t> operands(compiled.getSlotsCount(), CompiledCircuit::NO_SLOT);
+
+    for (uint32_t p = 0; p < inputs.size(); p++) {
+        if (!compiled.isConstant(inputs[p].gate)) {
+            throw std::runtime_error("input '" + inputs[p].name + "' of definition '" + name
+                                     + "' is not a ConstInt or ConstBool gate");
+        }
+
+        const uint32_t instruction = program.gateInstructions[inputs[p].gate];
+        uint32_t &operand = operands[program.instructions[instruction].out];
+        if (operand != CompiledCircuit::NO_SLOT) {
+            throw std::runtime_error("gate of input '" + inputs[p].name + "' of definition '" + name
+                                     + "' is used twice");
+        }
+        operand = Body::PORT | p;
+    }
+
+    auto toOperand = [&](CompiledCircuit::SlotIndex slot) {
+        return slot == CompiledCircuit::NO_SLOT ? CompiledCircuit::NO_SLOT : operands[slot];
+    };
+
+    for (const Instruction &instruction : program.instructions) {
+        if (instruction.op == CompiledCircuit::Register) {
+            throw std::runtime_error("definition '" + name + "' contains a register, which sub-circuits cannot hold");
+        }
+        if (operands[instruction.out] != CompiledCircuit::NO_SLOT) continue;
+
+        // nested instances copy their outputs for their own sake only
+        if (instruction.op == CompiledCircuit::Copy) {
+            operands[instruction.out] = toOperand(instruction.in0);
+            continue;
+        }
+
+        Instruction copy = instruction;
+        copy.in0 = toOperand(instruction.in0);
+        copy.in1 = toOperand(instruction.in1);
+        copy.out = CompiledCircuit::NO_SLOT;
+
+        operands[instruction.out] = body.instructions.size();
+        body.instructions.push_back(copy);
+        body.types.push_back(program.slotTypes[instruction.out]);
+    }
+
+    for (const Port &port : outputs) {
+        const CompiledCircuit::SlotIndex slot = compiled.getSlot(port.gate, port.outputIndex);
+        if (slot >= program.evaluableSlotsCount) {
+            throw std::runtime_error("output '" + port.name + "' of definition '" + name + "' cannot be evaluated");
+        }
+
+        outputSlots.push_back(slot);
+        body.outputs.push_back(operands[slot]);
+    }
+}
+
+void CircuitDefinition::evaluate(std::span<const int32_t> inputValues, std::span<int32_t> outputValues) const {
+    for (size_t p = 0; p < inputs.size(); p++) {
+        compiled.setConstant(inputs[p].gate, inputValues[p]);
+    }
+
+    compiled.run();
+
+    for (size_t o = 0; o < outputs.size(); o++) {
+        outputValues[o] = std::visit([](auto v) { return static_cast<int32_t>(v); },
+                                     *compiled.getSlotValue(outputSlots[o]));
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef CIRCUIT_CIRCUIT_DEFINITION_H
+#define CIRCUIT_CIRCUIT_DEFINITION_H
+
+#include "../circuit.h"
+#include "../compiler/compiled-circuit.h"
+#include <span>
+#include <string>
+#include <vector>
+
+/**
+ * A reusable block of logic, instantiated with `CircuitGate_SubCircuit`. The definition owns a
+ * circuit of its own, some of whose ConstInt and ConstBool gates are declared input ports and some
+ * of whose output pins are declared output ports.
+ *
+ * The circuit is compiled and optimized once, when the definition is created, into a `Body` which
+ * every compiled circuit instantiating the definition copies in place of each instance. Instances
+ * therefore cost nothing to compile beyond copying instructions, and evaluate exactly as fast as
+ * the same gates laid out flat.
+ *
+ * Definitions are immutable once created, and may contain instances of other definitions, but not
+ * registers: the state of a register would have to be kept per instance.
+ */
+class CircuitDefinition {
+public:
+    struct Port {
+        std::string name;
+        CircuitGate::GateID gate;
+        size_t outputIndex = 0;
+    };
+
+    /**
+     * The compiled definition, in execution order. Operands of the instructions are indices of
+     * earlier body instructions, `PORT | p` for the value of input port `p`, or NO_SLOT.
+     */
+    struct Body {
+        constexpr static uint32_t PORT = 1u << 31;
+
+        std::vector<CompiledCircuit::Instruction> instructions;
+        std::vector<CircuitGate::PinType> types;
+        // operand holding the value of every output port
+        std::vector<uint32_t> outputs;
+    };
+
+private:
+    std::string name;
+    Circuit circuit;
+    std::vector<Port> inputs, outputs;
+    std::vector<CircuitGate::PinType> inputTypes, outputTypes;
+
+    // evaluates single instances at the gate level, see `evaluate()`
+    mutable CompiledCircuit compiled;
+    std::vector<CompiledCircuit::SlotIndex> outputSlots;
+    Body body;
+
+public:
+    /**
+     * Compiles the definition right away. Throws if a port is invalid, an output port cannot be
+     * evaluated, or the circuit contains registers.
+     */
+    CircuitDefinition(std::string _name, Circuit _circuit, std::vector<Port> _inputs, std::vector<Port> _outputs);
+
+    CircuitDefinition(const CircuitDefinition&) = delete;
+
+    CircuitDefinition& operator=(const CircuitDefinition&) = delete;
+
+    [[nodiscard]]
+    const std::string& getName() const { return name; }
+
+    [[nodiscard]]
+    const Circuit& getCircuit() const { return circuit; }
+
+    [[nodiscard]]
+    const std::vector<Port>& getInputs() const { return inputs; }
+
+    [[nodiscard]]
+    const std::vector<Port>& getOutputs() const { return outputs; }
+
+    [[nodiscard]]
+    std::span<const CircuitGate::PinType> getInputTypes() const { return inputTypes; }
+
+    [[nodiscard]]
+    std::span<const CircuitGate::PinType> getOutputTypes() const { return outputTypes; }
+
+    [[nodiscard]]
+    const Body& getBody() const { return body; }
+
+    /**
+     * Computes the output ports of one instance from the values of its input ports. Meant for
+     * gate-level evaluation, which visits instances one at a time; not safe to call concurrently.
+     */
+    void evaluate(std::span<const int32_t> inputValues, std::span<int32_t> outputValues) const;
+
+private:
+    void buildBody();
+};
+
+#endif //CIRCUIT_CIRCUIT_DEFINITION_H
@@ -0,0 +1,12 @@
+#include "sub-circuit-gate.h"
+#include "circuit-definition.h"
+#include "../visitor.h"
+
+CircuitGate_SubCircuit::CircuitGate_SubCircuit(CircuitGraph& _graph, Position _pos,
+                                               std::shared_ptr<const CircuitDefinition> _definition)
+    : CircuitGate(_graph, _definition->getInputTypes(), _definition->getOutputTypes(), _pos),
+      definition(std::move(_definition)) { }
+
+std::string CircuitGate_SubCircuit::getName() const { return definition->getName(); }
+
+void CircuitGate_SubCircuit::acceptVisitor(CircuitVisitor &visitor) { visitor.visit(*this); }
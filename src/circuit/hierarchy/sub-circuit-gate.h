@@ -0,0 +1,32 @@
+#ifndef CIRCUIT_SUB_CIRCUIT_GATE_H
+#define CIRCUIT_SUB_CIRCUIT_GATE_H
+
+#include "../gate.h"
+#include <memory>
+
+struct CircuitVisitor;
+class CircuitDefinition;
+
+/**
+ * An instance of a `CircuitDefinition`, with one input pin per input port of the definition and one
+ * output pin per output port. Any number of instances share the definition, its gates and its
+ * compiled form, so a circuit made of many copies of the same block holds that block only once.
+ */
+struct CircuitGate_SubCircuit : public CircuitGate {
+private:
+    std::shared_ptr<const CircuitDefinition> definition;
+
+public:
+    explicit CircuitGate_SubCircuit(CircuitGraph& _graph, Position _pos,
+                                    std::shared_ptr<const CircuitDefinition> _definition);
+
+    [[nodiscard]]
+    std::string getName() const override;
+
+    [[nodiscard]]
+    const CircuitDefinition& getDefinition() const { return *definition; }
+
+    void acceptVisitor(CircuitVisitor& visitor) override;
+};
+
+#endif //CIRCUIT_SUB_CIRCUIT_GATE_H
@@ -0,0 +1,375 @@
+#include "binary-netlist.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using Header = BinaryNetlistHeader;
+
+// gate type codes used in the GateTypes section
+static const char *const GATE_TYPES[] = {"ConstTrue", "ConstBool", "Not", "And", "ConstInt", "Add", "Mul", "CmpLe",
+                                         "Register", "IntRegister"};
+constexpr static size_t GATE_TYPES_COUNT = sizeof(GATE_TYPES) / sizeof(GATE_TYPES[0]);
+
+static_assert(std::is_trivially_copyable_v<CompiledCircuit::Instruction>);
+static_assert(sizeof(CompiledCircuit::Instruction) == 20);
+static_assert(sizeof(CircuitGate::PinType) == 1);
+
+static uint8_t getGateTypeCode(CircuitGate& gate) {
+    const std::string type = getGateType(gate);
+    for (size_t i = 0; i < GATE_TYPES_COUNT; i++) {
+        if (type == GATE_TYPES[i]) return i;
+    }
+
+    throw std::runtime_error("gate type '" + type + "' has no binary representation");
+}
+
+// computed in 64 bits, where no count read from a file can make a size wrap around
+static uint64_t getSectionSize(const Header& header, Header::Section section) {
+    const uint64_t gates = header.gatesCount, probes = header.probesCount;
+
+    switch (section) {
+        case Header::GateTypes:
+            return gates;
+        case Header::InputOffsets:
+            return (gates + 1) * sizeof(uint32_t);
+        case Header::InputEdges:
+            return uint64_t(header.inputPinsCount) * 2 * sizeof(uint32_t);
+        case Header::Constants:
+            return gates * sizeof(int32_t);
+        case Header::Positions:
+            return gates * 2 * sizeof(float);
+        case Header::NameOffsets:
+            return (gates + probes + 1) * sizeof(uint32_t);
+        case Header::Names:
+            return header.namesSize;
+        case Header::Probes:
+            return probes * 2 * sizeof(uint32_t);
+        case Header::Instructions:
+            return uint64_t(header.instructionsCount) * sizeof(CompiledCircuit::Instruction);
+        case Header::LevelOffsets:
+            return (uint64_t(header.levelsCount) + 1) * sizeof(uint64_t);
+        case Header::SlotTypes:
+            return uint64_t(header.slotsCount) * sizeof(CircuitGate::PinType);
+        case Header::GateSlots:
+        case Header::GateInstructions:
+            return gates * sizeof(uint32_t);
+        case Header::SECTIONS_COUNT:
+            break;
+    }
+
+    return 0;
+}
+
+static size_t alignSection(size_t offset) {
+    return (offset + 7) & ~size_t(7);
+}
+
+void saveBinaryNetlist(const Netlist& netlist, std::ostream& out) {
+    // compiling the whole circuit keeps gate indices equal to gate IDs
+    const CompiledCircuit compiled(netlist.circuit);
+    const CompiledCircuit::Program &program = compiled.getProgram();
+
+    // the header stores counts in 32 bits, and the arrays below are sized from them
+    if (netlist.circuit.getGatesCount() >= UINT32_MAX) {
+        throw std::runtime_error("too many gates for a binary netlist");
+    }
+    const uint32_t gatesCount = netlist.circuit.getGatesCount();
+
+    std::vector<uint8_t> gateTypes(gatesCount);
+    std::vector<uint32_t> inputOffsets(size_t(gatesCount) + 1, 0);
+    std::vector<uint32_t> inputEdges;
+    std::vector<int32_t> constants(gatesCount);
+    std::vector<float> positions(size_t(gatesCount) * 2);
+    std::vector<uint32_t> nameOffsets = {0};
+    std::string names;
+    std::vector<uint32_t> probes;
+    const std::vector<Netlist::Probe> outputs = netlist.getOutputsOrSinks();
+
+    for (size_t g = 0; g < gatesCount; g++) {
+        CircuitGate &gate = netlist.circuit[g];
+        gateTypes[g] = getGateTypeCode(gate);
+        constants[g] = getConstantValue(gate).value_or(0);
+        positions[2 * g] = gate.pos.x;
+        positions[2 * g + 1] = gate.pos.y;
+
+        for (const auto &input : gate.getInputs()) {
+            inputEdges.push_back(input.destGate);
+            inputEdges.push_back(input.destSlotIndex);
+        }
+        inputOffsets[g + 1] = inputEdges.size() / 2;
+
+        names += netlist.names[g];
+        nameOffsets.push_back(names.size());
+    }
+
+    for (const auto &probe : outputs) {
+        probes.push_back(probe.gate);
+        probes.push_back(probe.outputIndex);
+
+        names += probe.name;
+        nameOffsets.push_back(names.size());
+    }
+
+    // the instructions are copied into zeroed memory so that no uninitialized padding ends up on disk
+    std::vector<CompiledCircuit::Instruction> instructions(program.instructions.size());
+    std::memset(static_cast<void *>(instructions.data()), 0, instructions.size() * sizeof(instructions[0]));
+    for (size_t i = 0; i < instructions.size(); i++) {
+        instructions[i].op = program.instructions[i].op;
+        instructions[i].in0 = program.instructions[i].in0;
+        instructions[i].in1 = program.instructions[i].in1;
+        instructions[i].out = program.instructions[i].out;
+        instructions[i].imm = program.instructions[i].imm;
+    }
+
+    Header header{};
+    std::memcpy(header.magic, Header::MAGIC, sizeof(header.magic));
+    header.version = Header::VERSION;
+    header.gatesCount = gatesCount;
+    header.inputPinsCount = inputEdges.size() / 2;
+    header.probesCount = outputs.size();
+    header.namesSize = names.size();
+    header.instructionsCount = instructions.size();
+    header.levelsCount = compiled.getLevelsCount();
+    header.slotsCount = compiled.getSlotsCount();
+    header.evaluableSlotsCount = program.evaluableSlotsCount;
+
+    const void *sections[Header::SECTIONS_COUNT] = {
+            gateTypes.data(), inputOffsets.data(), inputEdges.data(), constants.data(), positions.data(),
+            nameOffsets.data(), names.data(), probes.data(), instructions.data(), program.levelOffsets.data(),
+            program.slotTypes.data(), program.gateSlotBase.data(), program.gateInstructions.data(),
+    };
+
+    size_t offset = alignSection(sizeof(Header));
+    for (size_t s = 0; s < Header::SECTIONS_COUNT; s++) {
+        header.sectionOffsets[s] = offset;
+        offset = alignSection(offset + getSectionSize(header, static_cast<Header::Section>(s)));
+    }
+
+    constexpr static char padding[8] = {};
+    size_t written = sizeof(Header);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+
+    for (size_t s = 0; s < Header::SECTIONS_COUNT; s++) {
+        out.write(padding, header.sectionOffsets[s] - written);
+        const size_t sectionSize = getSectionSize(header, static_cast<Header::Section>(s));
+        out.write(static_cast<const char *>(sections[s]), sectionSize);
+        written = header.sectionOffsets[s] + sectionSize;
+    }
+
+    if (!out) {
+        throw std::runtime_error("failed to write binary netlist");
+    }
+}
+
+MappedNetlist::MappedNetlist(const std::string& path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("cannot open " + path);
+    }
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+        close(fd);
+        throw std::runtime_error(path + " is not a binary netlist");
+    }
+
+    size = st.st_size;
+    // private and writable: overriding a constant copies only the page it lives on
+    data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED) {
+        data = nullptr;
+        throw std::runtime_error("cannot map " + path);
+    }
+
+    header = static_cast<const Header *>(data);
+
+    try {
+        validate();
+    } catch (...) {
+        munmap(data, size);
+        throw;
+    }
+}
+
+MappedNetlist::~MappedNetlist() {
+    if (data) {
+        munmap(data, size);
+    }
+}
+
+bool MappedNetlist::isBinaryNetlist(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    char magic[sizeof(Header::MAGIC)] = {};
+    file.read(magic, sizeof(magic));
+
+    return file && std::memcmp(magic, Header::MAGIC, sizeof(magic)) == 0;
+}
+
+void MappedNetlist::validate() const {
+    if (std::memcmp(header->magic, Header::MAGIC, sizeof(Header::MAGIC)) != 0) {
+        throw std::runtime_error("not a binary netlist");
+    }
+    if (header->version != Header::VERSION) {
+        throw std::runtime_error("unsupported binary netlist version " + std::to_string(header->version));
+    }
+
+    for (size_t s = 0; s < Header::SECTIONS_COUNT; s++) {
+        const uint64_t offset = header->sectionOffsets[s];
+        const uint64_t sectionSize = getSectionSize(*header, static_cast<Header::Section>(s));
+        if (offset % 8 != 0 || offset > size || sectionSize > size - offset) {
+            throw std::runtime_error("corrupt binary netlist: section out of bounds");
+        }
+    }
+
+    // everything the evaluator indexes with is checked once here, so the hot loop needs no checks
+    const uint32_t gates = header->gatesCount, slots = header->slotsCount;
+    auto check = [](bool condition) {
+        if (!condition) throw std::runtime_error("corrupt binary netlist");
+    };
+
+    check(header->evaluableSlotsCount <= slots);
+
+    for (uint8_t type : section<const uint8_t>(Header::GateTypes, gates)) {
+        check(type < GATE_TYPES_COUNT);
+    }
+
+    const auto inputOffsets = section<const uint32_t>(Header::InputOffsets, size_t(gates) + 1);
+    check(inputOffsets[0] == 0 && inputOffsets[gates] == header->inputPinsCount);
+    for (uint32_t g = 0; g < gates; g++) {
+        check(inputOffsets[g] <= inputOffsets[g + 1]);
+    }
+
+    for (const Edge &edge : section<const Edge>(Header::InputEdges, header->inputPinsCount)) {
+        check(edge.gate == UINT32_MAX || edge.gate < gates);
+    }
+
+    const auto nameOffsets = section<const uint32_t>(Header::NameOffsets, size_t(gates) + header->probesCount + 1);
+    check(nameOffsets[0] == 0);
+    for (size_t i = 0; i + 1 < nameOffsets.size(); i++) {
+        check(nameOffsets[i] <= nameOffsets[i + 1] && nameOffsets[i + 1] <= header->namesSize);
+    }
+
+    for (const Edge &probe : section<const Edge>(Header::Probes, header->probesCount)) {
+        check(probe.gate < gates);
+    }
+
+    for (const auto &ins : section<const CompiledCircuit::Instruction>(Header::Instructions, header->instructionsCount)) {
+        check(ins.op <= CompiledCircuit::Copy && ins.out < header->evaluableSlotsCount);
+        // a register may have nothing to latch, which the evaluator checks for anyway
+        check(ins.op != CompiledCircuit::Register || ins.in0 == CompiledCircuit::NO_SLOT
+              || ins.in0 < header->evaluableSlotsCount);
+        const bool unary = ins.op == CompiledCircuit::Not || ins.op == CompiledCircuit::Copy;
+        const bool binary = ins.op == CompiledCircuit::And || ins.op == CompiledCircuit::Add
+                            || ins.op == CompiledCircuit::Mul || ins.op == CompiledCircuit::CmpLe;
+        check(!(unary || binary) || ins.in0 < header->evaluableSlotsCount);
+        check(!binary || ins.in1 < header->evaluableSlotsCount);
+    }
+
+    const auto levelOffsets = section<const uint64_t>(Header::LevelOffsets, size_t(header->levelsCount) + 1);
+    check(levelOffsets[0] == 0 && levelOffsets[header->levelsCount] == header->instructionsCount);
+    for (uint32_t l = 0; l < header->levelsCount; l++) {
+        check(levelOffsets[l] <= levelOffsets[l + 1]);
+    }
+
+    for (CircuitGate::PinType type : section<const CircuitGate::PinType>(Header::SlotTypes, slots)) {
+        check(type <= CircuitGate::Bool);
+    }
+
+    for (uint32_t slot : section<const uint32_t>(Header::GateSlots, gates)) {
+        check(slot < slots);
+    }
+
+    for (uint32_t instruction : section<const uint32_t>(Header::GateInstructions, gates)) {
+        check(instruction == CompiledCircuit::NO_INSTRUCTION || instruction < header->instructionsCount);
+    }
+}
+
+std::string_view MappedNetlist::getName(size_t nameIndex) const {
+    const size_t namesCount = size_t(header->gatesCount) + header->probesCount;
+    const auto offsets = section<const uint32_t>(Header::NameOffsets, namesCount + 1);
+    const auto names = section<const char>(Header::Names, header->namesSize);
+
+    return {names.data() + offsets[nameIndex], offsets[nameIndex + 1] - offsets[nameIndex]};
+}
+
+std::optional<uint32_t> MappedNetlist::findGate(std::string_view name) const {
+    if (nameIndices.empty()) {
+        nameIndices.reserve(header->gatesCount);
+        for (uint32_t g = 0; g < header->gatesCount; g++) {
+            nameIndices.emplace(getName(g), g);
+        }
+    }
+
+    const auto it = nameIndices.find(name);
+    if (it == nameIndices.end()) return std::nullopt;
+
+    return it->second;
+}
+
+std::vector<MappedNetlist::Probe> MappedNetlist::getProbes() const {
+    const auto probes = section<const Edge>(Header::Probes, header->probesCount);
+
+    std::vector<Probe> result;
+    for (uint32_t p = 0; p < header->probesCount; p++) {
+        result.push_back({getName(header->gatesCount + p), probes[p].gate, probes[p].output});
+    }
+
+    return result;
+}
+
+CompiledCircuit MappedNetlist::createCircuit() {
+    CompiledCircuit::Program program;
+    program.instructions = section<CompiledCircuit::Instruction>(Header::Instructions, header->instructionsCount);
+    program.levelOffsets = section<const uint64_t>(Header::LevelOffsets, size_t(header->levelsCount) + 1);
+    program.slotTypes = section<const CircuitGate::PinType>(Header::SlotTypes, header->slotsCount);
+    program.gateSlotBase = section<const uint32_t>(Header::GateSlots, header->gatesCount);
+    program.gateInstructions = section<const uint32_t>(Header::GateInstructions, header->gatesCount);
+    program.evaluableSlotsCount = header->evaluableSlotsCount;
+
+    return CompiledCircuit(program);
+}
+
+Netlist MappedNetlist::toNetlist() const {
+    const uint32_t gates = header->gatesCount;
+    const auto gateTypes = section<const uint8_t>(Header::GateTypes, gates);
+    const auto inputOffsets = section<const uint32_t>(Header::InputOffsets, size_t(gates) + 1);
+    const auto inputEdges = section<const Edge>(Header::InputEdges, header->inputPinsCount);
+    const auto constants = section<const int32_t>(Header::Constants, gates);
+    const auto positions = section<const float>(Header::Positions, size_t(gates) * 2);
+
+    Netlist netlist;
+    for (uint32_t g = 0; g < gates; g++) {
+        CircuitGate &gate = netlist.add(std::string(getName(g)), GATE_TYPES[gateTypes[g]],
+                                        {positions[2 * g], positions[2 * g + 1]});
+        if (inputOffsets[g + 1] - inputOffsets[g] != gate.getInputsCount()) {
+            throw std::runtime_error("corrupt binary netlist: wrong number of inputs");
+        }
+
+        setConstantValue(gate, constants[g]);
+    }
+
+    for (uint32_t g = 0; g < gates; g++) {
+        for (uint32_t i = inputOffsets[g]; i < inputOffsets[g + 1]; i++) {
+            const Edge &edge = inputEdges[i];
+            if (edge.gate == UINT32_MAX) continue;
+
+            if (edge.output >= netlist.circuit[edge.gate].getOutputsCount()) {
+                throw std::runtime_error("corrupt binary netlist: no such output");
+            }
+            netlist.circuit[g].updateInput(edge.gate, edge.output, i - inputOffsets[g]);
+        }
+    }
+
+    for (const Probe &probe : getProbes()) {
+        netlist.outputs.push_back({std::string(probe.name), probe.gateIndex, probe.outputIndex});
+    }
+
+    return netlist;
+}
@@ -0,0 +1,122 @@
+#ifndef CIRCUIT_BINARY_NETLIST_H
+#define CIRCUIT_BINARY_NETLIST_H
+
+#include "netlist.h"
+#include "../compiler/compiled-circuit.h"
+#include <string_view>
+
+/**
+ * On-disk layout of a binary netlist: this header followed by the sections listed below, each
+ * starting at an 8-byte aligned offset. Besides the netlist itself (gate types, input edges in CSR
+ * form, constants, names) the file carries the compiled program, so that it can be evaluated
+ * straight from a read-only mapping. Editor positions live in a section of their own and are only
+ * touched when the netlist is turned back into gates.
+ */
+struct BinaryNetlistHeader {
+    enum Section {
+        GateTypes,          // uint8_t per gate, index into the gate type table
+        InputOffsets,       // uint32_t per gate + 1, CSR offsets into InputEdges
+        InputEdges,         // {uint32_t gate, uint32_t output} per input pin, gate = UINT32_MAX if unconnected
+        Constants,          // int32_t per gate, the value of a constant or the state of a register
+        Positions,          // {float x, float y} per gate
+        NameOffsets,        // uint32_t per gate + probe + 1, offsets into Names
+        Names,              // chars
+        Probes,             // {uint32_t gate, uint32_t output} per probe
+        Instructions,       // CompiledCircuit::Instruction per instruction
+        LevelOffsets,       // uint64_t per level + 1
+        SlotTypes,          // CircuitGate::PinType per slot
+        GateSlots,          // uint32_t per gate
+        GateInstructions,   // uint32_t per gate
+        SECTIONS_COUNT
+    };
+
+    constexpr static char MAGIC[4] = {'C', 'I', 'R', 'B'};
+    constexpr static uint32_t VERSION = 1;
+
+    char magic[4];
+    uint32_t version;
+    uint32_t gatesCount;
+    uint32_t inputPinsCount;
+    uint32_t probesCount;
+    uint32_t namesSize;
+    uint32_t instructionsCount;
+    uint32_t levelsCount;
+    uint32_t slotsCount;
+    uint32_t evaluableSlotsCount;
+    uint64_t sectionOffsets[SECTIONS_COUNT];
+};
+
+void saveBinaryNetlist(const Netlist& netlist, std::ostream& out);
+
+/**
+ * A binary netlist mapped into memory. The mapping is private, so the pages are shared between all
+ * processes mapping the same file until one of them overrides a constant in the compiled program.
+ */
+class MappedNetlist {
+public:
+    struct Probe {
+        std::string_view name;
+        uint32_t gateIndex;
+        uint32_t outputIndex;
+    };
+
+private:
+    struct Edge {
+        uint32_t gate, output;
+    };
+
+    void *data = nullptr;
+    size_t size = 0;
+    const BinaryNetlistHeader *header = nullptr;
+
+    mutable std::unordered_map<std::string_view, uint32_t> nameIndices;
+
+public:
+    explicit MappedNetlist(const std::string& path);
+
+    ~MappedNetlist();
+
+    MappedNetlist(const MappedNetlist&) = delete;
+
+    MappedNetlist& operator=(const MappedNetlist&) = delete;
+
+    static bool isBinaryNetlist(const std::string& path);
+
+    [[nodiscard]]
+    uint32_t getGatesCount() const { return header->gatesCount; }
+
+    [[nodiscard]]
+    std::string_view getGateName(uint32_t gateIndex) const { return getName(gateIndex); }
+
+    [[nodiscard]]
+    std::optional<uint32_t> findGate(std::string_view name) const;
+
+    [[nodiscard]]
+    std::vector<Probe> getProbes() const;
+
+    /**
+     * A circuit evaluating the compiled program in place. Its gate indices are the netlist's.
+     */
+    [[nodiscard]]
+    CompiledCircuit createCircuit();
+
+    /**
+     * Rebuilds editable gates, e.g. for the editor.
+     */
+    [[nodiscard]]
+    Netlist toNetlist() const;
+
+private:
+    template<typename T>
+    [[nodiscard]]
+    std::span<T> section(BinaryNetlistHeader::Section section, size_t count) const {
+        return {reinterpret_cast<T *>(static_cast<char *>(data) + header->sectionOffsets[section]), count};
+    }
+
+    [[nodiscard]]
+    std::string_view getName(size_t nameIndex) const;
+
+    void validate() const;
+};
+
+#endif //CIRCUIT_BINARY_NETLIST_H
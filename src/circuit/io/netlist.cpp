@@ -0,0 +1,414 @@
+#include "netlist.h"
+#include "../visitor.h"
+
+#include <charconv>
+#include <sstream>
+#include <stdexcept>
+
+struct CircuitVisitor_Describe : public CircuitVisitor {
+    std::string type;
+    std::optional<int> value;
+    std::optional<int> newValue;
+
+    void visit(CircuitGate_ConstTrue& gate) override {
+        (void) gate;
+        type = "ConstTrue";
+    }
+
+    void visit(CircuitGate_ConstBool& gate) override {
+        type = "ConstBool";
+        if (newValue) gate.value = *newValue != 0;
+        value = gate.value;
+    }
+
+    void visit(CircuitGate_Not& gate) override {
+        (void) gate;
+        type = "Not";
+    }
+
+    void visit(CircuitGate_And& gate) override {
+        (void) gate;
+        type = "And";
+    }
+
+    void visit(CircuitGate_Register& gate) override {
+        type = "Register";
+        if (newValue) gate.value = *newValue != 0;
+        value = gate.value;
+    }
+
+    void visit(CircuitGate_ConstInt& gate) override {
+        type = "ConstInt";
+        if (newValue) gate.value = *newValue;
+        value = gate.value;
+    }
+
+    void visit(CircuitGate_Add& gate) override {
+        (void) gate;
+        type = "Add";
+    }
+
+    void visit(CircuitGate_Mul& gate) override {
+        (void) gate;
+        type = "Mul";
+    }
+
+    void visit(CircuitGate_CmpLe& gate) override {
+        (void) gate;
+        type = "CmpLe";
+    }
+
+    void visit(CircuitGate_IntRegister& gate) override {
+        type = "IntRegister";
+        if (newValue) gate.value = *newValue;
+        value = gate.value;
+    }
+
+    void visit(CircuitGate_SubCircuit& gate) override {
+        type = gate.getDefinition().getName();
+    }
+};
+
+CircuitGate *makeGate(Circuit& circuit, const std::string& type, CircuitGate::Position pos) {
+    if (type == "ConstTrue") return &circuit.add<CircuitGate_ConstTrue>(pos);
+    if (type == "ConstBool") return &circuit.add<CircuitGate_ConstBool>(pos);
+    if (type == "Not") return &circuit.add<CircuitGate_Not>(pos);
+    if (type == "And") return &circuit.add<CircuitGate_And>(pos);
+    if (type == "Register") return &circuit.add<CircuitGate_Register>(pos);
+    if (type == "ConstInt") return &circuit.add<CircuitGate_ConstInt>(pos);
+    if (type == "Add") return &circuit.add<CircuitGate_Add>(pos);
+    if (type == "Mul") return &circuit.add<CircuitGate_Mul>(pos);
+    if (type == "CmpLe") return &circuit.add<CircuitGate_CmpLe>(pos);
+    if (type == "IntRegister") return &circuit.add<CircuitGate_IntRegister>(pos);
+    return nullptr;
+}
+
+std::string getGateType(CircuitGate& gate) {
+    CircuitVisitor_Describe visitor;
+    gate.acceptVisitor(visitor);
+    return visitor.type;
+}
+
+std::optional<int> getConstantValue(CircuitGate& gate) {
+    CircuitVisitor_Describe visitor;
+    gate.acceptVisitor(visitor);
+    return visitor.value;
+}
+
+bool setConstantValue(CircuitGate& gate, int value) {
+    CircuitVisitor_Describe visitor;
+    visitor.newValue = value;
+    gate.acceptVisitor(visitor);
+    if (!visitor.value) return false;
+
+    gate.invalidate();
+    return true;
+}
+
+// splits "name.index" into its parts; the index defaults to 0 when `indexRequired` is false
+static std::pair<std::string, size_t> parsePinRef(const std::string& ref, bool indexRequired) {
+    const size_t dot = ref.rfind('.');
+    if (dot == std::string::npos) {
+        if (indexRequired) {
+            throw std::runtime_error("expected <gate>.<pin>, got '" + ref + "'");
+        }
+        return {ref, 0};
+    }
+
+    return {ref.substr(0, dot), std::stoul(ref.substr(dot + 1))};
+}
+
+Netlist Netlist::load(std::istream& in) {
+    Netlist netlist;
+    size_t lineNumber = 0;
+    netlist.parse(in, lineNumber, nullptr);
+
+    return netlist;
+}
+
+void Netlist::parse(std::istream& in, size_t& lineNumber, std::vector<CircuitDefinition::Port> *inputs) {
+    std::string line;
+
+    while (std::getline(in, line)) {
+        lineNumber++;
+
+        const size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            line.erase(comment);
+        }
+
+        std::istringstream words(line);
+        std::string keyword;
+        if (!(words >> keyword)) continue;
+
+        if (keyword == "end" && inputs) return;
+
+        std::string definedType;
+
+        try {
+            if (keyword == "gate") {
+                std::string name, type;
+                if (!(words >> name >> type)) {
+                    throw std::runtime_error("expected: gate <name> <type> [<value>]");
+                }
+
+                CircuitGate &gate = add(name, type);
+
+                std::string value;
+                if (words >> value) {
+                    int parsed;
+                    const char *end = value.data() + value.size();
+                    const auto [next, error] = std::from_chars(value.data(), end, parsed);
+                    if (error != std::errc() || next != end) {
+                        throw std::runtime_error("invalid value '" + value + "'");
+                    }
+                    if (!setConstantValue(gate, parsed)) {
+                        throw std::runtime_error("only constants and registers take a value");
+                    }
+                }
+
+            } else if (keyword == "pos") {
+                std::string name;
+                float x, y;
+                if (!(words >> name >> x >> y)) {
+                    throw std::runtime_error("expected: pos <name> <x> <y>");
+                }
+
+                CircuitGate *gate = find(name);
+                if (!gate) {
+                    throw std::runtime_error("unknown gate '" + name + "'");
+                }
+                gate->pos = {x, y};
+
+            } else if (keyword == "wire") {
+                std::string src, dst;
+                if (!(words >> src >> dst)) {
+                    throw std::runtime_error("expected: wire <src>[.<output>] <dst>.<input>");
+                }
+
+                const auto [srcName, outputIndex] = parsePinRef(src, false);
+                const auto [dstName, inputIndex] = parsePinRef(dst, true);
+                const CircuitGate *srcGate = find(srcName);
+                CircuitGate *dstGate = find(dstName);
+
+                if (!srcGate || !dstGate) {
+                    throw std::runtime_error("unknown gate '" + (srcGate ? dstName : srcName) + "'");
+                }
+                if (outputIndex >= srcGate->getOutputsCount()) {
+                    throw std::runtime_error("gate '" + srcName + "' has no such output");
+                }
+                if (inputIndex >= dstGate->getInputsCount()) {
+                    throw std::runtime_error("gate '" + dstName + "' has no such input");
+                }
+                if (srcGate->getOutputType(outputIndex) != dstGate->getInput(inputIndex).type) {
+                    throw std::runtime_error("TypeError: pin types of '" + src + "' and '" + dst + "' differ");
+                }
+
+                dstGate->updateInput(srcGate->getId(), outputIndex, inputIndex);
+
+            } else if (keyword == "output") {
+                std::string ref;
+                if (!(words >> ref)) {
+                    throw std::runtime_error("expected: output <name>[.<output>]");
+                }
+
+                const auto [name, outputIndex] = parsePinRef(ref, false);
+                const CircuitGate *gate = find(name);
+                if (!gate || outputIndex >= gate->getOutputsCount()) {
+                    throw std::runtime_error("unknown output '" + ref + "'");
+                }
+
+                outputs.push_back({ref, gate->getId(), outputIndex});
+
+            } else if (keyword == "input" && inputs) {
+                std::string name;
+                if (!(words >> name)) {
+                    throw std::runtime_error("expected: input <name>");
+                }
+
+                const CircuitGate *gate = find(name);
+                if (!gate) {
+                    throw std::runtime_error("unknown gate '" + name + "'");
+                }
+
+                inputs->push_back({name, gate->getId()});
+
+            } else if (keyword == "define") {
+                if (inputs) {
+                    throw std::runtime_error("definitions cannot be nested");
+                }
+                if (!(words >> definedType)) {
+                    throw std::runtime_error("expected: define <type>");
+                }
+
+            } else {
+                throw std::runtime_error("unknown keyword '" + keyword + "'");
+            }
+
+            std::string extra;
+            if (words >> extra) {
+                throw std::runtime_error("unexpected '" + extra + "' after the " + keyword);
+            }
+        } catch (const std::exception &e) {
+            throw std::runtime_error("netlist line " + std::to_string(lineNumber) + ": " + e.what());
+        }
+
+        // the lines of the definition are read right away, reporting errors with their own numbers
+        if (!definedType.empty()) {
+            parseDefinition(in, lineNumber, definedType);
+        }
+    }
+
+    if (inputs) {
+        throw std::runtime_error("netlist line " + std::to_string(lineNumber) + ": definition has no end");
+    }
+}
+
+void Netlist::parseDefinition(std::istream& in, size_t& lineNumber, const std::string& type) {
+    const size_t firstLine = lineNumber;
+
+    // the definition may use every type defined before it
+    Netlist contents;
+    for (const Definition &definition : definitions) {
+        contents.define(definition.definition);
+    }
+
+    std::vector<CircuitDefinition::Port> inputs;
+    contents.parse(in, lineNumber, &inputs);
+
+    std::vector<CircuitDefinition::Port> definitionOutputs;
+    for (const Probe &probe : contents.outputs) {
+        definitionOutputs.push_back({probe.name, probe.gate, probe.outputIndex});
+    }
+
+    try {
+        define(std::make_shared<const CircuitDefinition>(type, std::move(contents.circuit), std::move(inputs),
+                                                         std::move(definitionOutputs)),
+               std::move(contents.names));
+    } catch (const std::exception &e) {
+        throw std::runtime_error("netlist line " + std::to_string(firstLine) + ": " + e.what());
+    }
+}
+
+// writes the gates of `circuit` and the wires between them
+static void saveCircuit(std::ostream& out, const Circuit& circuit, const std::vector<std::string>& names,
+                        const std::string& indent) {
+    for (CircuitGate *gate : circuit.getGates()) {
+        const std::string &name = names[gate->getId()];
+
+        out << indent << "gate " << name << " " << getGateType(*gate);
+        if (const auto value = getConstantValue(*gate)) {
+            out << " " << *value;
+        }
+        out << "\n";
+        out << indent << "pos " << name << " " << gate->pos.x << " " << gate->pos.y << "\n";
+    }
+
+    for (const CircuitGate *gate : circuit.getGates()) {
+        const auto inputs = gate->getInputs();
+
+        for (size_t k = 0; k < inputs.size(); k++) {
+            if (inputs[k].destGate == CircuitGate::NO_GATE) continue;
+
+            out << indent << "wire " << names[inputs[k].destGate] << "." << inputs[k].destSlotIndex
+                << " " << names[gate->getId()] << "." << k << "\n";
+        }
+    }
+}
+
+void Netlist::save(std::ostream& out) const {
+    for (const Definition &definition : definitions) {
+        const CircuitDefinition &d = *definition.definition;
+        const Circuit &body = d.getCircuit();
+
+        std::vector<std::string> gateNames = definition.names;
+        gateNames.resize(body.getGatesCount());
+        for (size_t id = 0; id < gateNames.size(); id++) {
+            if (gateNames[id].empty()) {
+                gateNames[id] = 'n' + std::to_string(id);
+            }
+        }
+
+        out << "define " << d.getName() << "\n";
+        saveCircuit(out, body, gateNames, "  ");
+
+        for (const CircuitDefinition::Port &port : d.getInputs()) {
+            out << "  input " << gateNames[port.gate] << "\n";
+        }
+        for (const CircuitDefinition::Port &port : d.getOutputs()) {
+            out << "  output " << gateNames[port.gate];
+            if (body[port.gate].getOutputsCount() > 1) {
+                out << "." << port.outputIndex;
+            }
+            out << "\n";
+        }
+
+        out << "end\n";
+    }
+
+    saveCircuit(out, circuit, names, "");
+
+    for (const auto &output : outputs) {
+        out << "output " << output.name << "\n";
+    }
+}
+
+CircuitGate *Netlist::find(const std::string& name) const {
+    const auto it = nameIndices.find(name);
+    return it == nameIndices.end() ? nullptr : &circuit[it->second];
+}
+
+CircuitGate& Netlist::add(const std::string& name, const std::string& type, CircuitGate::Position pos) {
+    if (nameIndices.contains(name)) {
+        throw std::runtime_error("gate '" + name + "' defined twice");
+    }
+
+    CircuitGate *gate = makeGate(circuit, type, pos);
+    if (!gate) {
+        std::shared_ptr<const CircuitDefinition> definition = findDefinition(type);
+        if (!definition) {
+            throw std::runtime_error("unknown gate type '" + type + "'");
+        }
+
+        gate = &circuit.add<CircuitGate_SubCircuit>(pos, std::move(definition));
+    }
+
+    nameIndices.emplace(name, gate->getId());
+    names.resize(circuit.getGatesCount());
+    names[gate->getId()] = name;
+
+    return *gate;
+}
+
+void Netlist::define(std::shared_ptr<const CircuitDefinition> definition, std::vector<std::string> gateNames) {
+    const std::string &type = definition->getName();
+
+    Circuit scratch;
+    if (definitionIndices.contains(type) || makeGate(scratch, type)) {
+        throw std::runtime_error("gate type '" + type + "' defined twice");
+    }
+
+    definitionIndices.emplace(type, definitions.size());
+    definitions.push_back({std::move(definition), std::move(gateNames)});
+}
+
+std::shared_ptr<const CircuitDefinition> Netlist::findDefinition(const std::string& type) const {
+    const auto it = definitionIndices.find(type);
+    return it == definitionIndices.end() ? nullptr : definitions[it->second].definition;
+}
+
+std::vector<Netlist::Probe> Netlist::getOutputsOrSinks() const {
+    if (!outputs.empty()) return outputs;
+
+    std::vector<Probe> sinks;
+    for (const CircuitGate *gate : circuit.getGates()) {
+        if (gate->hasFanouts()) continue;
+
+        const std::string &name = names[gate->getId()];
+        for (size_t k = 0; k < gate->getOutputsCount(); k++) {
+            sinks.push_back({gate->getOutputsCount() == 1 ? name : name + "." + std::to_string(k), gate->getId(), k});
+        }
+    }
+
+    return sinks;
+}
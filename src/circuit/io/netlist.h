@@ -0,0 +1,113 @@
+#ifndef CIRCUIT_NETLIST_H
+#define CIRCUIT_NETLIST_H
+
+#include "../circuit.h"
+#include "../hierarchy/circuit-definition.h"
+#include <istream>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * A circuit together with the names used to refer to its gates from outside, read from and
+ * written to a line-based text format:
+ *
+ *     # comment
+ *     gate <name> <type> [<value>]          type: ConstTrue ConstBool Not And ConstInt Add Mul CmpLe
+ *                                             Register IntRegister; value: of a constant, or the
+ *                                             initial state of a register
+ *     pos <name> <x> <y>                    editor position, optional
+ *     wire <src>[.<output>] <dst>.<input>
+ *     output <name>[.<output>]              net reported by the simulator
+ *
+ *     define <type>                         sub-circuit definition, up to the matching `end`; its
+ *       gate / pos / wire ...                 lines describe a circuit of its own, in which
+ *       input <name>                          a ConstInt or ConstBool gate becomes an input pin
+ *       output <name>[.<output>]              and an output pin is declared
+ *     end
+ *
+ * Once defined, a definition's type can be used by `gate` lines, inside later definitions too.
+ */
+struct Netlist {
+    struct Probe {
+        std::string name;
+        CircuitGate::GateID gate;
+        size_t outputIndex = 0;
+    };
+
+    struct Definition {
+        std::shared_ptr<const CircuitDefinition> definition;
+        std::vector<std::string> names; // of the definition's gates, by GateID
+    };
+
+    Circuit circuit;
+    std::vector<std::string> names; // by GateID
+    std::vector<Probe> outputs;
+    std::vector<Definition> definitions; // each one after those it uses
+
+    static Netlist load(std::istream& in);
+
+    void save(std::ostream& out) const;
+
+    [[nodiscard]]
+    CircuitGate *find(const std::string& name) const;
+
+    /**
+     * Creates a gate of the given type, built-in or defined, under the given name; throws if the
+     * type is unknown or the name is already taken.
+     */
+    CircuitGate& add(const std::string& name, const std::string& type, CircuitGate::Position pos = {});
+
+    /**
+     * Makes `definition` available as a gate type. `gateNames` name its gates when saving, and
+     * gates without one get a generated name. Throws if the type name is already taken.
+     */
+    void define(std::shared_ptr<const CircuitDefinition> definition, std::vector<std::string> gateNames = {});
+
+    [[nodiscard]]
+    std::shared_ptr<const CircuitDefinition> findDefinition(const std::string& type) const;
+
+    /**
+     * The declared outputs, or every output pin nothing else reads from if none were declared.
+     */
+    [[nodiscard]]
+    std::vector<Probe> getOutputsOrSinks() const;
+
+private:
+    std::unordered_map<std::string, CircuitGate::GateID> nameIndices;
+    std::unordered_map<std::string, size_t> definitionIndices;
+
+    /**
+     * Reads lines until the end of the stream, or until `end` if this is the netlist of a definition
+     * whose input pins go to `inputs`.
+     */
+    void parse(std::istream& in, size_t& lineNumber, std::vector<CircuitDefinition::Port> *inputs);
+
+    void parseDefinition(std::istream& in, size_t& lineNumber, const std::string& type);
+};
+
+/**
+ * Creates a gate in `circuit` from its netlist type name, or returns null for an unknown type.
+ */
+CircuitGate *makeGate(Circuit& circuit, const std::string& type, CircuitGate::Position pos = {});
+
+/**
+ * The netlist type name of the gate.
+ */
+std::string getGateType(CircuitGate& gate);
+
+/**
+ * The value of a ConstInt or ConstBool gate or the state of a register, or nothing for any other gate.
+ */
+std::optional<int> getConstantValue(CircuitGate& gate);
+
+/**
+ * Sets the value of a ConstInt or ConstBool gate or the state of a register; returns false for any
+ * other gate.
+ */
+bool setConstantValue(CircuitGate& gate, int value);
+
+#endif //CIRCUIT_NETLIST_H
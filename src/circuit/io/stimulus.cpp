@@ -0,0 +1,240 @@
+#include "stimulus.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+
+StimulusReader::StimulusReader(std::istream& _in, StimulusFormat _format) : in(_in), format(_format) {
+    if (format == StimulusFormat::Csv) {
+        buffer.resize(BUFFER_SIZE);
+
+        const std::string_view header = nextLine();
+        if (header.empty()) {
+            throw std::runtime_error("stimulus has no header");
+        }
+
+        size_t start = 0;
+        while (true) {
+            const size_t comma = header.find(',', start);
+            std::string_view name = header.substr(start, comma == std::string_view::npos ? comma : comma - start);
+
+            while (!name.empty() && std::isspace(static_cast<unsigned char>(name.front()))) name.remove_prefix(1);
+            while (!name.empty() && std::isspace(static_cast<unsigned char>(name.back()))) name.remove_suffix(1);
+            columns.emplace_back(name);
+
+            if (comma == std::string_view::npos) break;
+            start = comma + 1;
+        }
+
+        return;
+    }
+
+    StimulusHeader header{};
+    if (!in.read(reinterpret_cast<char *>(&header), sizeof header)
+        || !std::equal(std::begin(StimulusHeader::MAGIC), std::end(StimulusHeader::MAGIC), header.magic)) {
+        throw std::runtime_error("not a binary stimulus");
+    }
+    if (header.version != StimulusHeader::VERSION) {
+        throw std::runtime_error("unsupported binary stimulus version " + std::to_string(header.version));
+    }
+
+    for (uint32_t c = 0; c < header.columnsCount; c++) {
+        uint32_t length;
+        if (!in.read(reinterpret_cast<char *>(&length), sizeof length)) {
+            throw std::runtime_error("truncated binary stimulus");
+        }
+        if (length > MAX_NAME_LENGTH) {
+            throw std::runtime_error("binary stimulus column name of " + std::to_string(length) + " bytes");
+        }
+
+        std::string name(length, '\0');
+        if (!in.read(name.data(), length)) {
+            throw std::runtime_error("truncated binary stimulus");
+        }
+        columns.push_back(std::move(name));
+    }
+}
+
+size_t StimulusReader::read(std::span<int32_t> values, size_t maxVectors) {
+    if (values.size() < columns.size() * maxVectors) {
+        throw std::runtime_error("stimulus chunk does not fit");
+    }
+
+    return format == StimulusFormat::Csv ? readCsv(values, maxVectors) : readBinary(values, maxVectors);
+}
+
+size_t StimulusReader::readCsv(std::span<int32_t> values, size_t maxVectors) {
+    size_t vectors = 0;
+
+    while (vectors < maxVectors) {
+        const std::string_view line = nextLine();
+        if (line.empty()) break;
+
+        const char *cursor = line.data();
+        const char *lineEnd = line.data() + line.size();
+
+        for (size_t c = 0; c < columns.size(); c++) {
+            while (cursor < lineEnd && (*cursor == ' ' || *cursor == '\t')) cursor++;
+
+            int32_t value;
+            const auto [next, error] = std::from_chars(cursor, lineEnd, value);
+            if (error != std::errc()) {
+                throw std::runtime_error("stimulus line " + std::to_string(lineNumber) + ": expected a value for "
+                                         + columns[c]);
+            }
+            cursor = next;
+
+            while (cursor < lineEnd && (*cursor == ' ' || *cursor == '\t')) cursor++;
+            if (cursor < lineEnd && c + 1 < columns.size() && *cursor == ',') {
+                cursor++;
+            } else if (cursor != lineEnd || c + 1 < columns.size()) {
+                throw std::runtime_error("stimulus line " + std::to_string(lineNumber) + ": expected "
+                                         + std::to_string(columns.size()) + " values");
+            }
+
+            values[c * maxVectors + vectors] = value;
+        }
+
+        vectors++;
+    }
+
+    return vectors;
+}
+
+size_t StimulusReader::readBinary(std::span<int32_t> values, size_t maxVectors) {
+    size_t vectors = 0;
+
+    while (vectors < maxVectors) {
+        if (blockPosition == blockVectors && !readBlock()) break;
+
+        const size_t count = std::min(maxVectors - vectors, blockVectors - blockPosition);
+        for (size_t c = 0; c < columns.size(); c++) {
+            const int32_t *source = &block[c * blockVectors + blockPosition];
+            std::copy(source, source + count, &values[c * maxVectors + vectors]);
+        }
+
+        blockPosition += count;
+        vectors += count;
+    }
+
+    return vectors;
+}
+
+std::string_view StimulusReader::nextLine() {
+    while (true) {
+        const char *begin = buffer.data() + position;
+        const char *newline = static_cast<const char *>(std::memchr(begin, '\n', end - position));
+
+        if (newline || in.rdbuf()->sgetc() == EOF) {
+            const size_t length = newline ? newline - begin : end - position;
+            position += newline ? length + 1 : length;
+            lineNumber++;
+
+            std::string_view line(begin, length);
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+
+            if (!line.empty()) return line;
+            if (!newline) return {};
+            continue;
+        }
+
+        // keep the partial line, making room for at least as much again
+        std::memmove(buffer.data(), begin, end - position);
+        end -= position;
+        position = 0;
+        if (end == buffer.size()) {
+            buffer.resize(buffer.size() * 2);
+        }
+
+        end += in.rdbuf()->sgetn(buffer.data() + end, static_cast<std::streamsize>(buffer.size() - end));
+    }
+}
+
+bool StimulusReader::readBlock() {
+    uint32_t count;
+    if (!in.read(reinterpret_cast<char *>(&count), sizeof count)) {
+        if (in.gcount() != 0) {
+            throw std::runtime_error("truncated binary stimulus");
+        }
+        return false;
+    }
+
+    // a corrupted count fails on the missing data instead of allocating all of it up front
+    const size_t total = size_t(count) * columns.size();
+    block.clear();
+    while (block.size() < total) {
+        const size_t offset = block.size();
+        block.resize(offset + std::min(total - offset, BLOCK_PIECE_VALUES));
+        if (!in.read(reinterpret_cast<char *>(block.data() + offset),
+                     static_cast<std::streamsize>((block.size() - offset) * sizeof(int32_t)))) {
+            throw std::runtime_error("truncated binary stimulus");
+        }
+    }
+
+    blockVectors = count;
+    blockPosition = 0;
+    return true;
+}
+
+StimulusWriter::StimulusWriter(std::ostream& _out, StimulusFormat _format, const std::vector<std::string>& columns)
+    : out(_out), format(_format), columnsCount(columns.size()) {
+    if (format == StimulusFormat::Csv) {
+        for (size_t c = 0; c < columns.size(); c++) {
+            if (c > 0) buffer += ',';
+            buffer += columns[c];
+        }
+        buffer += '\n';
+        return;
+    }
+
+    StimulusHeader header{};
+    std::copy(std::begin(StimulusHeader::MAGIC), std::end(StimulusHeader::MAGIC), header.magic);
+    header.version = StimulusHeader::VERSION;
+    header.columnsCount = columns.size();
+    buffer.append(reinterpret_cast<const char *>(&header), sizeof header);
+
+    for (const std::string &name : columns) {
+        const auto length = static_cast<uint32_t>(name.size());
+        buffer.append(reinterpret_cast<const char *>(&length), sizeof length);
+        buffer += name;
+    }
+}
+
+void StimulusWriter::write(std::span<const int32_t> values, size_t stride, size_t vectorsCount) {
+    if (vectorsCount == 0) return;
+
+    if (format == StimulusFormat::Binary) {
+        flush();
+
+        const auto count = static_cast<uint32_t>(vectorsCount);
+        out.write(reinterpret_cast<const char *>(&count), sizeof count);
+        for (size_t c = 0; c < columnsCount; c++) {
+            out.write(reinterpret_cast<const char *>(&values[c * stride]),
+                      static_cast<std::streamsize>(vectorsCount * sizeof(int32_t)));
+        }
+        return;
+    }
+
+    char number[16];
+    for (size_t v = 0; v < vectorsCount; v++) {
+        for (size_t c = 0; c < columnsCount; c++) {
+            if (c > 0) buffer += ',';
+            const auto result = std::to_chars(number, number + sizeof number, values[c * stride + v]);
+            buffer.append(number, result.ptr);
+        }
+        buffer += '\n';
+
+        if (buffer.size() >= BUFFER_SIZE) {
+            flush();
+        }
+    }
+}
+
+void StimulusWriter::flush() {
+    if (!out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()))) {
+        throw std::runtime_error("failed to write vectors");
+    }
+    buffer.clear();
+}
@@ -0,0 +1,118 @@
+#ifndef CIRCUIT_STIMULUS_H
+#define CIRCUIT_STIMULUS_H
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Formats of streams of vectors, each holding one integer per named column.
+ *
+ * CSV starts with a line of comma separated column names, followed by one line of comma separated
+ * values per vector. Empty lines are skipped.
+ *
+ * The binary format is columnar: a StimulusHeader, the column names (uint32_t length followed by
+ * the chars), and then blocks until the end of the file. A block is a uint32_t count of vectors,
+ * followed by that many int32_t values of the first column, then of the second one, and so on.
+ */
+enum class StimulusFormat {
+    Csv,
+    Binary,
+};
+
+struct StimulusHeader {
+    constexpr static char MAGIC[4] = {'C', 'I', 'R', 'S'};
+    constexpr static uint32_t VERSION = 1;
+
+    char magic[4];
+    uint32_t version;
+    uint32_t columnsCount;
+};
+
+/**
+ * Reads vectors in chunks, so that streams of any length pass through a fixed amount of memory.
+ */
+class StimulusReader {
+    std::istream &in;
+    StimulusFormat format;
+    std::vector<std::string> columns;
+
+    // CSV text read ahead, of which [position, end) is still to be parsed
+    std::vector<char> buffer;
+    size_t position = 0, end = 0;
+    size_t lineNumber = 0;
+
+    // the binary block being read, `blockVectors` vectors of which `blockPosition` were read already
+    std::vector<int32_t> block;
+    size_t blockVectors = 0, blockPosition = 0;
+
+    constexpr static size_t BUFFER_SIZE = 1 << 20;
+
+    // sizes read from a binary stimulus are only trusted as far as the data behind them goes: names
+    // are limited in length, and blocks are read this many values at a time
+    constexpr static uint32_t MAX_NAME_LENGTH = 1 << 16;
+    constexpr static size_t BLOCK_PIECE_VALUES = 1 << 16;
+
+public:
+    /**
+     * Reads the column names right away.
+     */
+    StimulusReader(std::istream& _in, StimulusFormat _format);
+
+    [[nodiscard]]
+    const std::vector<std::string>& getColumns() const { return columns; }
+
+    /**
+     * Reads up to `maxVectors` vectors, the value of column `c` of vector `v` going to
+     * `values[c * maxVectors + v]`. Returns how many vectors were read, 0 at the end of the stream.
+     */
+    size_t read(std::span<int32_t> values, size_t maxVectors);
+
+private:
+    size_t readCsv(std::span<int32_t> values, size_t maxVectors);
+
+    size_t readBinary(std::span<int32_t> values, size_t maxVectors);
+
+    /**
+     * The next non-empty line without its line break, empty at the end of the stream. Stays valid
+     * until the next call.
+     */
+    std::string_view nextLine();
+
+    bool readBlock();
+};
+
+/**
+ * Writes vectors in the same formats, buffering the text of CSV.
+ */
+class StimulusWriter {
+    std::ostream &out;
+    StimulusFormat format;
+    size_t columnsCount;
+    std::string buffer;
+
+    constexpr static size_t BUFFER_SIZE = 1 << 20;
+
+public:
+    /**
+     * Writes the column names right away.
+     */
+    StimulusWriter(std::ostream& _out, StimulusFormat _format, const std::vector<std::string>& columns);
+
+    /**
+     * Writes `vectorsCount` vectors laid out like the ones `StimulusReader::read()` fills in, with
+     * columns `stride` values apart.
+     */
+    void write(std::span<const int32_t> values, size_t stride, size_t vectorsCount);
+
+    /**
+     * Writes out everything buffered. Throws if writing failed.
+     */
+    void flush();
+};
+
+#endif //CIRCUIT_STIMULUS_H
@@ -0,0 +1,333 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <stdexcept>
+
+static void writeVarint(std::string& buffer, uint64_t value) {
+    while (value >= 0x80) {
+        buffer.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back(static_cast<char>(value));
+}
+
+static uint32_t zigzag(int32_t value) {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value) {
+    return static_cast<int32_t>((value >> 1) ^ (0u - (value & 1)));
+}
+
+TraceRecorder::TraceRecorder(const CompiledCircuit& _circuit, const std::vector<Probe>& probes, std::ostream& _out)
+    : circuit(_circuit), out(_out) {
+    std::string buffer;
+
+    TraceHeader header{};
+    std::copy(std::begin(TraceHeader::MAGIC), std::end(TraceHeader::MAGIC), header.magic);
+    header.version = TraceHeader::VERSION;
+    header.signalsCount = probes.size();
+    buffer.append(reinterpret_cast<const char *>(&header), sizeof header);
+
+    for (const Probe &probe : probes) {
+        const bool isKnown = probe.slot < circuit.getProgram().evaluableSlotsCount;
+        const CircuitGate::PinType type = probe.slot < circuit.getSlotsCount()
+                                          ? circuit.getSlotType(probe.slot)
+                                          : CircuitGate::UNSET;
+
+        slots.push_back(probe.slot);
+        types.push_back(type);
+        known.push_back(isKnown);
+
+        buffer.push_back(static_cast<char>(isKnown ? type : type | TraceHeader::UNKNOWN));
+        writeVarint(buffer, probe.name.size());
+        buffer += probe.name;
+    }
+
+    if (!out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()))) {
+        throw std::runtime_error("failed to write trace");
+    }
+
+    chunkSize = std::max<size_t>(1, RING_VALUES / RING_CHUNKS / std::max<size_t>(1, slots.size()));
+    capacity = chunkSize * RING_CHUNKS;
+    values.resize(capacity * slots.size());
+    times.resize(capacity);
+    written.assign(slots.size(), 0);
+
+    writer = std::jthread([this] { writeSamples(); });
+}
+
+TraceRecorder::~TraceRecorder() {
+    try {
+        finish();
+    } catch (const std::exception &) {
+        // nobody left to tell
+    }
+}
+
+void TraceRecorder::record(Time time) {
+    if (time < lastTime) {
+        throw std::runtime_error("trace samples must be recorded in order");
+    }
+    lastTime = time;
+
+    const uint64_t sample = head.load(std::memory_order_relaxed);
+    if (sample - tail.load(std::memory_order_acquire) == capacity) {
+        std::unique_lock lock(mutex);
+        spaceAvailable.wait(lock, [&] { return sample - tail.load() < capacity; });
+    }
+
+    const size_t index = sample % capacity;
+    const int32_t *source = circuit.values.data();
+    int32_t *destination = values.data() + index * slots.size();
+    for (size_t s = 0; s < slots.size(); s++) {
+        destination[s] = known[s] ? source[slots[s]] : 0;
+    }
+    times[index] = time;
+
+    head.store(sample + 1, std::memory_order_release);
+
+    // the writer is only woken up once there is a whole chunk for it
+    if ((sample + 1) % chunkSize == 0) {
+        std::lock_guard lock(mutex);
+        dataAvailable.notify_one();
+    }
+}
+
+void TraceRecorder::finish() {
+    if (writer.joinable()) {
+        {
+            std::lock_guard lock(mutex);
+            finishing = true;
+        }
+        dataAvailable.notify_one();
+        writer.join();
+    }
+
+    if (failed) {
+        throw std::runtime_error("failed to write trace");
+    }
+}
+
+void TraceRecorder::writeSamples() {
+    std::string buffer;
+    bool done = false;
+
+    while (!done) {
+        uint64_t end;
+        {
+            std::unique_lock lock(mutex);
+            dataAvailable.wait(lock, [&] { return head - tail >= chunkSize || finishing; });
+            end = head;
+            done = finishing;
+        }
+
+        // samples up to `end` stay put until `tail` moves past them
+        for (uint64_t sample = tail; sample < end; sample++) {
+            encodeSample(sample % capacity, buffer);
+        }
+
+        if (done && skippedTime) {
+            writeVarint(buffer, *skippedTime - writtenTime);
+            buffer.push_back(0);
+        }
+
+        if (!failed && !out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()))) {
+            failed = true;
+        }
+        buffer.clear();
+
+        {
+            std::lock_guard lock(mutex);
+            tail = end;
+        }
+        spaceAvailable.notify_one();
+    }
+
+    if (!failed && !out.flush()) {
+        failed = true;
+    }
+}
+
+void TraceRecorder::encodeSample(size_t index, std::string& buffer) {
+    const size_t start = buffer.size();
+    const int32_t *sample = values.data() + index * slots.size();
+
+    writeVarint(buffer, times[index] - writtenTime);
+
+    uint32_t previous = UINT32_MAX;
+    for (uint32_t s = 0; s < slots.size(); s++) {
+        const int32_t value = types[s] == CircuitGate::Bool ? sample[s] != 0 : sample[s];
+        if (value == written[s]) continue;
+
+        // the first distance wraps around from -1
+        writeVarint(buffer, s - previous);
+        if (types[s] != CircuitGate::Bool) {
+            writeVarint(buffer, zigzag(static_cast<int32_t>(static_cast<uint32_t>(value)
+                                                            - static_cast<uint32_t>(written[s]))));
+        }
+
+        written[s] = value;
+        previous = s;
+    }
+
+    if (previous == UINT32_MAX && writtenCount > 0) {
+        buffer.resize(start);
+        skippedTime = times[index];
+        return;
+    }
+
+    buffer.push_back(0);
+    writtenTime = times[index];
+    writtenCount++;
+    skippedTime.reset();
+}
+
+TraceReader::TraceReader(std::istream& _in) : in(_in) {
+    TraceHeader header{};
+    if (!in.read(reinterpret_cast<char *>(&header), sizeof header)
+        || !std::equal(std::begin(TraceHeader::MAGIC), std::end(TraceHeader::MAGIC), header.magic)) {
+        throw std::runtime_error("not a trace");
+    }
+    if (header.version != TraceHeader::VERSION) {
+        throw std::runtime_error("unsupported trace version " + std::to_string(header.version));
+    }
+
+    for (uint32_t s = 0; s < header.signalsCount; s++) {
+        const int type = in.rdbuf()->sbumpc();
+        const auto pinType = static_cast<CircuitGate::PinType>(type & ~TraceHeader::UNKNOWN);
+        if (type == EOF || pinType > CircuitGate::Bool) {
+            throw std::runtime_error("corrupt trace");
+        }
+
+        std::string name(readVarint(), '\0');
+        if (in.rdbuf()->sgetn(name.data(), static_cast<std::streamsize>(name.size()))
+            != static_cast<std::streamsize>(name.size())) {
+            throw std::runtime_error("truncated trace");
+        }
+
+        names.push_back(std::move(name));
+        types.push_back(pinType);
+        known.push_back(!(type & TraceHeader::UNKNOWN));
+    }
+
+    values.assign(names.size(), 0);
+}
+
+bool TraceReader::next() {
+    if (in.rdbuf()->sgetc() == EOF) return false;
+
+    time += readVarint();
+    changed.clear();
+
+    int64_t signal = -1;
+    while (const uint64_t distance = readVarint()) {
+        if (distance >= names.size() - signal) {
+            throw std::runtime_error("corrupt trace");
+        }
+        signal += static_cast<int64_t>(distance);
+
+        if (types[signal] == CircuitGate::Bool) {
+            values[signal] ^= 1;
+        } else {
+            values[signal] = static_cast<int32_t>(static_cast<uint32_t>(values[signal])
+                                                  + static_cast<uint32_t>(unzigzag(readVarint())));
+        }
+        changed.push_back(signal);
+    }
+
+    return true;
+}
+
+uint64_t TraceReader::readVarint() {
+    uint64_t value = 0;
+
+    for (int shift = 0; shift < 64; shift += 7) {
+        const int byte = in.rdbuf()->sbumpc();
+        if (byte == EOF) {
+            throw std::runtime_error("truncated trace");
+        }
+
+        value |= uint64_t(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return value;
+    }
+
+    throw std::runtime_error("corrupt trace");
+}
+
+// printable identifiers, as short as possible
+static std::string getVcdIdentifier(size_t signal) {
+    std::string identifier;
+    do {
+        identifier.push_back(static_cast<char>('!' + signal % 94));
+        signal /= 94;
+    } while (signal > 0);
+
+    return identifier;
+}
+
+static void writeVcdValue(std::ostream& out, const TraceReader& trace, size_t signal, const std::string& identifier) {
+    const bool isBool = trace.getType(signal) == CircuitGate::Bool;
+
+    if (!trace.isKnown(signal)) {
+        out << (isBool ? "x" : "bx ") << identifier << '\n';
+    } else if (isBool) {
+        out << trace.getValue(signal) << identifier << '\n';
+    } else {
+        const auto value = static_cast<uint32_t>(trace.getValue(signal));
+
+        out << 'b';
+        for (int bit = value ? 31 - std::countl_zero(value) : 0; bit >= 0; bit--) {
+            out << ((value >> bit) & 1);
+        }
+        out << ' ' << identifier << '\n';
+    }
+}
+
+void exportVcd(TraceReader& trace, std::ostream& out) {
+    std::vector<std::string> identifiers;
+    for (size_t s = 0; s < trace.getSignalsCount(); s++) {
+        identifiers.push_back(getVcdIdentifier(s));
+    }
+
+    // one time unit per cycle, or per tick of an event-driven simulation
+    out << "$version circuit $end\n"
+           "$timescale 1ns $end\n"
+           "$scope module circuit $end\n";
+
+    for (size_t s = 0; s < trace.getSignalsCount(); s++) {
+        std::string name = trace.getName(s);
+        std::replace_if(name.begin(), name.end(), [](char c) { return std::isspace(static_cast<unsigned char>(c)); }, '_');
+
+        if (trace.getType(s) == CircuitGate::Bool) {
+            out << "$var wire 1 " << identifiers[s] << ' ' << name << " $end\n";
+        } else {
+            out << "$var integer 32 " << identifiers[s] << ' ' << name << " $end\n";
+        }
+    }
+
+    out << "$upscope $end\n"
+           "$enddefinitions $end\n";
+
+    if (!trace.next()) return;
+
+    out << '#' << trace.getTime() << "\n$dumpvars\n";
+    for (size_t s = 0; s < trace.getSignalsCount(); s++) {
+        writeVcdValue(out, trace, s, identifiers[s]);
+    }
+    out << "$end\n";
+
+    TraceReader::Time time = trace.getTime();
+    while (trace.next()) {
+        if (trace.getTime() != time) {
+            time = trace.getTime();
+            out << '#' << time << '\n';
+        }
+
+        for (uint32_t s : trace.getChanged()) {
+            writeVcdValue(out, trace, s, identifiers[s]);
+        }
+    }
+}
@@ -0,0 +1,179 @@
+#ifndef CIRCUIT_TRACE_H
+#define CIRCUIT_TRACE_H
+
+#include "../compiler/compiled-circuit.h"
+#include <atomic>
+#include <condition_variable>
+#include <istream>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * On-disk layout of a trace: this header, `signalsCount` signals and then samples until the end of
+ * the file. All variable-length integers are LEB128 varints.
+ *
+ * A signal is its type (uint8_t, a CircuitGate::PinType, with UNKNOWN set if the signal's value is
+ * never known), the length of its name and the name. A sample is the time elapsed since the
+ * previous sample, then for every signal whose value changed the distance from the previously
+ * changed signal (from -1 for the first one), and a 0 ending the list. An Int signal's index is
+ * followed by the zigzag-encoded difference from its previous value, while a Bool signal which
+ * changed has simply flipped. All signals are 0 before the first sample.
+ */
+struct TraceHeader {
+    constexpr static char MAGIC[4] = {'C', 'I', 'R', 'T'};
+    constexpr static uint32_t VERSION = 1;
+    constexpr static uint8_t UNKNOWN = 0x80;
+
+    char magic[4];
+    uint32_t version;
+    uint32_t signalsCount;
+};
+
+/**
+ * Records the values of selected slots of a compiled circuit over time into a trace file. Samples
+ * are copied into a ring buffer, which a background thread encodes and writes out, so recording a
+ * sample costs little more than copying the values, and memory use doesn't grow with the length of
+ * the trace. If the writer falls behind, `record()` waits for it.
+ */
+class TraceRecorder {
+public:
+    using Time = uint64_t;
+
+    struct Probe {
+        std::string name;
+        CompiledCircuit::SlotIndex slot;
+    };
+
+private:
+    const CompiledCircuit &circuit;
+    std::ostream &out;
+
+    std::vector<CompiledCircuit::SlotIndex> slots;
+    std::vector<CircuitGate::PinType> types;
+    std::vector<bool> known;
+
+    // ring of `capacity` samples, each `slots.size()` values; samples [tail, head) are waiting to be written
+    std::vector<int32_t> values;
+    std::vector<Time> times;
+    size_t capacity, chunkSize;
+    std::atomic<uint64_t> head = 0, tail = 0;
+    Time lastTime = 0;
+
+    std::mutex mutex;
+    std::condition_variable dataAvailable, spaceAvailable;
+    bool finishing = false;
+
+    // what the writer last encoded, which every sample is encoded against
+    std::vector<int32_t> written;
+    Time writtenTime = 0;
+    uint64_t writtenCount = 0;
+
+    // samples which changed nothing are left out, except for the last one, which marks the end of the trace
+    std::optional<Time> skippedTime;
+    bool failed = false;
+
+    // declared last, so that it is joined before anything it uses is destroyed
+    std::jthread writer;
+
+    // how many values the ring holds, spread over as many samples as fit
+    constexpr static size_t RING_VALUES = 1 << 22;
+    constexpr static size_t RING_CHUNKS = 8;
+
+public:
+    /**
+     * Writes the header right away. `out` belongs to the recorder until `finish()`.
+     */
+    TraceRecorder(const CompiledCircuit& _circuit, const std::vector<Probe>& probes, std::ostream& _out);
+
+    ~TraceRecorder();
+
+    TraceRecorder(const TraceRecorder&) = delete;
+
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+    /**
+     * Samples the probed slots at `time`, which must not be earlier than the previous sample's.
+     */
+    void record(Time time);
+
+    /**
+     * Writes out every recorded sample and stops the writer. Throws if writing failed.
+     */
+    void finish();
+
+    [[nodiscard]]
+    uint64_t getSamplesCount() const { return head; }
+
+private:
+    void writeSamples();
+
+    void encodeSample(size_t index, std::string& buffer);
+};
+
+/**
+ * Reads a trace one sample at a time.
+ */
+class TraceReader {
+public:
+    using Time = TraceRecorder::Time;
+
+private:
+    std::istream &in;
+
+    std::vector<std::string> names;
+    std::vector<CircuitGate::PinType> types;
+    std::vector<bool> known;
+
+    std::vector<int32_t> values;
+    std::vector<uint32_t> changed;
+    Time time = 0;
+
+public:
+    explicit TraceReader(std::istream& _in);
+
+    /**
+     * Moves to the next sample. Returns false at the end of the trace.
+     */
+    bool next();
+
+    [[nodiscard]]
+    size_t getSignalsCount() const { return names.size(); }
+
+    [[nodiscard]]
+    const std::string& getName(size_t signal) const { return names[signal]; }
+
+    [[nodiscard]]
+    CircuitGate::PinType getType(size_t signal) const { return types[signal]; }
+
+    /**
+     * False for signals which could not be evaluated, whose value is meaningless.
+     */
+    [[nodiscard]]
+    bool isKnown(size_t signal) const { return known[signal]; }
+
+    [[nodiscard]]
+    Time getTime() const { return time; }
+
+    [[nodiscard]]
+    int32_t getValue(size_t signal) const { return values[signal]; }
+
+    /**
+     * Signals whose value changed in the current sample, in increasing order.
+     */
+    [[nodiscard]]
+    const std::vector<uint32_t>& getChanged() const { return changed; }
+
+private:
+    uint64_t readVarint();
+};
+
+/**
+ * Converts a trace to a Value Change Dump, readable by standard waveform viewers.
+ */
+void exportVcd(TraceReader& trace, std::ostream& out);
+
+#endif //CIRCUIT_TRACE_H
@@ -8,3 +8,5 @@ void CircuitGate_Add::acceptVisitor(CircuitVisitor &visitor) { visitor.visit(*th
 void CircuitGate_Mul::acceptVisitor(CircuitVisitor &visitor) { visitor.visit(*this); }
 
 void CircuitGate_CmpLe::acceptVisitor(CircuitVisitor &visitor) { visitor.visit(*this); }
+
+void CircuitGate_IntRegister::acceptVisitor(CircuitVisitor &visitor) { visitor.visit(*this); }
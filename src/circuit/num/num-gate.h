@@ -6,7 +6,7 @@
 struct CircuitVisitor;
 
 struct CircuitGate_ConstInt : public CircuitGate {
-    explicit CircuitGate_ConstInt(ImVec2 _pos) : CircuitGate({}, {Int}, _pos) { }
+    explicit CircuitGate_ConstInt(CircuitGraph& _graph, Position _pos) : CircuitGate(_graph, {}, {Int}, _pos) { }
 
     [[nodiscard]]
     std::string getName() const override { return "Constant"; }
@@ -17,7 +17,7 @@ struct CircuitGate_ConstInt : public CircuitGate {
 };
 
 struct CircuitGate_Add : public CircuitGate {
-    explicit CircuitGate_Add(ImVec2 _pos) : CircuitGate({Int, Int}, {Int}, _pos) { }
+    explicit CircuitGate_Add(CircuitGraph& _graph, Position _pos) : CircuitGate(_graph, {Int, Int}, {Int}, _pos) { }
 
     [[nodiscard]]
     std::string getName() const override { return "Add"; }
@@ -26,7 +26,7 @@ struct CircuitGate_Add : public CircuitGate {
 };
 
 struct CircuitGate_Mul : public CircuitGate {
-    explicit CircuitGate_Mul(ImVec2 _pos) : CircuitGate({Int, Int}, {Int}, _pos) { }
+    explicit CircuitGate_Mul(CircuitGraph& _graph, Position _pos) : CircuitGate(_graph, {Int, Int}, {Int}, _pos) { }
 
     [[nodiscard]]
     std::string getName() const override { return "Multiply"; }
@@ -35,7 +35,7 @@ struct CircuitGate_Mul : public CircuitGate {
 };
 
 struct CircuitGate_CmpLe : public CircuitGate {
-    explicit CircuitGate_CmpLe(ImVec2 _pos) : CircuitGate({Int, Int}, {Bool}, _pos) { }
+    explicit CircuitGate_CmpLe(CircuitGraph& _graph, Position _pos) : CircuitGate(_graph, {Int, Int}, {Bool}, _pos) { }
 
     [[nodiscard]]
     std::string getName() const override { return "Compare (<=)"; }
@@ -43,4 +43,18 @@ struct CircuitGate_CmpLe : public CircuitGate {
     void acceptVisitor(CircuitVisitor& visitor) override;
 };
 
+/**
+ * Int counterpart of `CircuitGate_Register`.
+ */
+struct CircuitGate_IntRegister : public CircuitGate {
+    explicit CircuitGate_IntRegister(CircuitGraph& _graph, Position _pos) : CircuitGate(_graph, {Int}, {Int}, _pos) { }
+
+    [[nodiscard]]
+    std::string getName() const override { return "Register (int)"; }
+
+    int value = 0;
+
+    void acceptVisitor(CircuitVisitor& visitor) override;
+};
+
 #endif //CIRCUIT_NUM_GATE_H
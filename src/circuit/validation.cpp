@@ -0,0 +1,170 @@
+#include "validation.h"
+#include "circuit.h"
+#include "visitor.h"
+
+#include <algorithm>
+
+// registers read their input on clock edges only, which cuts every combinational path through them
+struct CircuitVisitor_IsRegister : public CircuitVisitor {
+    bool isRegister = false;
+
+    void visit(CircuitGate_Register&) override { isRegister = true; }
+
+    void visit(CircuitGate_IntRegister&) override { isRegister = true; }
+};
+
+static const char *getTypeName(CircuitGate::PinType type) {
+    switch (type) {
+        case CircuitGate::Int: return "Int";
+        case CircuitGate::Bool: return "Bool";
+        default: return "untyped";
+    }
+}
+
+CircuitValidation::CircuitValidation(const Circuit& circuit) : revision(circuit.getRevision()) {
+    const size_t n = circuit.getGatesCount();
+    std::vector<bool> registers(n, false);
+    std::vector<uint32_t> pendingInputs(n, 0);
+    // fan-out lists in CSR form, combinational links only
+    std::vector<uint32_t> fanoutBegin(n + 1, 0);
+
+    evaluable.assign(n, false);
+    faulty.assign(n, false);
+
+    for (GateID g = 0; g < n; g++) {
+        CircuitVisitor_IsRegister visitor;
+        circuit[g].acceptVisitor(visitor);
+        registers[g] = visitor.isRegister;
+    }
+
+    // an unconnected register input only keeps the register's state, so it is no problem
+    for (GateID g = 0; g < n; g++) {
+        const std::span<const CircuitGate::InputPin> inputs = circuit[g].getInputs();
+
+        for (size_t i = 0; i < inputs.size(); i++) {
+            const CircuitGate::InputPin &input = inputs[i];
+
+            if (input.destGate == CircuitGate::NO_GATE) {
+                if (!registers[g]) {
+                    diagnostics.push_back({Diagnostic::UnconnectedInput, g, i, {}});
+                    faulty[g] = true;
+                }
+                continue;
+            }
+
+            if (circuit[input.destGate].getOutputType(input.destSlotIndex) != input.type) {
+                diagnostics.push_back({Diagnostic::TypeMismatch, g, i, {}});
+                faulty[g] = true;
+            }
+
+            if (!registers[g]) {
+                fanoutBegin[input.destGate + 1]++;
+                pendingInputs[g]++;
+            }
+        }
+    }
+
+    for (size_t g = 0; g < n; g++) {
+        fanoutBegin[g + 1] += fanoutBegin[g];
+    }
+
+    std::vector<uint32_t> fanout(fanoutBegin[n]);
+    std::vector<uint32_t> cursor(fanoutBegin.begin(), fanoutBegin.end() - 1);
+    for (GateID g = 0; g < n; g++) {
+        if (registers[g]) continue;
+
+        for (const auto &input : circuit[g].getInputs()) {
+            if (input.destGate != CircuitGate::NO_GATE) {
+                fanout[cursor[input.destGate]++] = g;
+            }
+        }
+    }
+
+    // Kahn's algorithm; a gate is evaluable once all of its sources turned out to be, and the
+    // gates it never reaches are on a cycle or downstream of one
+    std::vector<GateID> ready;
+    std::vector<bool> ordered(n, false);
+    for (GateID g = 0; g < n; g++) {
+        evaluable[g] = !faulty[g];
+        if (pendingInputs[g] == 0) ready.push_back(g);
+    }
+
+    while (!ready.empty()) {
+        const GateID g = ready.back();
+        ready.pop_back();
+        ordered[g] = true;
+
+        for (uint32_t f = fanoutBegin[g]; f < fanoutBegin[g + 1]; f++) {
+            const GateID consumer = fanout[f];
+            if (!evaluable[g]) evaluable[consumer] = false;
+            if (--pendingInputs[consumer] == 0) ready.push_back(consumer);
+        }
+    }
+
+    // every unordered gate reads from another unordered one, so walking back along such inputs
+    // always ends on a cycle; each walk stops where an earlier one went, reporting every gate once
+    std::vector<uint32_t> walks(n, 0);
+    uint32_t walk = 0;
+    for (GateID start = 0; start < n; start++) {
+        if (ordered[start]) continue;
+        evaluable[start] = false;
+        if (walks[start] != 0) continue;
+
+        walk++;
+        std::vector<GateID> path;
+        GateID g = start;
+        while (walks[g] == 0) {
+            walks[g] = walk;
+            path.push_back(g);
+
+            for (const auto &input : circuit[g].getInputs()) {
+                if (input.destGate != CircuitGate::NO_GATE && !ordered[input.destGate]) {
+                    g = input.destGate;
+                    break;
+                }
+            }
+        }
+
+        if (walks[g] != walk) continue;
+
+        Diagnostic diagnostic{Diagnostic::CombinationalCycle, g, 0, {}};
+        const auto first = std::find(path.begin(), path.end(), g);
+        diagnostic.cycle.assign(first, path.end());
+        for (GateID member : diagnostic.cycle) {
+            faulty[member] = true;
+        }
+        diagnostics.push_back(std::move(diagnostic));
+    }
+}
+
+std::string CircuitValidation::describe(const Circuit& circuit, const Diagnostic& diagnostic,
+                                        std::span<const std::string> names) {
+    auto name = [&](GateID gate) {
+        if (gate < names.size()) return names[gate];
+        return "gate " + std::to_string(gate) + " (" + circuit[gate].getName() + ")";
+    };
+
+    switch (diagnostic.kind) {
+        case Diagnostic::UnconnectedInput:
+            return "input " + std::to_string(diagnostic.input) + " of " + name(diagnostic.gate) + " is not connected";
+
+        case Diagnostic::TypeMismatch: {
+            const CircuitGate::InputPin &input = circuit[diagnostic.gate].getInput(diagnostic.input);
+            const CircuitGate::PinType outputType = circuit[input.destGate].getOutputType(input.destSlotIndex);
+            return "input " + std::to_string(diagnostic.input) + " of " + name(diagnostic.gate) + " is "
+                   + getTypeName(input.type) + " but reads from " + getTypeName(outputType) + " output "
+                   + std::to_string(input.destSlotIndex) + " of " + name(input.destGate);
+        }
+
+        case Diagnostic::CombinationalCycle: {
+            std::string message = "combinational cycle through ";
+            for (size_t i = 0; i < diagnostic.cycle.size(); i++) {
+                if (i > 0) message += " <- ";
+                message += name(diagnostic.cycle[i]);
+            }
+            return message;
+        }
+    }
+
+    return {};
+}
@@ -0,0 +1,72 @@
+#ifndef CIRCUIT_VALIDATION_H
+#define CIRCUIT_VALIDATION_H
+
+#include "gate.h"
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+class Circuit;
+
+/**
+ * What is wrong with a circuit, found by one pass over the whole netlist: inputs left unconnected,
+ * inputs connected to an output of another type, and combinational cycles, i.e. ones which do not
+ * pass through a register. `Circuit::validate()` keeps the result until the next edit.
+ *
+ * A gate is evaluable when neither it nor anything in its combinational fan-in has a problem, which
+ * is all evaluation needs to know before it starts.
+ */
+class CircuitValidation {
+    using GateID = CircuitGate::GateID;
+
+public:
+    struct Diagnostic {
+        enum Kind : uint8_t {UnconnectedInput, TypeMismatch, CombinationalCycle};
+
+        Kind kind;
+        // the gate whose input is wrong, or any gate on the cycle
+        GateID gate;
+        size_t input = 0;
+        // the gates on a cycle, every one reading from the one after it, and the last from the first
+        std::vector<GateID> cycle;
+    };
+
+private:
+    uint64_t revision;
+    std::vector<Diagnostic> diagnostics;
+    std::vector<bool> evaluable, faulty;
+
+public:
+    explicit CircuitValidation(const Circuit& circuit);
+
+    [[nodiscard]]
+    std::span<const Diagnostic> getDiagnostics() const { return diagnostics; }
+
+    [[nodiscard]]
+    bool isValid() const { return diagnostics.empty(); }
+
+    [[nodiscard]]
+    bool isEvaluable(GateID gate) const { return gate < evaluable.size() && evaluable[gate]; }
+
+    /**
+     * Whether the gate itself has a problem, as opposed to only depending on one.
+     */
+    [[nodiscard]]
+    bool isFaulty(GateID gate) const { return gate < faulty.size() && faulty[gate]; }
+
+    /**
+     * The revision of the circuit this describes, see `Circuit::getRevision()`.
+     */
+    [[nodiscard]]
+    uint64_t getRevision() const { return revision; }
+
+    /**
+     * A one-line message about the problem. Gates are referred to by `names` if given, which are
+     * indexed by GateID, or by their ID and type otherwise.
+     */
+    static std::string describe(const Circuit& circuit, const Diagnostic& diagnostic,
+                                std::span<const std::string> names = {});
+};
+
+#endif //CIRCUIT_VALIDATION_H
@@ -1,91 +1,131 @@
 #ifndef CIRCUIT_VISITOR_H
 #define CIRCUIT_VISITOR_H
 
-#include <functional>
 #include "boolean/boolean-gate.h"
+#include "hierarchy/circuit-definition.h"
+#include "hierarchy/sub-circuit-gate.h"
 #include "num/num-gate.h"
+#include "validation.h"
 
 struct CircuitVisitor {
     virtual ~CircuitVisitor() = default;
 
     virtual void visit(CircuitGate_ConstTrue& gate) { (void) gate; };
+    virtual void visit(CircuitGate_ConstBool& gate) { (void) gate; };
     virtual void visit(CircuitGate_Not& gate) { (void) gate; };
     virtual void visit(CircuitGate_And& gate) { (void) gate; };
+    virtual void visit(CircuitGate_Register& gate) { (void) gate; };
 
     virtual void visit(CircuitGate_ConstInt& gate) { (void) gate; };
     virtual void visit(CircuitGate_Add& gate) { (void) gate; };
     virtual void visit(CircuitGate_Mul& gate) { (void) gate; };
     virtual void visit(CircuitGate_CmpLe& gate) { (void) gate; };
+    virtual void visit(CircuitGate_IntRegister& gate) { (void) gate; };
+
+    virtual void visit(CircuitGate_SubCircuit& gate) { (void) gate; };
 };
 
+/**
+ * Evaluates gates recursively, caching the results in their output pins. Only gates `validation`
+ * finds evaluable are entered, which rules out cycles and unconnected or mistyped inputs anywhere
+ * in their fan-in, so nothing below the entered gate needs checking.
+ */
 struct CircuitVisitor_Eval : public CircuitVisitor {
+    explicit CircuitVisitor_Eval(const CircuitValidation& _validation) : validation(_validation) { }
+
     void visit(CircuitGate_ConstTrue& gate) override {
-        gate.outputs[0].value = true;
-        gate.outputs[0].isEval = true;
+        gate.setOutputValue(0, true);
     }
 
-    void visit(CircuitGate_Not& gate) override {
-        if (!gate.canEval() || !evalInputs(gate)) {
-            isOk = false;
-            return;
-        }
-
-        if (gate.outputs[0].isEval) return;
+    void visit(CircuitGate_ConstBool& gate) override {
+        gate.setOutputValue(0, gate.value);
+    }
 
-        const CircuitGate::OutputPin& pin = gate.getOutputForInput(0);
-        gate.outputs[0].value = !get<bool>(pin.value);
-        gate.outputs[0].isEval = true;
+    void visit(CircuitGate_Not& gate) override {
+        visitOperation<bool, bool>(gate, CompiledCircuit::Not);
     }
 
     void visit(CircuitGate_And& gate) override {
-        visitBinary<bool, bool, bool>(gate, [](bool a, bool b) { return a && b; });
+        visitOperation<bool, bool>(gate, CompiledCircuit::And);
+    }
+
+    // registers output their state, so evaluation never follows their input and loops through them end
+    void visit(CircuitGate_Register& gate) override {
+        gate.setOutputValue(0, gate.value);
     }
 
     void visit(CircuitGate_ConstInt& gate) override {
-        gate.outputs[0].value = gate.value;
-        gate.outputs[0].isEval = true;
+        gate.setOutputValue(0, gate.value);
     }
 
     void visit(CircuitGate_Add& gate) override {
-        visitBinary<int, int, int>(gate, [](int a, int b) { return a + b; });
+        visitOperation<int, int>(gate, CompiledCircuit::Add);
     }
 
     void visit(CircuitGate_Mul& gate) override {
-        visitBinary<int, int, int>(gate, [](int a, int b) { return a * b; });
+        visitOperation<int, int>(gate, CompiledCircuit::Mul);
     }
 
     void visit(CircuitGate_CmpLe& gate) override {
-        visitBinary<int, int, bool>(gate, [](int a, int b) { return a <= b; });
+        visitOperation<int, bool>(gate, CompiledCircuit::CmpLe);
+    }
+
+    void visit(CircuitGate_IntRegister& gate) override {
+        gate.setOutputValue(0, gate.value);
+    }
+
+    void visit(CircuitGate_SubCircuit& gate) override {
+        if (!enter(gate)) return;
+        evalInputs(gate);
+
+        std::vector<int32_t> inputs(gate.getInputsCount()), outputs(gate.getOutputsCount());
+        for (size_t i = 0; i < inputs.size(); i++) {
+            inputs[i] = gate.getOutputForInput(i).value;
+        }
+
+        gate.getDefinition().evaluate(inputs, outputs);
+
+        for (size_t i = 0; i < outputs.size(); i++) {
+            gate.storeOutput(i, outputs[i]);
+        }
     }
 
     [[nodiscard]]
     bool didEvalCorrectly() const { return isOk; }
 
 private:
+    const CircuitValidation &validation;
     bool isOk = true;
 
-    bool evalInputs(CircuitGate& gate) {
-        for (size_t i = 0; i < gate.inputsCount; i++) {
-            gate.inputs[i].destGate->acceptVisitor(*this);
-            if (!gate.getOutputForInput(i).isEval) return false;
+    /**
+     * Returns false if the gate is already evaluated, which makes every gate entered at most once
+     * no matter how many paths lead to it, or if it cannot be evaluated.
+     */
+    bool enter(CircuitGate& gate) {
+        if (gate.graph->outputs.isEvaluated(gate.firstOutput)) return false;
+        if (!validation.isEvaluable(gate.getId())) {
+            isOk = false;
+            return false;
         }
 
         return true;
     }
 
-    template<typename U1, typename U2, typename T>
-    void visitBinary(CircuitGate& gate, std::function<T(U1, U2)> fn) {
-        if (!gate.canEval() || !evalInputs(gate)) {
-            isOk = false;
-            return;
+    void evalInputs(CircuitGate& gate) {
+        for (size_t i = 0; i < gate.inputsCount; i++) {
+            gate.getInputGate(i).acceptVisitor(*this);
         }
+    }
 
-        if (gate.outputs[0].isEval) return;
+    // the same arithmetic as compiled code, so Int overflow wraps around everywhere alike
+    template<typename In, typename Out>
+    void visitOperation(CircuitGate& gate, CompiledCircuit::OpCode op) {
+        if (!enter(gate)) return;
+        evalInputs(gate);
 
-        const CircuitGate::OutputPin& pin0 = gate.getOutputForInput(0);
-        const CircuitGate::OutputPin& pin1 = gate.getOutputForInput(1);
-        gate.outputs[0].value = fn(get<U1>(pin0.value), get<U2>(pin1.value));
-        gate.outputs[0].isEval = true;
+        const int32_t a = gate.getInputValue<In>(0);
+        const int32_t b = gate.inputsCount > 1 ? gate.getInputValue<In>(1) : 0;
+        gate.setOutputValue(0, static_cast<Out>(CompiledCircuit::evaluate(op, 0, a, b)));
     }
 };
 
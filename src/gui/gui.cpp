@@ -1,18 +1,28 @@
 #include "gui.h"
 #include "../circuit/visitor.h"
+#include "../circuit/compiler/compiled-circuit.h"
 
+#include <algorithm>
 #include <stdexcept>
 #include <GLFW/glfw3.h>
 #include <cmath>
 #include <sstream>
 #include <iostream>
+#include <string>
+#include <type_traits>
+#include <unordered_set>
 
 constexpr static ImU32 LINK_COLOR = IM_COL32(200, 200, 100, 255);
 constexpr static ImU32 GATE_COLOR = IM_COL32(60, 60, 60, 255);
 constexpr static ImU32 GATE_COLOR_HOVER = IM_COL32(70, 70, 70, 255);
 constexpr static ImU32 GATE_BORDER_COLOR = IM_COL32(100, 100, 100, 255);
+constexpr static ImU32 GATE_FAULTY_BORDER_COLOR = IM_COL32(220, 70, 70, 255);
+constexpr static ImVec4 ERROR_TEXT_COLOR = {0.86f, 0.27f, 0.27f, 1.0f};
 constexpr static ImU32 SLOT_COLOR = IM_COL32(150, 150, 150, 255);
 constexpr static ImU32 SLOT_COLOR_HOVER = IM_COL32(180, 180, 180, 255);
+constexpr static ImU32 VALUE_COLOR = IM_COL32(230, 230, 230, 255);
+constexpr static ImU32 HEATMAP_COLD_COLOR = IM_COL32(40, 60, 120, 160);
+constexpr static ImU32 HEATMAP_HOT_COLOR = IM_COL32(230, 200, 80, 255);
 
 static ImU32 getPinTypeColor(const CircuitGate::PinType &type) {
     if (type == CircuitGate::Any)
@@ -35,9 +45,86 @@ static inline ImVec2 operator+(const ImVec2 &lhs, const ImVec2 &rhs) { return Im
 
 static inline ImVec2 operator-(const ImVec2 &lhs, const ImVec2 &rhs) { return ImVec2(lhs.x - rhs.x, lhs.y - rhs.y); }
 
+static inline ImVec2 operator*(const ImVec2 &lhs, float rhs) { return ImVec2(lhs.x * rhs, lhs.y * rhs); }
+
+static inline ImVec2 operator/(const ImVec2 &lhs, float rhs) { return ImVec2(lhs.x / rhs, lhs.y / rhs); }
+
+static inline ImVec2 toImVec2(const CircuitGate::Position &pos) { return ImVec2(pos.x, pos.y); }
+
+static ImU32 lerpColor(ImU32 from, ImU32 to, float t) {
+    ImU32 result = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        const float a = static_cast<float>((from >> shift) & 0xFF), b = static_cast<float>((to >> shift) & 0xFF);
+        result |= static_cast<ImU32>(a + (b - a) * t) << shift;
+    }
+    return result;
+}
+
+static inline bool rectsOverlap(ImVec2 min1, ImVec2 max1, ImVec2 min2, ImVec2 max2) {
+    return min1.x <= max2.x && min2.x <= max1.x && min1.y <= max2.y && min2.y <= max1.y;
+}
+
 struct CircuitVisitor_RenderContent : public CircuitVisitor {
+    bool edited = false;
+
+    void visit(CircuitGate_ConstBool& gate) override {
+        if (ImGui::Checkbox("Value", &gate.value)) {
+            gate.invalidate();
+            edited = true;
+        }
+    }
+
     void visit(CircuitGate_ConstInt& gate) override {
-        ImGui::InputInt("Value", &gate.value);
+        if (ImGui::InputInt("Value", &gate.value)) {
+            gate.invalidate();
+            edited = true;
+        }
+    }
+
+    void visit(CircuitGate_Register& gate) override {
+        if (ImGui::Checkbox("State", &gate.value)) {
+            gate.invalidate();
+            edited = true;
+        }
+    }
+
+    void visit(CircuitGate_IntRegister& gate) override {
+        if (ImGui::InputInt("State", &gate.value)) {
+            gate.invalidate();
+            edited = true;
+        }
+    }
+
+    void visit(CircuitGate_SubCircuit& gate) override {
+        renderDefinition(gate.getDefinition());
+    }
+
+private:
+    // the definition is shared by every instance, so its contents are only shown, nested ones included
+    static void renderDefinition(const CircuitDefinition& definition) {
+        if (!ImGui::TreeNode("contents")) return;
+
+        for (const CircuitDefinition::Port &port : definition.getInputs()) {
+            ImGui::Text("in %s", port.name.c_str());
+        }
+        for (const CircuitDefinition::Port &port : definition.getOutputs()) {
+            ImGui::Text("out %s", port.name.c_str());
+        }
+
+        for (const CircuitGate *gate : definition.getCircuit().getGates()) {
+            const auto *instance = dynamic_cast<const CircuitGate_SubCircuit *>(gate);
+            if (!instance) {
+                ImGui::BulletText("%s [ID %u]", gate->getName().c_str(), gate->getId());
+                continue;
+            }
+
+            ImGui::PushID(static_cast<int>(gate->getId()));
+            ImGui::BulletText("%s [ID %u]", gate->getName().c_str(), gate->getId());
+            renderDefinition(instance->getDefinition());
+            ImGui::PopID();
+        }
+
+        ImGui::TreePop();
     }
 };
 
@@ -78,15 +165,60 @@ GLFWwindow *Gui::init() {
 
     ImGui::StyleColorsDark();
 
+    // the ImGui backend installs its own callbacks on top of these and chains to them
+    glfwSetWindowUserPointer(window, this);
+    glfwSetCursorPosCallback(window, [](GLFWwindow *w, double, double) { onInputEvent(w); });
+    glfwSetMouseButtonCallback(window, [](GLFWwindow *w, int, int, int) { onInputEvent(w); });
+    glfwSetScrollCallback(window, [](GLFWwindow *w, double, double) { onInputEvent(w); });
+    glfwSetKeyCallback(window, [](GLFWwindow *w, int, int, int, int) { onInputEvent(w); });
+    glfwSetCharCallback(window, [](GLFWwindow *w, unsigned int) { onInputEvent(w); });
+    glfwSetCursorEnterCallback(window, [](GLFWwindow *w, int) { onInputEvent(w); });
+    glfwSetWindowFocusCallback(window, [](GLFWwindow *w, int) { onInputEvent(w); });
+    glfwSetFramebufferSizeCallback(window, [](GLFWwindow *w, int, int) { onInputEvent(w); });
+    glfwSetWindowRefreshCallback(window, onInputEvent);
+
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init(glsl_version);
 
     return window;
 }
 
-void Gui::render(std::vector<CircuitGatePtr> &gates) {
-    // Poll and handle events (inputs, window resize, etc.)
-    glfwPollEvents();
+void Gui::onInputEvent(GLFWwindow *window) {
+    static_cast<Gui *>(glfwGetWindowUserPointer(window))->pendingFrames = SETTLE_FRAMES;
+}
+
+void Gui::requestRedraw() {
+    redrawRequested = true;
+    glfwPostEmptyEvent();
+}
+
+bool Gui::waitForFrame() {
+    if (pendingFrames > 0) {
+        glfwPollEvents();
+    } else {
+        glfwWaitEventsTimeout(IDLE_WAIT_TIMEOUT);
+
+        // an active text field blinks its cursor even if nothing happens
+        if (isAnimating)
+            pendingFrames = std::max(pendingFrames, 1);
+    }
+
+    if (redrawRequested.exchange(false))
+        pendingFrames = SETTLE_FRAMES;
+
+    if (pendingFrames == 0)
+        return false;
+
+    pendingFrames--;
+    return true;
+}
+
+void Gui::render(Circuit &circuit) {
+    // Wait for and handle events (inputs, window resize, etc.)
+    if (!waitForFrame())
+        return;
+
+    collectEvaluationResults(circuit);
 
     // Start the Dear ImGui frame
     ImGui_ImplOpenGL3_NewFrame();
@@ -105,7 +237,16 @@ void Gui::render(std::vector<CircuitGatePtr> &gates) {
                              | ImGuiWindowFlags_NoSavedSettings;
 
     if (ImGui::Begin("gate editor", nullptr, flags)) {
-        ImGui::Text("position: (%.2f,%.2f)", (double) state.scrolling.x, (double) state.scrolling.y);
+        ImGui::Text("position: (%.2f,%.2f) zoom: %.0f%%", (double) state.scrolling.x, (double) state.scrolling.y,
+                    (double) state.zoom * 100);
+        ImGui::SameLine();
+        if (ImGui::Button("clock")) {
+            // results still being computed are for the states from before the edge
+            onCircuitEdited();
+            circuit.clock();
+        }
+        renderEvaluationStatus();
+        renderDiagnostics(circuit);
         ImGui::SameLine(ImGui::GetWindowWidth() - 100);
         ImGui::Checkbox("Show grid", &state.showGrid);
 
@@ -113,21 +254,27 @@ void Gui::render(std::vector<CircuitGatePtr> &gates) {
         ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, ImVec2(0, 0));
         ImGui::PushStyleColor(ImGuiCol_ChildBg, IM_COL32(60, 60, 70, 200));
         ImGui::BeginChild("scrolling_region", ImVec2(0, 0), true,
-                          ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_NoMove);
+                          ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoScrollWithMouse);
         ImGui::PopStyleVar(); // WindowPadding
-        ImGui::PushItemWidth(120.0f);
+        ImGui::PushItemWidth(120.0f * state.zoom);
 
         if (state.showGrid)
             renderGrid();
 
-        renderGates(gates);
-        renderGatesLinks(gates);
+        // the visible part of the canvas, in the coordinates of gate positions
+        visibleMin = (ImGui::GetWindowPos() - state.scrolling) / state.zoom;
+        visibleMax = visibleMin + ImGui::GetWindowSize() / state.zoom;
+
+        renderGates(circuit);
+        renderGatesLinks(circuit);
 
         if (ImGui::IsWindowHovered() && !ImGui::IsAnyItemActive()
             && ImGui::IsMouseDragging(ImGuiMouseButton_Middle, 0.0f)) {
             state.scrolling = state.scrolling + io.MouseDelta;
         }
 
+        handleZoom();
+
         ImGui::PopItemWidth();
         ImGui::EndChild();
         ImGui::PopStyleColor();
@@ -135,6 +282,12 @@ void Gui::render(std::vector<CircuitGatePtr> &gates) {
     }
     ImGui::End();
 
+    isAnimating = ImGui::IsAnyItemActive();
+
+    // keep the progress bar moving
+    if (evaluator.isRunning())
+        pendingFrames = std::max(pendingFrames, 1);
+
     ImGui::Render();
     int display_w, display_h;
     glfwGetFramebufferSize(window, &display_w, &display_h);
@@ -161,71 +314,246 @@ void Gui::shutdown() {
 
 void Gui::renderGrid() {
     const ImU32 GRID_COLOR = IM_COL32(200, 200, 200, 40);
-    const float GRID_SZ = 64.0f;
+    float GRID_SZ = 64.0f * state.zoom;
+    while (GRID_SZ < 16.0f) // don't let the lines blend together when zoomed out
+        GRID_SZ *= 4;
     const ImVec2 win_pos = ImGui::GetCursorScreenPos();
     const ImVec2 canvas_sz = ImGui::GetWindowSize();
+    const ImVec2 offset(fmodf(state.scrolling.x, GRID_SZ), fmodf(state.scrolling.y, GRID_SZ));
     ImDrawList *draw_list = ImGui::GetWindowDrawList();
 
-    for (float x = fmodf(state.scrolling.x, GRID_SZ); x < canvas_sz.x; x += GRID_SZ)
-        draw_list->AddLine(ImVec2(x, 0.0f) + win_pos, ImVec2(x, canvas_sz.y) + win_pos, GRID_COLOR);
-    for (float y = fmodf(state.scrolling.y, GRID_SZ); y < canvas_sz.y; y += GRID_SZ)
-        draw_list->AddLine(ImVec2(0.0f, y) + win_pos, ImVec2(canvas_sz.x, y) + win_pos, GRID_COLOR);
+    auto equal = [](ImVec2 a, ImVec2 b) { return a.x == b.x && a.y == b.y; };
+    if (!equal(gridCache.origin, win_pos) || !equal(gridCache.size, canvas_sz) || !equal(gridCache.offset, offset)
+        || gridCache.spacing != GRID_SZ) {
+        gridCache.origin = win_pos;
+        gridCache.size = canvas_sz;
+        gridCache.offset = offset;
+        gridCache.spacing = GRID_SZ;
+        gridCache.lines.clear();
+
+        for (float x = offset.x; x < canvas_sz.x; x += GRID_SZ)
+            gridCache.lines.emplace_back(ImVec2(x, 0.0f) + win_pos, ImVec2(x, canvas_sz.y) + win_pos);
+        for (float y = offset.y; y < canvas_sz.y; y += GRID_SZ)
+            gridCache.lines.emplace_back(ImVec2(0.0f, y) + win_pos, ImVec2(canvas_sz.x, y) + win_pos);
+    }
+
+    for (const auto &[from, to]: gridCache.lines)
+        draw_list->AddLine(from, to, GRID_COLOR);
 }
 
-void Gui::renderGates(std::vector<CircuitGatePtr> &gates) {
+void Gui::renderGates(Circuit &circuit) {
     ImDrawList *drawList = ImGui::GetWindowDrawList();
     drawList->ChannelsSplit(2);
 
-    for (auto &gate: gates) {
-        renderGate(gate);
+    syncSpatialIndex(circuit);
+
+    const DetailLevel detailLevel = getDetailLevel();
+    if (detailLevel == HEATMAP) {
+        visibleGates.clear();
+        visibleLinks.clear();
+        renderHeatmap();
+        drawList->ChannelsMerge();
+        return;
     }
 
+    spatialIndex.query(visibleMin, visibleMax, visibleGates);
+    linkIndex.query(visibleMin, visibleMax, visibleLinks);
+
+    if (detailLevel == FULL_DETAIL)
+        ImGui::SetWindowFontScale(state.zoom);
+
+    for (CircuitGate::GateID id: visibleGates) {
+        CircuitGate &gate = circuit[id];
+
+        // the grid only narrows gates down to the cells they overlap
+        if (!rectsOverlap(toImVec2(gate.pos), toImVec2(gate.pos) + gatesRenderInfo[id].rectSize, visibleMin, visibleMax))
+            continue;
+
+        if (detailLevel == FULL_DETAIL) {
+            renderGate(circuit, gate);
+        } else {
+            renderGateBlock(gate);
+        }
+    }
+
+    ImGui::SetWindowFontScale(1.0f);
     drawList->ChannelsMerge();
 }
 
-ImVec2 Gui::getGateInputSlotPos(const CircuitGatePtr &gate, size_t slotIndex) {
-    const ImVec2 rectMin = state.scrolling + gate->pos;
-    const ImVec2 rectSize = gatesRenderInfo.at(gate->getId()).rectSize;
+void Gui::renderGateBlock(const CircuitGate &gate) {
+    const ImVec2 rectMin = toScreen(toImVec2(gate.pos));
+    const ImVec2 rectMax = toScreen(toImVec2(gate.pos) + gatesRenderInfo[gate.getId()].rectSize);
+    ImGui::GetWindowDrawList()->AddRectFilled(rectMin, rectMax, GATE_BORDER_COLOR);
+}
+
+void Gui::renderHeatmap() {
+    ImDrawList *drawList = ImGui::GetWindowDrawList();
+
+    // buckets are made of whole cells of the spatial index, at least HEATMAP_BUCKET_SIZE pixels wide
+    const auto cellsPerBucket = static_cast<int32_t>(
+            std::ceil(HEATMAP_BUCKET_SIZE / (SpatialGrid::CELL_SIZE * state.zoom)));
+    const float bucketSize = SpatialGrid::CELL_SIZE * static_cast<float>(cellsPerBucket);
+
+    const auto firstX = static_cast<int32_t>(std::floor(visibleMin.x / bucketSize));
+    const auto firstY = static_cast<int32_t>(std::floor(visibleMin.y / bucketSize));
+    const auto columns = static_cast<int32_t>(std::floor(visibleMax.x / bucketSize)) - firstX + 1;
+    const auto rows = static_cast<int32_t>(std::floor(visibleMax.y / bucketSize)) - firstY + 1;
+
+    heatmapCounts.assign(static_cast<size_t>(columns) * rows, 0);
+
+    // density of gates only, each counted once in every cell it overlaps
+    spatialIndex.forEachOccupiedCell(visibleMin, visibleMax, [&](int32_t x, int32_t y, const auto &ids) {
+        const auto column = static_cast<int32_t>(std::floor(float(x) / float(cellsPerBucket))) - firstX;
+        const auto row = static_cast<int32_t>(std::floor(float(y) / float(cellsPerBucket))) - firstY;
+        if (column >= 0 && column < columns && row >= 0 && row < rows) {
+            heatmapCounts[row * columns + column] += static_cast<uint32_t>(ids.size());
+        }
+    });
+
+    const uint32_t maxCount = *std::max_element(heatmapCounts.begin(), heatmapCounts.end());
+
+    for (int32_t row = 0; row < rows; row++) {
+        for (int32_t column = 0; column < columns; column++) {
+            const uint32_t count = heatmapCounts[row * columns + column];
+            if (count == 0) continue;
+
+            const ImVec2 bucketMin = ImVec2(float(firstX + column), float(firstY + row)) * bucketSize;
+            const float heat = std::sqrt(float(count) / float(maxCount));
+            drawList->AddRectFilled(toScreen(bucketMin), toScreen(bucketMin + ImVec2(bucketSize, bucketSize)),
+                                    lerpColor(HEATMAP_COLD_COLOR, HEATMAP_HOT_COLOR, heat));
+        }
+    }
+}
+
+void Gui::handleZoom() {
+    const ImGuiIO &io = ImGui::GetIO();
+    if (!ImGui::IsWindowHovered() || io.MouseWheel == 0.0f)
+        return;
+
+    const float zoom = std::clamp(state.zoom * std::pow(ZOOM_STEP, io.MouseWheel), MIN_ZOOM, MAX_ZOOM);
+
+    // keep the point under the cursor in place
+    const ImVec2 mouseCanvasPos = (io.MousePos - state.scrolling) / state.zoom;
+    state.scrolling = io.MousePos - mouseCanvasPos * zoom;
+    state.zoom = zoom;
+}
+
+Gui::DetailLevel Gui::getDetailLevel() const {
+    if (state.zoom >= FULL_DETAIL_MIN_ZOOM)
+        return FULL_DETAIL;
+    if (state.zoom >= BLOCKS_MIN_ZOOM)
+        return BLOCKS;
+    return HEATMAP;
+}
 
-    const size_t n = gate->getInputsCount();
+ImVec2 Gui::toScreen(const ImVec2 canvasPos) const {
+    return state.scrolling + canvasPos * state.zoom;
+}
+
+void Gui::syncSpatialIndex(const Circuit &circuit) {
+    if (indexedCircuit != &circuit) {
+        indexedCircuit = &circuit;
+        gatesRenderInfo.clear();
+        spatialIndex.clear();
+        linkIndex.clear();
+        linkOwners.clear();
+    }
+
+    const size_t firstNewGate = gatesRenderInfo.size();
+    gatesRenderInfo.resize(circuit.getGatesCount());
+
+    for (size_t id = firstNewGate; id < circuit.getGatesCount(); id++) {
+        const CircuitGate &gate = circuit[id];
+        gatesRenderInfo[id].firstLink = static_cast<SpatialGrid::ItemID>(linkOwners.size());
+        linkOwners.insert(linkOwners.end(), gate.getInputsCount(), gate.getId());
+        reindexGate(circuit, gate);
+    }
+}
+
+void Gui::reindexGate(const Circuit &circuit, const CircuitGate &gate) {
+    const GateRenderInfo &info = gatesRenderInfo[gate.getId()];
+    spatialIndex.update(gate.getId(), toImVec2(gate.pos), toImVec2(gate.pos) + info.rectSize);
+
+    const std::span<const CircuitGate::InputPin> inputs = gate.getInputs();
+    for (size_t i = 0; i < inputs.size(); i++) {
+        const SpatialGrid::ItemID link = info.firstLink + static_cast<SpatialGrid::ItemID>(i);
+        if (inputs[i].destGate == CircuitGate::NO_GATE) {
+            linkIndex.remove(link);
+            continue;
+        }
+
+        // a link bends at most LINK_MAX_BEZIER_OFFSET to the left of its input end
+        const CircuitGate &source = circuit[inputs[i].destGate];
+        const ImVec2 p = toImVec2(gate.pos) + getInputSlotOffset(gate, i);
+        const ImVec2 q = toImVec2(source.pos) + getOutputSlotOffset(source, inputs[i].destSlotIndex);
+        const ImVec2 min(std::min(p.x - LINK_MAX_BEZIER_OFFSET, q.x), std::min(p.y, q.y));
+        const ImVec2 max(std::max(p.x, q.x + LINK_MAX_BEZIER_OFFSET), std::max(p.y, q.y));
+
+        const ImVec2 margin(LINK_WIDTH, LINK_WIDTH);
+        linkIndex.update(link, min - margin, max + margin);
+    }
+}
+
+void Gui::reindexGateWithFanouts(const Circuit &circuit, const CircuitGate &gate) {
+    reindexGate(circuit, gate);
+    gate.forEachFanout([&](const CircuitGate &consumer) { reindexGate(circuit, consumer); });
+}
+
+ImVec2 Gui::getInputSlotOffset(const CircuitGate &gate, size_t slotIndex) const {
+    const ImVec2 rectSize = gatesRenderInfo[gate.getId()].rectSize;
+
+    const size_t n = gate.getInputsCount();
     const float yOffsetBase = rectSize.y / 2 - (n - 1) * SLOT_GAP / 2 - n * SLOT_RADIUS;
     const float yOffset = yOffsetBase + 2 * slotIndex * SLOT_RADIUS + slotIndex * SLOT_GAP;
-    return rectMin + ImVec2(0, yOffset);
+    return ImVec2(0, yOffset);
 }
 
-ImVec2 Gui::getGateOutputSlotPos(const CircuitGatePtr &gate, size_t slotIndex) {
-    const ImVec2 rectMin = state.scrolling + gate->pos;
-    const ImVec2 rectSize = gatesRenderInfo.at(gate->getId()).rectSize;
+ImVec2 Gui::getOutputSlotOffset(const CircuitGate &gate, size_t slotIndex) const {
+    const ImVec2 rectSize = gatesRenderInfo[gate.getId()].rectSize;
 
-    const size_t n = gate->getOutputsCount();
+    const size_t n = gate.getOutputsCount();
     const float yOffsetBase = rectSize.y / 2 - (n - 1) * SLOT_GAP / 2 - n * SLOT_RADIUS;
     const float yOffset = yOffsetBase + 2 * slotIndex * SLOT_RADIUS + slotIndex * SLOT_GAP;
-    return rectMin + ImVec2(rectSize.x, yOffset);
+    return ImVec2(rectSize.x, yOffset);
+}
+
+ImVec2 Gui::getGateInputSlotPos(const CircuitGate &gate, size_t slotIndex) {
+    return toScreen(toImVec2(gate.pos) + getInputSlotOffset(gate, slotIndex));
 }
 
-ImVec2 Gui::calcGateRectSize(const CircuitGatePtr &gate) {
-    const bool isLeftGap = gate->getInputsCount() != 0;
-    const bool isRightGap = gate->getOutputsCount() != 0;
+ImVec2 Gui::getGateOutputSlotPos(const CircuitGate &gate, size_t slotIndex) {
+    return toScreen(toImVec2(gate.pos) + getOutputSlotOffset(gate, slotIndex));
+}
+
+ImVec2 Gui::calcGateRectSize(const Circuit &circuit, const CircuitGate &gate) {
+    const bool isLeftGap = gate.getInputsCount() != 0;
+    const bool isRightGap = gate.getOutputsCount() != 0;
 
-    ImVec2 rectSize = ImGui::GetItemRectSize();
+    ImVec2 rectSize = ImGui::GetItemRectSize() / state.zoom;
     if (isLeftGap)
         rectSize.x += SLOT_GAP;
     if (isRightGap)
         rectSize.x += SLOT_GAP;
-    const size_t biggerSlotCount = std::max(gate->getInputsCount(), gate->getOutputsCount());
+    const size_t biggerSlotCount = std::max(gate.getInputsCount(), gate.getOutputsCount());
     rectSize.y = std::max(
             rectSize.y,
             biggerSlotCount * SLOT_RADIUS * 2 + (biggerSlotCount + 1) * SLOT_GAP
     );
     rectSize = rectSize + GATE_WINDOW_PADDING + GATE_WINDOW_PADDING;
 
-    gatesRenderInfo.emplace(gate->getId(), rectSize);
+    // text doesn't scale exactly with the zoom, so differences under a pixel are ignored
+    ImVec2 &knownSize = gatesRenderInfo[gate.getId()].rectSize;
+    if (std::abs(knownSize.x - rectSize.x) * state.zoom > 1.0f || std::abs(knownSize.y - rectSize.y) * state.zoom > 1.0f) {
+        knownSize = rectSize;
+        reindexGateWithFanouts(circuit, gate);
+    }
+
     return rectSize;
 }
 
-void Gui::handleSlotDragDrop(CircuitGatePtr &gate, size_t slotIndex, SlotType slotType) {
+void Gui::handleSlotDragDrop(Circuit &circuit, CircuitGate &gate, size_t slotIndex, SlotType slotType) {
     if (ImGui::BeginDragDropSource(ImGuiDragDropFlags_SourceNoPreviewTooltip)) {
-        CachedLink cachedLink = {gate, slotIndex, slotType};
+        CachedLink cachedLink = {gate.getId(), slotIndex, slotType};
         ImGui::SetDragDropPayload("CIRCUIT_LINK", &cachedLink, sizeof(cachedLink), ImGuiCond_Once);
         ImGui::EndDragDropSource();
 
@@ -243,6 +571,7 @@ void Gui::handleSlotDragDrop(CircuitGatePtr &gate, size_t slotIndex, SlotType sl
         }
 
         const CachedLink *cachedLink = (CachedLink *) payload->Data;
+        CircuitGate &linkedGate = circuit[cachedLink->destGate];
 
         if (cachedLink->cachedType == slotType) {
             ImGui::EndDragDropTarget();
@@ -250,119 +579,204 @@ void Gui::handleSlotDragDrop(CircuitGatePtr &gate, size_t slotIndex, SlotType sl
         }
 
         const CircuitGate::PinType type1 = slotType == INPUT
-                                           ? gate->getInput(slotIndex).type
-                                           : gate->getOutput(slotIndex).type;
+                                           ? gate.getInput(slotIndex).type
+                                           : gate.getOutputType(slotIndex);
 
         const CircuitGate::PinType type2 = cachedLink->cachedType == INPUT
-                                           ? cachedLink->destGate->getInput(cachedLink->destSlotIndex).type
-                                           : cachedLink->destGate->getOutput(cachedLink->destSlotIndex).type;
+                                           ? linkedGate.getInput(cachedLink->destSlotIndex).type
+                                           : linkedGate.getOutputType(cachedLink->destSlotIndex);
 
+        // links made elsewhere are checked by validation, this one never gets made
         if (type1 != type2) {
-            std::cout << "TypeError\n"; // todo nicer error
+            rejectedLinkTime = ImGui::GetTime();
             ImGui::EndDragDropTarget();
             return;
         }
 
         if (slotType == INPUT) {
-            gate->updateInput(cachedLink->destGate, cachedLink->destSlotIndex, slotIndex);
+            gate.updateInput(cachedLink->destGate, cachedLink->destSlotIndex, slotIndex);
+            reindexGate(circuit, gate);
         } else {
-            cachedLink->destGate->updateInput(gate, slotIndex, cachedLink->destSlotIndex);
+            linkedGate.updateInput(gate.getId(), slotIndex, cachedLink->destSlotIndex);
+            reindexGate(circuit, linkedGate);
         }
+        onCircuitEdited();
 
         ImGui::EndDragDropTarget();
     }
 }
 
-static void onClickEvalButton(CircuitGatePtr &gate) {
-    CircuitVisitor_Eval visitor;
-    gate->acceptVisitor(visitor);
-    if (visitor.didEvalCorrectly()) {
-        std::cout << "\n";
-        gate->print();
+void Gui::startEvaluation(const Circuit &circuit, CircuitGate &gate) {
+    // what keeps the gate from being evaluated is listed by `renderDiagnostics()`
+    if (!circuit.validate().isEvaluable(gate.getId())) {
+        return;
+    }
+
+    // values cached by previous evaluations stay valid until an edit invalidates them, so this
+    // only recomputes what changed since then; compiling is left to the worker, as it takes much
+    // longer than taking the snapshot or running the result
+    CompiledCircuit::Snapshot snapshot(circuit, {gate.getId()}, true);
+    evaluatedGate = gate.getId();
+    evaluator.submit(std::move(snapshot), [this] { requestRedraw(); });
+}
+
+void Gui::collectEvaluationResults(const Circuit &circuit) {
+    std::optional<CompiledCircuit> compiled = evaluator.takeResult();
+    // the snapshot no longer matches the gates if they were connected differently in the meantime
+    if (!compiled || compiled->getRevision() != circuit.getRevision())
+        return;
+
+    compiled->storeResults();
+    std::cout << "\n";
+    circuit[evaluatedGate].print();
+}
+
+void Gui::onCircuitEdited() {
+    evaluator.cancel();
+}
+
+void Gui::renderEvaluationStatus() {
+    if (!evaluator.isRunning())
+        return;
+
+    ImGui::SameLine();
+    ImGui::ProgressBar(evaluator.getProgress(), ImVec2(200, 0));
+    ImGui::SameLine();
+    if (ImGui::Button("cancel")) {
+        evaluator.cancel();
     }
-    gate->clearCaches();
 }
 
-void Gui::renderGate(CircuitGatePtr &gate) {
+void Gui::renderDiagnostics(const Circuit &circuit) {
+    if (ImGui::GetTime() - rejectedLinkTime < REJECTED_LINK_MESSAGE_TIME) {
+        ImGui::SameLine();
+        ImGui::TextColored(ERROR_TEXT_COLOR, "pin types differ");
+        pendingFrames = std::max(pendingFrames, 1);
+    }
+
+    const CircuitValidation &validation = circuit.validate();
+    if (validation.isValid())
+        return;
+
+    ImGui::SameLine();
+    ImGui::TextColored(ERROR_TEXT_COLOR, "%zu problem(s)", validation.getDiagnostics().size());
+    if (ImGui::IsItemHovered()) {
+        ImGui::BeginTooltip();
+        for (const CircuitValidation::Diagnostic &diagnostic : validation.getDiagnostics()) {
+            ImGui::TextUnformatted(CircuitValidation::describe(circuit, diagnostic).c_str());
+        }
+        ImGui::EndTooltip();
+    }
+}
+
+void Gui::renderGate(Circuit &circuit, CircuitGate &gate) {
     ImDrawList *drawList = ImGui::GetWindowDrawList();
     const ImGuiIO &io = ImGui::GetIO();
 
-    ImGui::PushID(gate->getId());
+    ImGui::PushID(gate.getId());
 
-    const ImVec2 rectMin = state.scrolling + gate->pos;
-    const bool isLeftGap = gate->getInputsCount() != 0;
+    const ImVec2 rectMin = toScreen(toImVec2(gate.pos));
+    const bool isLeftGap = gate.getInputsCount() != 0;
 
     // display gate contents first
     drawList->ChannelsSetCurrent(1); // foreground
-    ImGui::SetCursorScreenPos(rectMin + GATE_WINDOW_PADDING + (isLeftGap ? ImVec2(SLOT_GAP, 0) : ImVec2()));
+    ImGui::SetCursorScreenPos(toScreen(toImVec2(gate.pos) + GATE_WINDOW_PADDING + (isLeftGap ? ImVec2(SLOT_GAP, 0) : ImVec2())));
     ImGui::BeginGroup();
-    ImGui::Text("%s [ID %d]", gate->getName().c_str(), gate->getId());
+    ImGui::Text("%s [ID %u]", gate.getName().c_str(), gate.getId());
 
     CircuitVisitor_RenderContent renderVisitor;
-    gate->acceptVisitor(renderVisitor);
+    gate.acceptVisitor(renderVisitor);
+    if (renderVisitor.edited) {
+        onCircuitEdited();
+    }
 
-    ImGui::Button("eval", {50, 20});
+    ImGui::Button("eval", ImVec2(50, 20) * state.zoom);
     if (ImGui::IsItemActive() && ImGui::IsMouseClicked(ImGuiMouseButton_Left)) {
-        onClickEvalButton(gate);
+        startEvaluation(circuit, gate);
     }
     ImGui::EndGroup();
 
-    const ImVec2 rectSize = calcGateRectSize(gate);
-    const ImVec2 rectMax = rectMin + rectSize;
+    const ImVec2 rectSize = calcGateRectSize(circuit, gate);
+    const ImVec2 rectMax = toScreen(toImVec2(gate.pos) + rectSize);
+    const float slotRadius = SLOT_RADIUS * state.zoom;
 
     // Display link slots
-    for (size_t slotIndex = 0; slotIndex < gate->getInputsCount(); slotIndex++) {
+    for (size_t slotIndex = 0; slotIndex < gate.getInputsCount(); slotIndex++) {
         const ImVec2 circleCenter = getGateInputSlotPos(gate, slotIndex);
 
-        ImGui::SetCursorScreenPos(circleCenter - ImVec2(SLOT_RADIUS, SLOT_RADIUS));
-        const std::string buttonId = std::to_string(gate->getId()) + std::string("i") + std::to_string(slotIndex);
-        ImGui::InvisibleButton(buttonId.c_str(), ImVec2(2 * SLOT_RADIUS, 2 * SLOT_RADIUS));
-        handleSlotDragDrop(gate, slotIndex, INPUT);
+        ImGui::SetCursorScreenPos(circleCenter - ImVec2(slotRadius, slotRadius));
+        ImGui::PushID(static_cast<int>(slotIndex));
+        ImGui::InvisibleButton("input", ImVec2(2 * slotRadius, 2 * slotRadius));
+        handleSlotDragDrop(circuit, gate, slotIndex, INPUT);
+        ImGui::PopID();
 
-        ImU32 slotColor = getPinTypeColor(gate->getInput(slotIndex).type);
-        drawList->AddCircleFilled(circleCenter, SLOT_RADIUS, slotColor);
+        ImU32 slotColor = getPinTypeColor(gate.getInput(slotIndex).type);
+        drawList->AddCircleFilled(circleCenter, slotRadius, slotColor);
     }
 
-    for (size_t slotIndex = 0; slotIndex < gate->getOutputsCount(); slotIndex++) {
+    for (size_t slotIndex = 0; slotIndex < gate.getOutputsCount(); slotIndex++) {
         const ImVec2 circleCenter = getGateOutputSlotPos(gate, slotIndex);
 
-        ImGui::SetCursorScreenPos(circleCenter - ImVec2(SLOT_RADIUS, SLOT_RADIUS));
-        const std::string buttonId = std::to_string(gate->getId()) + std::string("o") + std::to_string(slotIndex);
-        ImGui::InvisibleButton(buttonId.c_str(), ImVec2(2 * SLOT_RADIUS, 2 * SLOT_RADIUS));
-        handleSlotDragDrop(gate, slotIndex, OUTPUT);
-
-        ImU32 slotColor = getPinTypeColor(gate->getOutput(slotIndex).type);
-        drawList->AddCircleFilled(circleCenter, SLOT_RADIUS, slotColor);
+        ImGui::SetCursorScreenPos(circleCenter - ImVec2(slotRadius, slotRadius));
+        ImGui::PushID(static_cast<int>(slotIndex));
+        ImGui::InvisibleButton("output", ImVec2(2 * slotRadius, 2 * slotRadius));
+        handleSlotDragDrop(circuit, gate, slotIndex, OUTPUT);
+        ImGui::PopID();
+
+        const CircuitGate::OutputPin output = gate.getOutput(slotIndex);
+        ImU32 slotColor = getPinTypeColor(output.type);
+        drawList->AddCircleFilled(circleCenter, slotRadius, slotColor);
+
+        // the last evaluated value, right of the slot
+        if (output.isEval) {
+            const std::string text = output.type == CircuitGate::Bool ? (output.value ? "true" : "false")
+                                                                      : std::to_string(output.value);
+            drawList->AddText(circleCenter + ImVec2(2 * slotRadius, -ImGui::GetFontSize() / 2), VALUE_COLOR, text.c_str());
+        }
     }
 
     // display box
     drawList->ChannelsSetCurrent(0); // background
     ImGui::SetCursorScreenPos(rectMin);
-    ImGui::InvisibleButton("gate", rectSize);
+    ImGui::InvisibleButton("gate", rectMax - rectMin);
 
     if (ImGui::IsItemActive() && ImGui::IsMouseDragging(ImGuiMouseButton_Left)) {
-        gate->pos = gate->pos + io.MouseDelta;
+        const ImVec2 pos = toImVec2(gate.pos) + io.MouseDelta / state.zoom;
+        gate.pos = {pos.x, pos.y};
+        reindexGateWithFanouts(circuit, gate);
     }
 
     ImU32 bgColor = (ImGui::IsItemHovered() || ImGui::IsItemActive()) ? GATE_COLOR_HOVER : GATE_COLOR;
     drawList->AddRectFilled(rectMin, rectMax, bgColor, GATE_CORNER_ROUNDING);
-    drawList->AddRect(rectMin, rectMax, GATE_BORDER_COLOR, GATE_CORNER_ROUNDING);
+    const bool isFaulty = circuit.validate().isFaulty(gate.getId());
+    drawList->AddRect(rectMin, rectMax, isFaulty ? GATE_FAULTY_BORDER_COLOR : GATE_BORDER_COLOR, GATE_CORNER_ROUNDING);
 
     ImGui::PopID();
 }
 
-void Gui::renderGatesLinks(std::vector<CircuitGatePtr> &gates) {
-    for (auto &gate: gates) {
-        const std::vector<CircuitGate::InputPin> &inputs = gate->getInputs();
+void Gui::renderGatesLinks(const Circuit &circuit) {
+    if (getDetailLevel() == BLOCKS) {
+        renderLinkBundles(circuit);
+        return;
+    }
 
-        for (size_t i = 0; i < inputs.size(); i++) {
-            if (!inputs[i].destGate)
-                continue;
+    const ImVec2 visibleScreenMin = toScreen(visibleMin), visibleScreenMax = toScreen(visibleMax);
+    const float bezierOffset = LINK_MAX_BEZIER_OFFSET * state.zoom;
 
-            const ImVec2 mySlot = getGateInputSlotPos(gate, i);
-            const ImVec2 otherSlot = getGateOutputSlotPos(inputs[i].destGate, inputs[i].destSlotIndex);
-            renderLink(mySlot, otherSlot);
-        }
+    for (SpatialGrid::ItemID link: visibleLinks) {
+        const CircuitGate &gate = circuit[linkOwners[link]];
+        const size_t i = link - gatesRenderInfo[gate.getId()].firstLink;
+        const CircuitGate::InputPin &input = gate.getInput(i);
+
+        const ImVec2 mySlot = getGateInputSlotPos(gate, i);
+        const ImVec2 otherSlot = getGateOutputSlotPos(circuit[input.destGate], input.destSlotIndex);
+
+        const ImVec2 linkMin(std::min(mySlot.x - bezierOffset, otherSlot.x), std::min(mySlot.y, otherSlot.y));
+        const ImVec2 linkMax(std::max(mySlot.x, otherSlot.x + bezierOffset), std::max(mySlot.y, otherSlot.y));
+        if (!rectsOverlap(linkMin, linkMax, visibleScreenMin, visibleScreenMax))
+            continue;
+
+        renderLink(mySlot, otherSlot);
     }
 }
 
@@ -370,7 +784,32 @@ void Gui::renderLink(const ImVec2 p1, const ImVec2 p2) const {
     ImDrawList *drawList = ImGui::GetWindowDrawList();
 
     const float xDist = std::abs(p1.x - p2.x);
-    const float bezierOffset = std::min(xDist / 2, 50.0f);
+    const float bezierOffset = std::min(xDist / 2, LINK_MAX_BEZIER_OFFSET * state.zoom);
     drawList->AddBezierCubic(p1, p1 - ImVec2(bezierOffset, 0), p2 + ImVec2(bezierOffset, 0), p2,
-                             LINK_COLOR, LINK_WIDTH);
+                             LINK_COLOR, std::max(1.0f, LINK_WIDTH * state.zoom));
+}
+
+void Gui::renderLinkBundles(const Circuit &circuit) {
+    ImDrawList *drawList = ImGui::GetWindowDrawList();
+    std::unordered_set<uint64_t> drawnBundles;
+
+    auto toBundleCell = [](ImVec2 p) {
+        const auto x = static_cast<uint32_t>(static_cast<int32_t>(std::floor(p.x / LINK_BUNDLE_CELL_SIZE)));
+        const auto y = static_cast<uint32_t>(static_cast<int32_t>(std::floor(p.y / LINK_BUNDLE_CELL_SIZE)));
+        return (x & 0xFFFF) | (y & 0xFFFF) << 16;
+    };
+
+    for (SpatialGrid::ItemID link: visibleLinks) {
+        const CircuitGate &gate = circuit[linkOwners[link]];
+        const size_t i = link - gatesRenderInfo[gate.getId()].firstLink;
+        const CircuitGate::InputPin &input = gate.getInput(i);
+
+        const ImVec2 mySlot = getGateInputSlotPos(gate, i);
+        const ImVec2 otherSlot = getGateOutputSlotPos(circuit[input.destGate], input.destSlotIndex);
+
+        const uint64_t bundle = uint64_t(toBundleCell(mySlot)) << 32 | toBundleCell(otherSlot);
+        if (drawnBundles.insert(bundle).second) {
+            drawList->AddLine(otherSlot, mySlot, LINK_COLOR);
+        }
+    }
 }
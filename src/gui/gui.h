@@ -4,31 +4,80 @@
 #include "../../deps/imgui/imgui.h"
 #include "../../deps/imgui/backends/imgui_impl_glfw.h"
 #include "../../deps/imgui/backends/imgui_impl_opengl3.h"
-#include "../circuit/gate.h"
+#include "../circuit/circuit.h"
+#include "../circuit/compiler/async-evaluator.h"
+#include "spatial-grid.h"
+#include <atomic>
 #include <vector>
 #include <optional>
-#include <map>
 
 class Gui {
     struct State {
         bool showGrid = true;
         ImVec2 scrolling;
+        float zoom = 1.0f;
     };
 
     State state;
 
     GLFWwindow* window;
 
+    // frames left to draw before the editor goes idle again; after an input ImGui needs
+    // a couple of frames for hover states and gate sizes to settle
+    int pendingFrames = 0;
+    bool isAnimating = false;
+    std::atomic<bool> redrawRequested = false;
+
+    struct GridCache {
+        ImVec2 origin, size, offset;
+        float spacing = 0;
+        std::vector<std::pair<ImVec2, ImVec2>> lines;
+    };
+
+    GridCache gridCache;
+
+    // evaluations run in the background, on a snapshot compiled when the eval button is clicked
+    AsyncEvaluator evaluator;
+    CircuitGate::GateID evaluatedGate = CircuitGate::NO_GATE;
+
+    // when a link between pins of different types was last dropped, and refused
+    double rejectedLinkTime = -1e9;
+
     struct GateRenderInfo {
-        ImVec2 rectSize;
+        // a guess until the gate is laid out for the first time
+        ImVec2 rectSize = {160, 80};
+        // ID in `linkIndex` of the link into the first input, the other inputs following it
+        SpatialGrid::ItemID firstLink = 0;
     };
 
-    std::map<CircuitGate::GateID, GateRenderInfo> gatesRenderInfo;
+    // indexed by GateID
+    std::vector<GateRenderInfo> gatesRenderInfo;
+
+    // gates and links are indexed apart, each by its own rectangle, so that a query over the visible
+    // part of the canvas finds what has to be drawn and a long link costs no more than a short one
+    SpatialGrid spatialIndex;
+    SpatialGrid linkIndex;
+    const Circuit *indexedCircuit = nullptr;
+    // the gate every link leads into, by link ID
+    std::vector<CircuitGate::GateID> linkOwners;
+    std::vector<CircuitGate::GateID> visibleGates;
+    std::vector<SpatialGrid::ItemID> visibleLinks;
+    ImVec2 visibleMin, visibleMax;
+
+    /**
+     * How much of a gate is drawn at the current zoom. Fully detailed gates are made of ImGui
+     * widgets; further out gates become plain boxes, and finally only their density is shown,
+     * so that the amount of drawing stays bounded however much of the circuit is in view.
+     */
+    enum DetailLevel { FULL_DETAIL, BLOCKS, HEATMAP };
+
+    // reused between frames
+    std::vector<uint32_t> heatmapCounts;
 
     enum SlotType { INPUT, OUTPUT };
 
     struct CachedLink {
-        CircuitGatePtr destGate;
+        CircuitGate::GateID destGate;
         size_t destSlotIndex;
         SlotType cachedType;
     };
@@ -39,32 +88,126 @@ class Gui {
     constexpr static ImVec2 GATE_WINDOW_PADDING = {8.0f, 8.0f};
     constexpr static float GATE_CORNER_ROUNDING = 4.0f;
     constexpr static float LINK_WIDTH = 3.0f;
+    constexpr static float LINK_MAX_BEZIER_OFFSET = 50.0f;
+
+    /* zoom constants */
+    constexpr static float MIN_ZOOM = 0.01f;
+    constexpr static float MAX_ZOOM = 2.0f;
+    constexpr static float ZOOM_STEP = 1.1f;
+    constexpr static float FULL_DETAIL_MIN_ZOOM = 0.5f;
+    constexpr static float BLOCKS_MIN_ZOOM = 0.1f;
+    // in pixels
+    constexpr static float HEATMAP_BUCKET_SIZE = 16.0f;
+    constexpr static float LINK_BUNDLE_CELL_SIZE = 8.0f;
+
+    /* idle constants */
+    constexpr static int SETTLE_FRAMES = 3;
+    // in seconds, also the blink period of the text cursor
+    constexpr static double IDLE_WAIT_TIMEOUT = 0.5;
+    // in seconds
+    constexpr static double REJECTED_LINK_MESSAGE_TIME = 2.0;
 
 public:
     GLFWwindow* init();
 
-    void render(std::vector<CircuitGatePtr>& gates);
+    /**
+     * Waits for input, then draws a frame. Returns without drawing anything if nothing happened,
+     * so an idle editor costs next to no CPU.
+     */
+    void render(Circuit& circuit);
+
+    /**
+     * Makes the next `render()` draw a frame, e.g. because the results of a simulation changed.
+     * Can be called from any thread.
+     */
+    void requestRedraw();
 
     void shutdown();
 
 private:
+    static void onInputEvent(GLFWwindow* window);
+
+    /**
+     * Blocks until there is a reason to draw, or until IDLE_WAIT_TIMEOUT passes.
+     * Returns whether a frame should be drawn.
+     */
+    bool waitForFrame();
+
     void renderGrid();
 
-    void renderGates(std::vector<CircuitGatePtr>& gates);
+    void renderEvaluationStatus();
+
+    /**
+     * Lists the problems validation found in the circuit, in a tooltip of their count.
+     */
+    void renderDiagnostics(const Circuit& circuit);
+
+    void startEvaluation(const Circuit& circuit, CircuitGate& gate);
+
+    /**
+     * Stores the results of a finished evaluation into the gates.
+     */
+    void collectEvaluationResults(const Circuit& circuit);
+
+    /**
+     * Called after every edit which may change the results, as it makes the running evaluation stale.
+     */
+    void onCircuitEdited();
+
+    void renderGates(Circuit& circuit);
+
+    void renderGate(Circuit& circuit, CircuitGate& gate);
+
+    void renderGateBlock(const CircuitGate& gate);
+
+    void renderGatesLinks(const Circuit& circuit);
+
+    /**
+     * Draws links as straight lines, merging the ones whose ends are within a few pixels
+     * of each other into one.
+     */
+    void renderLinkBundles(const Circuit& circuit);
+
+    void renderHeatmap();
+
+    void handleZoom();
+
+    [[nodiscard]]
+    DetailLevel getDetailLevel() const;
+
+    [[nodiscard]]
+    ImVec2 toScreen(ImVec2 canvasPos) const;
+
+    /**
+     * Indexes gates created since the last frame, or the whole circuit if it is not the one
+     * indexed before. Edits made through the editor keep the index up to date by themselves.
+     */
+    void syncSpatialIndex(const Circuit& circuit);
+
+    /**
+     * Reindexes the gate and the links into its inputs.
+     */
+    void reindexGate(const Circuit& circuit, const CircuitGate& gate);
+
+    /**
+     * Reindexes the gate and all gates reading from it, whose incoming links end at the gate.
+     */
+    void reindexGateWithFanouts(const Circuit& circuit, const CircuitGate& gate);
 
-    void renderGate(CircuitGatePtr& gate);
+    ImVec2 getGateInputSlotPos(const CircuitGate &gate, size_t slotIndex);
 
-    void renderGatesLinks(std::vector<CircuitGatePtr>& gates);
+    ImVec2 calcGateRectSize(const Circuit &circuit, const CircuitGate &gate);
 
-    ImVec2 getGateInputSlotPos(const CircuitGatePtr &gate, size_t slotIndex);
+    ImVec2 getGateOutputSlotPos(const CircuitGate &gate, size_t slotIndex);
 
-    ImVec2 calcGateRectSize(const CircuitGatePtr &gate);
+    // slot positions relative to the gate's position
+    ImVec2 getInputSlotOffset(const CircuitGate &gate, size_t slotIndex) const;
 
-    ImVec2 getGateOutputSlotPos(const CircuitGatePtr &gate, size_t slotIndex);
+    ImVec2 getOutputSlotOffset(const CircuitGate &gate, size_t slotIndex) const;
 
     void renderLink(ImVec2 p1, ImVec2 p2) const;
 
-    void handleSlotDragDrop(CircuitGatePtr &gate, size_t slotIndex, SlotType slotType);
+    void handleSlotDragDrop(Circuit& circuit, CircuitGate &gate, size_t slotIndex, SlotType slotType);
 };
 
 #endif //CIRCUIT_GUI_H
@@ -0,0 +1,103 @@
+#include "spatial-grid.h"
+
+#include <algorithm>
+#include <cmath>
+
+SpatialGrid::CellRange SpatialGrid::getCellRange(ImVec2 min, ImVec2 max) {
+    return {
+        static_cast<int32_t>(std::floor(min.x / CELL_SIZE)),
+        static_cast<int32_t>(std::floor(min.y / CELL_SIZE)),
+        static_cast<int32_t>(std::floor(max.x / CELL_SIZE)),
+        static_cast<int32_t>(std::floor(max.y / CELL_SIZE)),
+    };
+}
+
+void SpatialGrid::update(ItemID id, ImVec2 min, ImVec2 max) {
+    if (id >= ranges.size()) {
+        ranges.resize(id + 1);
+        indexed.resize(id + 1, false);
+        largePositions.resize(id + 1, NOT_LARGE);
+        queryStamps.resize(id + 1, 0);
+    }
+
+    const CellRange range = getCellRange(min, max);
+    if (indexed[id] && ranges[id] == range) return;
+
+    remove(id);
+
+    if (range.getCellsCount() > MAX_ITEM_CELLS) {
+        largePositions[id] = static_cast<uint32_t>(largeItems.size());
+        largeItems.push_back(id);
+    } else {
+        for (int32_t x = range.minX; x <= range.maxX; x++) {
+            for (int32_t y = range.minY; y <= range.maxY; y++) {
+                cells[getCellKey(x, y)].push_back(id);
+            }
+        }
+    }
+
+    ranges[id] = range;
+    indexed[id] = true;
+}
+
+void SpatialGrid::remove(ItemID id) {
+    if (id >= ranges.size() || !indexed[id]) return;
+
+    if (largePositions[id] != NOT_LARGE) {
+        largePositions[largeItems.back()] = largePositions[id];
+        largeItems[largePositions[id]] = largeItems.back();
+        largeItems.pop_back();
+        largePositions[id] = NOT_LARGE;
+    } else {
+        const CellRange &range = ranges[id];
+
+        for (int32_t x = range.minX; x <= range.maxX; x++) {
+            for (int32_t y = range.minY; y <= range.maxY; y++) {
+                const auto cell = cells.find(getCellKey(x, y));
+                std::vector<ItemID> &ids = cell->second;
+                *std::find(ids.begin(), ids.end(), id) = ids.back();
+                ids.pop_back();
+
+                if (ids.empty()) {
+                    cells.erase(cell);
+                }
+            }
+        }
+    }
+
+    indexed[id] = false;
+}
+
+void SpatialGrid::clear() {
+    cells.clear();
+    largeItems.clear();
+    ranges.clear();
+    indexed.clear();
+    largePositions.clear();
+    queryStamps.clear();
+}
+
+void SpatialGrid::query(ImVec2 min, ImVec2 max, std::vector<ItemID>& result) {
+    result.clear();
+
+    const uint32_t stamp = ++lastQueryStamp;
+
+    forEachOccupiedCell(min, max, [&](int32_t, int32_t, const std::vector<ItemID> &ids) {
+        for (ItemID id : ids) {
+            if (queryStamps[id] != stamp) {
+                queryStamps[id] = stamp;
+                result.push_back(id);
+            }
+        }
+    });
+
+    const CellRange range = getCellRange(min, max);
+    for (ItemID id : largeItems) {
+        if (ranges[id].overlaps(range)) {
+            result.push_back(id);
+        }
+    }
+
+    // keeps the drawing order independent of where items happen to sit in the grid
+    std::sort(result.begin(), result.end());
+}
@@ -0,0 +1,110 @@
+#ifndef CIRCUIT_SPATIAL_GRID_H
+#define CIRCUIT_SPATIAL_GRID_H
+
+#include "../../deps/imgui/imgui.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Uniform grid over canvas coordinates, bucketing items, gates or links, by the cells their bounding
+ * rectangles overlap, so that everything near a given rectangle can be found without looking at the
+ * rest. Items spanning more than MAX_ITEM_CELLS cells, like long links, are kept in a list of their
+ * own which every query tests, so that no item takes up more than a few cells however large it is.
+ */
+class SpatialGrid {
+public:
+    using ItemID = uint32_t;
+
+    constexpr static float CELL_SIZE = 256.0f;
+    constexpr static int64_t MAX_ITEM_CELLS = 16;
+
+private:
+    constexpr static uint32_t NOT_LARGE = UINT32_MAX;
+
+    struct CellRange {
+        int32_t minX, minY, maxX, maxY;
+
+        bool operator==(const CellRange&) const = default;
+
+        [[nodiscard]]
+        int64_t getCellsCount() const { return int64_t(maxX - minX + 1) * (maxY - minY + 1); }
+
+        [[nodiscard]]
+        bool overlaps(const CellRange& other) const {
+            return minX <= other.maxX && other.minX <= maxX && minY <= other.maxY && other.minY <= maxY;
+        }
+    };
+
+    std::unordered_map<uint64_t, std::vector<ItemID>> cells;
+    std::vector<ItemID> largeItems;
+
+    std::vector<CellRange> ranges;
+    std::vector<bool> indexed;
+    // position of every large item in `largeItems`, NOT_LARGE for the others
+    std::vector<uint32_t> largePositions;
+
+    // items already reported by the ongoing query; an item spanning several cells is found in each
+    std::vector<uint32_t> queryStamps;
+    uint32_t lastQueryStamp = 0;
+
+public:
+    /**
+     * Inserts the item, or moves it if it is already indexed.
+     */
+    void update(ItemID id, ImVec2 min, ImVec2 max);
+
+    /**
+     * Takes the item out of the index, if it is there at all.
+     */
+    void remove(ItemID id);
+
+    void clear();
+
+    /**
+     * Collects every item whose rectangle may overlap [min, max], sorted by ID.
+     */
+    void query(ImVec2 min, ImVec2 max, std::vector<ItemID>& result);
+
+    /**
+     * Calls `fn(x, y, ids)` for every occupied cell overlapping [min, max], where (x, y) are the
+     * cell's coordinates in units of CELL_SIZE and `ids` are the items overlapping the cell. Large
+     * items are not in any cell.
+     */
+    template<typename F>
+    void forEachOccupiedCell(ImVec2 min, ImVec2 max, F&& fn) const;
+
+private:
+    [[nodiscard]]
+    static CellRange getCellRange(ImVec2 min, ImVec2 max);
+
+    [[nodiscard]]
+    static uint64_t getCellKey(int32_t x, int32_t y) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+    }
+};
+
+template<typename F>
+void SpatialGrid::forEachOccupiedCell(ImVec2 min, ImVec2 max, F&& fn) const {
+    const CellRange range = getCellRange(min, max);
+    if (range.getCellsCount() > static_cast<int64_t>(cells.size())) {
+        // the rectangle spans more cells than are occupied, so walking the occupied ones is cheaper
+        for (const auto &[key, ids] : cells) {
+            const auto x = static_cast<int32_t>(key >> 32), y = static_cast<int32_t>(key & UINT32_MAX);
+            if (x >= range.minX && x <= range.maxX && y >= range.minY && y <= range.maxY) {
+                fn(x, y, ids);
+            }
+        }
+    } else {
+        for (int32_t x = range.minX; x <= range.maxX; x++) {
+            for (int32_t y = range.minY; y <= range.maxY; y++) {
+                const auto cell = cells.find(getCellKey(x, y));
+                if (cell != cells.end()) {
+                    fn(x, y, cell->second);
+                }
+            }
+        }
+    }
+}
+
+#endif //CIRCUIT_SPATIAL_GRID_H
@@ -1,7 +1,7 @@
 #include "gui/gui.h"
-#include "circuit/boolean/boolean-gate.h"
-#include "circuit/num/num-gate.h"
-#include "circuit/visitor.h"
+#include "circuit/circuit.h"
+#include "circuit/hierarchy/circuit-definition.h"
+#include <memory>
 
 #define GL_SILENCE_DEPRECATION
 #if defined(IMGUI_IMPL_OPENGL_ES2)
@@ -14,28 +14,57 @@
 #pragma comment(lib, "legacy_stdio_definitions")
 #endif
 
-CircuitGate::GateID CircuitGate::nextId;
-
 int main() {
     Gui gui;
     GLFWwindow* window = gui.init();
 
-    CircuitGatePtr g1 = std::make_shared<CircuitGate_Not>(CircuitGate_Not({40, 50}));
-    CircuitGatePtr g2 = std::make_shared<CircuitGate_Not>(CircuitGate_Not({40, 150}));
-    CircuitGatePtr g3 = std::make_shared<CircuitGate_And>(CircuitGate_And({270, 80}));
-    CircuitGatePtr g4 = std::make_shared<CircuitGate_ConstTrue>(CircuitGate_ConstTrue({160, 200}));
-    CircuitGatePtr g5 = std::make_shared<CircuitGate_ConstInt>(CircuitGate_ConstInt({160, 200}));
-    CircuitGatePtr g6 = std::make_shared<CircuitGate_ConstInt>(CircuitGate_ConstInt({160, 200}));
-    CircuitGatePtr g7 = std::make_shared<CircuitGate_ConstInt>(CircuitGate_ConstInt({160, 200}));
-    CircuitGatePtr g11 = std::make_shared<CircuitGate_ConstInt>(CircuitGate_ConstInt({160, 200}));
-    CircuitGatePtr g8 = std::make_shared<CircuitGate_Add>(CircuitGate_Add({160, 200}));
-    CircuitGatePtr g9 = std::make_shared<CircuitGate_Mul>(CircuitGate_Mul({160, 200}));
-    CircuitGatePtr g10 = std::make_shared<CircuitGate_CmpLe>(CircuitGate_CmpLe({160, 200}));
+    Circuit circuit;
+    circuit.add<CircuitGate_Not>({40, 50});
+    circuit.add<CircuitGate_Not>({40, 150});
+    circuit.add<CircuitGate_And>({270, 80});
+    circuit.add<CircuitGate_ConstTrue>({160, 200});
+    circuit.add<CircuitGate_ConstInt>({160, 200});
+    circuit.add<CircuitGate_ConstInt>({160, 200});
+    circuit.add<CircuitGate_ConstInt>({160, 200});
+    circuit.add<CircuitGate_ConstInt>({160, 200});
+    circuit.add<CircuitGate_Add>({160, 200});
+    circuit.add<CircuitGate_Mul>({160, 200});
+    circuit.add<CircuitGate_CmpLe>({160, 200});
+    circuit.add<CircuitGate_Register>({160, 200});
+    circuit.add<CircuitGate_IntRegister>({160, 200});
+
+    // a sub-circuit computing a xor b as not (not (a and not b) and not (not a and b))
+    Circuit xorContents;
+    const CircuitGate::GateID a = xorContents.add<CircuitGate_ConstBool>().getId();
+    const CircuitGate::GateID b = xorContents.add<CircuitGate_ConstBool>().getId();
+    const CircuitGate::GateID notA = xorContents.add<CircuitGate_Not>().getId();
+    const CircuitGate::GateID notB = xorContents.add<CircuitGate_Not>().getId();
+    const CircuitGate::GateID onlyA = xorContents.add<CircuitGate_And>().getId();
+    const CircuitGate::GateID onlyB = xorContents.add<CircuitGate_And>().getId();
+    const CircuitGate::GateID notOnlyA = xorContents.add<CircuitGate_Not>().getId();
+    const CircuitGate::GateID notOnlyB = xorContents.add<CircuitGate_Not>().getId();
+    const CircuitGate::GateID neither = xorContents.add<CircuitGate_And>().getId();
+    const CircuitGate::GateID result = xorContents.add<CircuitGate_Not>().getId();
+    xorContents.connect(a, 0, notA, 0);
+    xorContents.connect(b, 0, notB, 0);
+    xorContents.connect(a, 0, onlyA, 0);
+    xorContents.connect(notB, 0, onlyA, 1);
+    xorContents.connect(notA, 0, onlyB, 0);
+    xorContents.connect(b, 0, onlyB, 1);
+    xorContents.connect(onlyA, 0, notOnlyA, 0);
+    xorContents.connect(onlyB, 0, notOnlyB, 0);
+    xorContents.connect(notOnlyA, 0, neither, 0);
+    xorContents.connect(notOnlyB, 0, neither, 1);
+    xorContents.connect(neither, 0, result, 0);
 
-    std::vector<CircuitGatePtr> gates = { g1, g2, g3, g4, g5, g6, g7, g8, g9, g10, g11 };
+    const auto xorDefinition = std::make_shared<const CircuitDefinition>(
+            "Xor", std::move(xorContents),
+            std::vector<CircuitDefinition::Port>{{"a", a}, {"b", b}},
+            std::vector<CircuitDefinition::Port>{{"out", result}});
+    circuit.add<CircuitGate_SubCircuit>({400, 200}, xorDefinition);
 
     while (!glfwWindowShouldClose(window)) {
-        gui.render(gates);
+        gui.render(circuit);
     }
 
     gui.shutdown();
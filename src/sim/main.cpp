@@ -0,0 +1,740 @@
+#include "../circuit/io/binary-netlist.h"
+#include "../circuit/io/netlist.h"
+#include "../circuit/io/stimulus.h"
+#include "../circuit/io/trace.h"
+#include "../circuit/compiler/batch-evaluator.h"
+#include "../circuit/compiler/compiled-circuit.h"
+#include "../circuit/compiler/equivalence-checker.h"
+#include "../circuit/compiler/event-simulator.h"
+#include "../circuit/compiler/fault-simulator.h"
+#include "../circuit/compiler/native-evaluator.h"
+#include "../circuit/compiler/optimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+
+// how many vectors of a stimulus are read, evaluated and written at once
+constexpr static size_t VECTORS_PER_CHUNK = 4096;
+
+struct Options {
+    std::string stimulusPath;
+    std::string tracePath;
+    std::optional<StimulusFormat> format;
+    bool optimize = false;
+    bool native = false;
+    bool event = false;
+    size_t cycles = 1;
+    uint64_t vectors = 1 << 20;
+    uint64_t seed = 1;
+    bool signatures = false;
+    bool faults = false;
+};
+
+struct Probe {
+    std::string name;
+    uint32_t gateIndex;
+    size_t outputIndex;
+};
+
+using GateLookup = std::function<std::optional<uint32_t>(const std::string&)>;
+using ConstantSetter = std::function<void(uint32_t, int32_t)>;
+
+static void printUsage() {
+    std::cerr << "usage: circuit-sim <netlist> [<stimulus> | -] [-o <output>] [--cycles <n>]\n"
+                 "                   [--format text | csv | binary] [--optimize] [--native | --event]\n"
+                 "                   [--trace <trace>]\n"
+                 "       circuit-sim <netlist> --compile <binary netlist>\n"
+                 "       circuit-sim <trace> --vcd <vcd>\n"
+                 "       circuit-sim <netlist> --equivalent <netlist> [--vectors <n>] [--seed <n>]\n"
+                 "                   [--signatures]\n"
+                 "       circuit-sim <netlist> --check\n"
+                 "       circuit-sim <netlist> <stimulus> --faults --format csv | binary [--optimize]\n"
+                 "\n"
+                 "Evaluates the netlist once per stimulus line. A stimulus line holds whitespace separated\n"
+                 "<gate>=<value> assignments to ConstInt/ConstBool gates, which stay in effect for the\n"
+                 "following lines. For every line one line of <output>=<value> pairs is written.\n"
+                 "Without a stimulus the netlist is evaluated --cycles times, once by default, with its\n"
+                 "own constants. Every evaluation is one clock cycle: after writing the outputs, all\n"
+                 "registers store the value at their input.\n"
+                 "\n"
+                 "--format csv reads a stimulus of comma separated vectors instead, after a header line\n"
+                 "naming the input gate of every column, and writes the outputs the same way. --format\n"
+                 "binary does the same with the columnar binary format. Vectors are streamed in chunks,\n"
+                 "so stimuli of any length run in constant memory, and circuits without registers\n"
+                 "evaluate a whole chunk at once.\n"
+                 "\n"
+                 "Binary netlists written by --compile are recognized automatically and evaluated\n"
+                 "straight from a memory mapping, without building any gates.\n"
+                 "\n"
+                 "--optimize simplifies the circuit before simulating it, dropping everything the outputs\n"
+                 "do not depend on. Inputs driven by a csv or binary stimulus keep accepting it, and the\n"
+                 "other constants are folded into the gates reading them, as are all of them without a\n"
+                 "stimulus. A text stimulus may assign any input, so then nothing is folded.\n"
+                 "--native builds the circuit into native code with the C++ compiler named by $CXX, or\n"
+                 "c++, and falls back to the interpreter if that fails. --event simulates event by event,\n"
+                 "re-evaluating only the gates whose inputs changed, which pays off when little changes\n"
+                 "from cycle to cycle.\n"
+                 "\n"
+                 "--trace records the outputs of every cycle into a compact binary trace, which --vcd\n"
+                 "converts to a Value Change Dump for waveform viewers.\n"
+                 "\n"
+                 "--equivalent compares two netlists on --vectors vectors, about a million by default:\n"
+                 "corner cases first, then random ones drawn from --seed. Inputs are the ConstInt and\n"
+                 "ConstBool gates both netlists have, and outputs are matched by name too. The first\n"
+                 "vector on which an output differs is written as a stimulus line, and the exit status\n"
+                 "is then 3. --signatures first lists the internal nets of both netlists which agreed\n"
+                 "on a batch of random vectors.\n"
+                 "\n"
+                 "--check lists what keeps gates of the netlist from being evaluated, one problem per\n"
+                 "line: unconnected inputs, inputs reading an output of another type and combinational\n"
+                 "cycles. The exit status is 3 if there is any. Simulating prints the same as warnings.\n"
+                 "\n"
+                 "--faults grades the vectors of a csv or binary stimulus instead of simulating them: it\n"
+                 "prints how many single stuck-at faults on gate outputs make some output differ on at\n"
+                 "least one vector, out of all of them. Every vector is evaluated on its own, with the\n"
+                 "registers holding their initial state.\n";
+}
+
+static void writeOutputs(std::ostream& out, const CompiledCircuit& compiled, const std::vector<Probe>& probes) {
+    for (size_t i = 0; i < probes.size(); i++) {
+        if (i > 0) out << ' ';
+        out << probes[i].name << '=';
+
+        const auto value = compiled.getSlotValue(compiled.getSlot(probes[i].gateIndex, probes[i].outputIndex));
+        if (!value) {
+            out << '?';
+        } else {
+            std::visit([&](auto v) { out << static_cast<int>(v); }, *value);
+        }
+    }
+    out << '\n';
+}
+
+static int32_t getProbeValue(const CompiledCircuit& compiled, const Probe& probe) {
+    const auto value = compiled.getSlotValue(compiled.getSlot(probe.gateIndex, probe.outputIndex));
+    if (!value) return 0;
+
+    return std::visit([](auto v) { return static_cast<int32_t>(v); }, *value);
+}
+
+/**
+ * Evaluates a chunk of vectors at once, vector `v` in lane `v`. Both `inputValues` and
+ * `outputValues` hold one column of as many values as there are lanes per input or probe.
+ */
+static void evaluateBatch(BatchEvaluator& batch, const CompiledCircuit& compiled, const std::vector<uint32_t>& inputs,
+                          std::span<const int32_t> inputValues, const std::vector<Probe>& probes,
+                          std::span<int32_t> outputValues) {
+    const size_t lanes = batch.getLanesCount();
+    constexpr size_t WORD_BITS = BatchEvaluator::WORD_BITS;
+    std::vector<BatchEvaluator::Word> words(batch.getWordsCount());
+
+    for (size_t c = 0; c < inputs.size(); c++) {
+        const std::span<const int32_t> column = inputValues.subspan(c * lanes, lanes);
+
+        if (compiled.getSlotType(compiled.getSlot(inputs[c], 0)) == CircuitGate::Bool) {
+            std::fill(words.begin(), words.end(), 0);
+            for (size_t v = 0; v < lanes; v++) {
+                words[v / WORD_BITS] |= BatchEvaluator::Word(column[v] != 0) << (v % WORD_BITS);
+            }
+            batch.driveBool(inputs[c], words);
+        } else {
+            batch.driveInt(inputs[c], column);
+        }
+    }
+
+    batch.run();
+
+    for (size_t p = 0; p < probes.size(); p++) {
+        const Probe &probe = probes[p];
+        const std::span<int32_t> column = outputValues.subspan(p * lanes, lanes);
+        const CompiledCircuit::SlotIndex slot = compiled.getSlot(probe.gateIndex, probe.outputIndex);
+
+        if (slot >= compiled.getProgram().evaluableSlotsCount) {
+            std::fill(column.begin(), column.end(), 0);
+        } else if (compiled.getSlotType(slot) == CircuitGate::Bool) {
+            const std::span<const BatchEvaluator::Word> bits = batch.getBoolLanes(probe.gateIndex, probe.outputIndex);
+            for (size_t v = 0; v < lanes; v++) {
+                column[v] = (bits[v / WORD_BITS] >> (v % WORD_BITS)) & 1;
+            }
+        } else {
+            const std::span<const int32_t> values = batch.getIntLanes(probe.gateIndex, probe.outputIndex);
+            std::copy(values.begin(), values.end(), column.begin());
+        }
+    }
+}
+
+static void applyStimulus(const ConstantSetter& setConstant, const GateLookup& findGate, const std::string& line) {
+    std::istringstream assignments(line);
+    std::string assignment;
+
+    while (assignments >> assignment) {
+        const size_t eq = assignment.find('=');
+        if (eq == std::string::npos) {
+            throw std::runtime_error("expected <gate>=<value>, got '" + assignment + "'");
+        }
+
+        const std::string name = assignment.substr(0, eq);
+        const std::optional<uint32_t> gateIndex = findGate(name);
+        if (!gateIndex) {
+            throw std::runtime_error("unknown gate '" + name + "'");
+        }
+
+        setConstant(*gateIndex, std::stoi(assignment.substr(eq + 1)));
+    }
+}
+
+static Netlist loadNetlist(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("cannot open " + path);
+    }
+
+    return Netlist::load(file);
+}
+
+static int compile(const std::string& netlistPath, const std::string& binaryPath) {
+    const Netlist netlist = loadNetlist(netlistPath);
+
+    std::ofstream out(binaryPath, std::ios::binary);
+    if (!out) {
+        throw std::runtime_error("cannot open " + binaryPath);
+    }
+
+    saveBinaryNetlist(netlist, out);
+    return 0;
+}
+
+static int convertTrace(const std::string& tracePath, const std::string& vcdPath) {
+    std::ifstream in(tracePath, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("cannot open " + tracePath);
+    }
+
+    std::ofstream out(vcdPath);
+    if (!out) {
+        throw std::runtime_error("cannot open " + vcdPath);
+    }
+
+    TraceReader trace(in);
+    exportVcd(trace, out);
+    return 0;
+}
+
+static Netlist loadAnyNetlist(const std::string& path) {
+    if (MappedNetlist::isBinaryNetlist(path)) {
+        return MappedNetlist(path).toNetlist();
+    }
+
+    return loadNetlist(path);
+}
+
+static int checkNetlist(const std::string& netlistPath, std::ostream& out) {
+    const Netlist netlist = loadAnyNetlist(netlistPath);
+    const CircuitValidation &validation = netlist.circuit.validate();
+
+    for (const CircuitValidation::Diagnostic &diagnostic : validation.getDiagnostics()) {
+        out << CircuitValidation::describe(netlist.circuit, diagnostic, netlist.names) << "\n";
+    }
+
+    return validation.isValid() ? 0 : 3;
+}
+
+static int checkEquivalence(const std::string& firstPath, const std::string& secondPath, const Options& options,
+                            std::ostream& out) {
+    const std::array<Netlist, 2> netlists = {loadAnyNetlist(firstPath), loadAnyNetlist(secondPath)};
+    const std::array<CompiledCircuit, 2> compiled = {CompiledCircuit(netlists[0].circuit),
+                                                     CompiledCircuit(netlists[1].circuit)};
+
+    // constants of only one netlist are a part of its design, and keep their values
+    std::vector<std::string> inputNames;
+    std::vector<std::array<uint32_t, 2>> inputs;
+    for (CircuitGate *gate : netlists[0].circuit.getGates()) {
+        const std::string type = getGateType(*gate);
+        if (type != "ConstBool" && type != "ConstInt") continue;
+
+        const std::string &name = netlists[0].names[gate->getId()];
+        const CircuitGate *other = netlists[1].find(name);
+        if (!other) continue;
+
+        inputNames.push_back(name);
+        inputs.push_back({gate->getId(), other->getId()});
+    }
+
+    const std::vector<Netlist::Probe> outputs = netlists[0].getOutputsOrSinks();
+    const std::vector<Netlist::Probe> otherOutputs = netlists[1].getOutputsOrSinks();
+    std::vector<std::array<EquivalenceChecker::Net, 2>> matchedOutputs;
+    for (const Netlist::Probe &output : outputs) {
+        const auto other = std::find_if(otherOutputs.begin(), otherOutputs.end(),
+                                        [&](const Netlist::Probe& probe) { return probe.name == output.name; });
+        if (other == otherOutputs.end()) {
+            throw std::runtime_error("output '" + output.name + "' is missing from " + secondPath);
+        }
+
+        matchedOutputs.push_back({EquivalenceChecker::Net{output.gate, output.outputIndex},
+                                  EquivalenceChecker::Net{other->gate, other->outputIndex}});
+    }
+    if (otherOutputs.size() != outputs.size()) {
+        throw std::runtime_error(secondPath + " has outputs missing from " + firstPath);
+    }
+
+    EquivalenceChecker checker(compiled[0], compiled[1], inputs, matchedOutputs, options.seed);
+
+    if (options.signatures) {
+        auto getNetName = [&](size_t n, const EquivalenceChecker::Net& net) {
+            const std::string &name = netlists[n].names[net.gateIndex];
+            return netlists[n].circuit[net.gateIndex].getOutputsCount() == 1
+                   ? name
+                   : name + "." + std::to_string(net.outputIndex);
+        };
+
+        for (const EquivalenceChecker::NetMatch &match : checker.findCandidateNets()) {
+            out << "candidate " << getNetName(0, match.first) << " = " << getNetName(1, match.second) << '\n';
+        }
+    }
+
+    const std::optional<EquivalenceChecker::Counterexample> counterexample = checker.check(options.vectors);
+    if (!counterexample) {
+        out << "no difference in " << checker.getVectorsCount() << " vectors\n";
+        return 0;
+    }
+
+    out << "# vector " << counterexample->vector << ": " << outputs[counterexample->output].name << " is "
+        << counterexample->values[0] << " in " << firstPath << " but " << counterexample->values[1] << " in "
+        << secondPath << '\n';
+    for (size_t i = 0; i < inputs.size(); i++) {
+        out << (i > 0 ? " " : "") << inputNames[i] << '=' << counterexample->inputs[i];
+    }
+    out << '\n';
+
+    return 3;
+}
+
+/**
+ * Given the `inputs` a stimulus drives, every other constant keeps its value and is folded into the
+ * gates reading it. Without them, any constant may still be assigned, and none is folded.
+ */
+static void optimize(CompiledCircuit& compiled, const std::vector<Probe>& probes,
+                     const std::optional<std::vector<uint32_t>>& inputs) {
+    std::vector<uint32_t> outputs;
+    for (const Probe &probe : probes) {
+        outputs.push_back(probe.gateIndex);
+    }
+
+    OptimizationOptions optimization;
+    if (inputs) {
+        optimization.foldInputs = true;
+        optimization.keptInputs = *inputs;
+    }
+
+    const OptimizationStats stats = CircuitOptimizer(optimization).run(compiled, outputs);
+    std::cerr << "optimized " << stats.instructionsBefore << " instructions to " << stats.instructionsAfter << "\n";
+}
+
+/**
+ * The stimulus at `path`, read from `file`, or the standard input for "-".
+ */
+static std::istream& openStimulus(const std::string& path, std::ifstream& file) {
+    if (path == "-") return std::cin;
+
+    if (!path.empty()) {
+        file.open(path, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("cannot open " + path);
+        }
+    }
+
+    return file;
+}
+
+static std::vector<uint32_t> findInputs(const std::vector<std::string>& columns, const GateLookup& findGate) {
+    std::vector<uint32_t> inputs;
+    for (const std::string &column : columns) {
+        const std::optional<uint32_t> gateIndex = findGate(column);
+        if (!gateIndex) {
+            throw std::runtime_error("unknown input '" + column + "'");
+        }
+        inputs.push_back(*gateIndex);
+    }
+
+    return inputs;
+}
+
+static int gradeFaults(CompiledCircuit& compiled, const std::vector<Probe>& probes, const GateLookup& findGate,
+                       const Options& options, std::ostream& out) {
+    if (!options.format || options.stimulusPath.empty()) {
+        throw std::runtime_error("--faults needs a csv or binary stimulus");
+    }
+
+    std::ifstream stimulusFile;
+    StimulusReader reader(openStimulus(options.stimulusPath, stimulusFile), *options.format);
+    const std::vector<uint32_t> inputs = findInputs(reader.getColumns(), findGate);
+
+    if (options.optimize) {
+        optimize(compiled, probes, inputs);
+    }
+
+    // outputs which cannot be evaluated show no fault
+    std::vector<CompiledCircuit::SlotIndex> observed;
+    for (const Probe &probe : probes) {
+        const CompiledCircuit::SlotIndex slot = compiled.getSlot(probe.gateIndex, probe.outputIndex);
+        if (slot < compiled.getProgram().evaluableSlotsCount) {
+            observed.push_back(slot);
+        }
+    }
+
+    FaultSimulator faults(compiled, std::move(observed));
+
+    std::vector<int32_t> values(inputs.size() * VECTORS_PER_CHUNK);
+    while (const size_t count = reader.read(values, VECTORS_PER_CHUNK)) {
+        // the fault simulator takes columns of exactly `count` vectors
+        for (size_t c = 1; c < inputs.size() && count < VECTORS_PER_CHUNK; c++) {
+            std::copy_n(values.begin() + c * VECTORS_PER_CHUNK, count, values.begin() + c * count);
+        }
+
+        faults.simulate(inputs, values, count);
+    }
+
+    out << "detected " << faults.getDetectedCount() << " of " << faults.getFaults().size() << " faults in "
+        << faults.getVectorsCount() << " vectors, coverage " << faults.getCoverage() * 100 << "%\n";
+    return 0;
+}
+
+static int simulate(CompiledCircuit& compiled, const std::vector<Probe>& probes, const GateLookup& findGate,
+                    const Options& options, std::ostream& out) {
+    const std::string &stimulusPath = options.stimulusPath;
+    std::ifstream stimulusFile;
+    std::istream &stimulus = openStimulus(stimulusPath, stimulusFile);
+
+    // csv and binary stimuli name the inputs they drive up front, while a text stimulus may assign
+    // any constant on any line
+    std::optional<StimulusReader> reader;
+    std::vector<uint32_t> inputs;
+    if (options.format && !stimulusPath.empty()) {
+        reader.emplace(stimulus, *options.format);
+        inputs = findInputs(reader->getColumns(), findGate);
+    }
+
+    if (options.optimize) {
+        optimize(compiled, probes, stimulusPath.empty() || reader ? std::optional(inputs) : std::nullopt);
+    }
+
+    std::optional<NativeEvaluator> native;
+    if (options.native) {
+        native.emplace(compiled);
+        if (!native->isNative()) {
+            std::cerr << "warning: " << native->getError() << ", interpreting instead\n";
+        }
+    }
+
+    std::optional<EventSimulator> events;
+    if (options.event) {
+        events.emplace(compiled);
+    }
+
+    auto run = [&] {
+        if (events) {
+            events->settle();
+        } else if (native) {
+            native->run();
+        } else {
+            compiled.run();
+        }
+    };
+
+    auto clock = [&] {
+        if (events) {
+            events->clock();
+        } else {
+            compiled.clock();
+        }
+    };
+
+    const ConstantSetter setConstant = [&](uint32_t gateIndex, int32_t value) {
+        if (events) {
+            events->setConstant(gateIndex, value);
+        } else {
+            compiled.setConstant(gateIndex, value);
+        }
+    };
+
+    // declared before the recorder, which writes to it until it is gone
+    std::ofstream traceFile;
+    std::optional<TraceRecorder> trace;
+    if (!options.tracePath.empty()) {
+        traceFile.open(options.tracePath, std::ios::binary);
+        if (!traceFile) {
+            throw std::runtime_error("cannot open " + options.tracePath);
+        }
+
+        std::vector<TraceRecorder::Probe> traced;
+        for (const Probe &probe : probes) {
+            traced.push_back({probe.name, compiled.getSlot(probe.gateIndex, probe.outputIndex)});
+        }
+        trace.emplace(compiled, traced, traceFile);
+    }
+
+    TraceRecorder::Time cycle = 0;
+    auto evaluate = [&] {
+        run();
+        if (trace) {
+            trace->record(cycle);
+        }
+    };
+
+    auto advance = [&] {
+        clock();
+        cycle++;
+    };
+
+    auto finish = [&] {
+        if (trace) {
+            trace->finish();
+        }
+
+        if (events) {
+            std::cerr << events->getEvaluationsCount() << " gate evaluations over " << events->getTime() << " ticks\n";
+        }
+    };
+
+    if (options.format) {
+        std::vector<std::string> outputNames;
+        for (const Probe &probe : probes) {
+            outputNames.push_back(probe.name);
+        }
+
+        StimulusWriter writer(out, *options.format, outputNames);
+        std::vector<int32_t> outputValues(probes.size() * VECTORS_PER_CHUNK);
+
+        // one vector at a time, in the chunk's lane `v`
+        auto evaluateVector = [&](size_t v) {
+            evaluate();
+            for (size_t p = 0; p < probes.size(); p++) {
+                outputValues[p * VECTORS_PER_CHUNK + v] = getProbeValue(compiled, probes[p]);
+            }
+            advance();
+        };
+
+        if (stimulusPath.empty()) {
+            while (cycle < options.cycles) {
+                const size_t count = std::min<size_t>(VECTORS_PER_CHUNK, options.cycles - cycle);
+                for (size_t v = 0; v < count; v++) {
+                    evaluateVector(v);
+                }
+                writer.write(outputValues, VECTORS_PER_CHUNK, count);
+            }
+        } else {
+            // vectors are independent of each other unless something keeps state, or a particular
+            // evaluator was asked for
+            std::optional<BatchEvaluator> batch;
+            if (compiled.getRegisterInstructions().empty() && !events && !native && !trace) {
+                batch.emplace(compiled, VECTORS_PER_CHUNK);
+            }
+
+            std::vector<int32_t> inputValues(inputs.size() * VECTORS_PER_CHUNK);
+            while (const size_t count = reader->read(inputValues, VECTORS_PER_CHUNK)) {
+                if (batch) {
+                    evaluateBatch(*batch, compiled, inputs, inputValues, probes, outputValues);
+                    cycle += count;
+                } else {
+                    for (size_t v = 0; v < count; v++) {
+                        for (size_t c = 0; c < inputs.size(); c++) {
+                            setConstant(inputs[c], inputValues[c * VECTORS_PER_CHUNK + v]);
+                        }
+                        evaluateVector(v);
+                    }
+                }
+
+                writer.write(outputValues, VECTORS_PER_CHUNK, count);
+            }
+        }
+
+        writer.flush();
+        finish();
+        return 0;
+    }
+
+    if (stimulusPath.empty()) {
+        while (cycle < options.cycles) {
+            evaluate();
+            writeOutputs(out, compiled, probes);
+            advance();
+        }
+
+        finish();
+        return 0;
+    }
+
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(stimulus, line)) {
+        lineNumber++;
+        if (line.empty() || line[0] == '#') continue;
+
+        try {
+            applyStimulus(setConstant, findGate, line);
+        } catch (const std::exception &e) {
+            throw std::runtime_error("stimulus line " + std::to_string(lineNumber) + ": " + e.what());
+        }
+
+        evaluate();
+        writeOutputs(out, compiled, probes);
+        advance();
+    }
+
+    finish();
+    return 0;
+}
+
+static int simulateText(const std::string& netlistPath, const Options& options, std::ostream& out) {
+    const Netlist netlist = loadNetlist(netlistPath);
+
+    // compiling the whole circuit keeps gate indices equal to gate IDs
+    CompiledCircuit compiled(netlist.circuit);
+    for (const CircuitValidation::Diagnostic &diagnostic : netlist.circuit.validate().getDiagnostics()) {
+        std::cerr << "warning: " << CircuitValidation::describe(netlist.circuit, diagnostic, netlist.names) << "\n";
+    }
+
+    std::vector<Probe> probes;
+    for (const auto &probe : netlist.getOutputsOrSinks()) {
+        probes.push_back({probe.name, probe.gate, probe.outputIndex});
+    }
+
+    const GateLookup findGate = [&](const std::string& name) -> std::optional<uint32_t> {
+        const CircuitGate *gate = netlist.find(name);
+        if (!gate) return std::nullopt;
+        return gate->getId();
+    };
+
+    if (options.faults) {
+        return gradeFaults(compiled, probes, findGate, options, out);
+    }
+
+    return simulate(compiled, probes, findGate, options, out);
+}
+
+static int simulateBinary(const std::string& netlistPath, const Options& options, std::ostream& out) {
+    MappedNetlist mapped(netlistPath);
+    CompiledCircuit compiled = mapped.createCircuit();
+
+    std::vector<Probe> probes;
+    for (const auto &probe : mapped.getProbes()) {
+        probes.push_back({std::string(probe.name), probe.gateIndex, probe.outputIndex});
+    }
+
+    const GateLookup findGate = [&](const std::string& name) { return mapped.findGate(name); };
+
+    if (options.faults) {
+        return gradeFaults(compiled, probes, findGate, options, out);
+    }
+
+    return simulate(compiled, probes, findGate, options, out);
+}
+
+int main(int argc, char **argv) {
+    std::ios::sync_with_stdio(false);
+
+    std::string netlistPath, outputPath, compilePath, vcdPath, equivalentPath;
+    bool check = false;
+    Options options;
+    try {
+        for (int i = 1; i < argc; i++) {
+            const std::string arg = argv[i];
+
+            if (arg == "-h" || arg == "--help") {
+                printUsage();
+                return 0;
+            } else if (arg == "-o" && i + 1 < argc) {
+                outputPath = argv[++i];
+            } else if (arg == "--optimize") {
+                options.optimize = true;
+            } else if (arg == "--native") {
+                options.native = true;
+            } else if (arg == "--event") {
+                options.event = true;
+            } else if (arg == "--cycles" && i + 1 < argc) {
+                options.cycles = std::stoul(argv[++i]);
+            } else if (arg == "--format" && i + 1 < argc) {
+                const std::string format = argv[++i];
+                if (format == "csv") {
+                    options.format = StimulusFormat::Csv;
+                } else if (format == "binary") {
+                    options.format = StimulusFormat::Binary;
+                } else if (format != "text") {
+                    printUsage();
+                    return 2;
+                }
+            } else if (arg == "--trace" && i + 1 < argc) {
+                options.tracePath = argv[++i];
+            } else if (arg == "--vcd" && i + 1 < argc) {
+                vcdPath = argv[++i];
+            } else if (arg == "--equivalent" && i + 1 < argc) {
+                equivalentPath = argv[++i];
+            } else if (arg == "--vectors" && i + 1 < argc) {
+                options.vectors = std::stoull(argv[++i]);
+            } else if (arg == "--seed" && i + 1 < argc) {
+                options.seed = std::stoull(argv[++i]);
+            } else if (arg == "--signatures") {
+                options.signatures = true;
+            } else if (arg == "--faults") {
+                options.faults = true;
+            } else if (arg == "--check") {
+                check = true;
+            } else if (arg == "--compile" && i + 1 < argc) {
+                compilePath = argv[++i];
+            } else if (netlistPath.empty()) {
+                netlistPath = arg;
+            } else if (options.stimulusPath.empty()) {
+                options.stimulusPath = arg;
+            } else {
+                printUsage();
+                return 2;
+            }
+        }
+    } catch (const std::exception &) {
+        printUsage();
+        return 2;
+    }
+
+    if (netlistPath.empty() || (options.native && options.event)) {
+        printUsage();
+        return 2;
+    }
+
+    try {
+        if (!compilePath.empty()) {
+            return compile(netlistPath, compilePath);
+        }
+        if (!vcdPath.empty()) {
+            return convertTrace(netlistPath, vcdPath);
+        }
+
+        std::ofstream outputFile;
+        if (!outputPath.empty()) {
+            outputFile.open(outputPath);
+            if (!outputFile) {
+                throw std::runtime_error("cannot open " + outputPath);
+            }
+        }
+
+        std::ostream &out = outputPath.empty() ? std::cout : outputFile;
+        if (check) {
+            return checkNetlist(netlistPath, out);
+        }
+        if (!equivalentPath.empty()) {
+            return checkEquivalence(netlistPath, equivalentPath, options, out);
+        }
+
+        if (MappedNetlist::isBinaryNetlist(netlistPath)) {
+            return simulateBinary(netlistPath, options, out);
+        }
+
+        return simulateText(netlistPath, options, out);
+    } catch (const std::exception &e) {
+        std::cerr << "circuit-sim: " << e.what() << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,91 @@
+#include "tests.h"
+#include "../circuit/circuit.h"
+#include "../circuit/compiler/async-evaluator.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+// many chunks of instructions, so that a cancellation usually catches the worker halfway
+constexpr static size_t CHAIN_LENGTH = 1000000;
+
+/**
+ * A ConstBool gate followed by a chain of negations, of which the last gate is returned.
+ */
+static CircuitGate::GateID addChain(Circuit& circuit, size_t length) {
+    CircuitGate::GateID last = circuit.add<CircuitGate_ConstBool>().getId();
+    for (size_t i = 0; i < length; i++) {
+        const CircuitGate::GateID gate = circuit.add<CircuitGate_Not>().getId();
+        circuit.connect(last, 0, gate, 0);
+        last = gate;
+    }
+
+    return last;
+}
+
+static std::optional<CompiledCircuit> waitForResult(AsyncEvaluator& evaluator) {
+    while (evaluator.isRunning()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    return evaluator.takeResult();
+}
+
+static void expectValue(const std::optional<CompiledCircuit>& result, const CircuitGate& gate, bool expected,
+                        const std::string& what) {
+    if (!result) {
+        throw std::runtime_error(what + " has no result");
+    }
+    if (result->getValue(gate, 0) != std::optional<std::variant<int, bool>>(expected)) {
+        throw std::runtime_error(what + " evaluates to something else");
+    }
+}
+
+void testAsync() {
+    Circuit circuit;
+    const CircuitGate &last = circuit[addChain(circuit, CHAIN_LENGTH)];
+    AsyncEvaluator evaluator;
+
+    // an even chain of negations keeps the value of its input
+    std::atomic<bool> finished = false;
+    evaluator.submit(CompiledCircuit::Snapshot(circuit, {last.getId()}), [&] { finished = true; });
+    while (!finished) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    const std::optional<CompiledCircuit> result = waitForResult(evaluator);
+    expectValue(result, last, false, "an evaluation");
+    if (evaluator.getProgress() != 1.0f) {
+        throw std::runtime_error("a finished evaluation is not complete");
+    }
+    if (evaluator.takeResult()) {
+        throw std::runtime_error("a result was taken twice");
+    }
+
+    // cancelled evaluations leave nothing behind, whether or not the worker got to finish them
+    evaluator.submit(CompiledCircuit(circuit, {last.getId()}));
+    evaluator.cancel();
+    if (waitForResult(evaluator)) {
+        throw std::runtime_error("a cancelled evaluation has a result");
+    }
+
+    // only the last submission counts, and its result tells whether the gates changed since
+    const uint64_t revision = circuit.getRevision();
+    evaluator.submit(CompiledCircuit::Snapshot(circuit, {last.getId()}));
+    evaluator.submit(CompiledCircuit::Snapshot(circuit, {last.getId()}));
+
+    const CircuitGate &other = circuit[addChain(circuit, 1)];
+    evaluator.submit(CompiledCircuit::Snapshot(circuit, {last.getId(), other.getId()}));
+    const std::optional<CompiledCircuit> latest = waitForResult(evaluator);
+    expectValue(latest, other, true, "the last of several evaluations");
+    if (latest->getRevision() != circuit.getRevision()) {
+        throw std::runtime_error("the last evaluation is not of the current gates");
+    }
+
+    evaluator.submit(CompiledCircuit::Snapshot(circuit, {last.getId()}));
+    circuit.connect(last.getId(), 0, other.getId(), 0);
+    const std::optional<CompiledCircuit> stale = waitForResult(evaluator);
+    if (!stale || stale->getRevision() == circuit.getRevision() || revision == circuit.getRevision()) {
+        throw std::runtime_error("an evaluation of gates edited in the meantime looks current");
+    }
+}
@@ -0,0 +1,149 @@
+#include "helpers.h"
+#include "random-netlist.h"
+#include "tests.h"
+#include "../circuit/io/binary-netlist.h"
+
+#include <cstring>
+#include <filesystem>
+#include <sstream>
+
+constexpr static uint64_t NETLISTS_COUNT = 50;
+constexpr static size_t MUTATIONS_COUNT = 1000;
+
+/**
+ * Checks everything a mapped netlist offers against the netlist it was saved from.
+ */
+static void checkMappedNetlist(const RandomNetlist& random, MappedNetlist& mapped, std::mt19937_64& rng,
+                               uint64_t seed) {
+    const Netlist &netlist = random.netlist;
+    const Circuit &circuit = netlist.circuit;
+    auto fail = [&](const std::string& what) {
+        throw std::runtime_error("binary netlist " + std::to_string(seed) + ": " + what);
+    };
+
+    if (mapped.getGatesCount() != circuit.getGatesCount()) fail("wrong number of gates");
+
+    for (uint32_t g = 0; g < circuit.getGatesCount(); g++) {
+        if (mapped.getGateName(g) != netlist.names[g] || mapped.findGate(netlist.names[g]) != g) {
+            fail("wrong name of gate " + netlist.names[g]);
+        }
+    }
+
+    const std::vector<Netlist::Probe> outputs = netlist.getOutputsOrSinks();
+    const std::vector<MappedNetlist::Probe> probes = mapped.getProbes();
+    if (probes.size() != outputs.size()) fail("wrong number of probes");
+    for (size_t p = 0; p < probes.size(); p++) {
+        if (probes[p].name != outputs[p].name || probes[p].gateIndex != outputs[p].gate
+            || probes[p].outputIndex != outputs[p].outputIndex) {
+            fail("wrong probe " + outputs[p].name);
+        }
+    }
+
+    if (saveText(mapped.toNetlist()) != saveText(netlist)) fail("the gates read back differ");
+
+    // the program evaluated in place against a fresh compilation of the gates, whose indices are the same
+    CompiledCircuit expected(circuit);
+    CompiledCircuit inPlace = mapped.createCircuit();
+
+    for (size_t cycle = 0; cycle < 4; cycle++) {
+        for (CircuitGate::GateID input : random.inputs) {
+            const int32_t value = circuit[input].getOutputType(0) == CircuitGate::Bool
+                                  ? static_cast<int32_t>(rng() % 2) : makeRandomInt(rng);
+            expected.setConstant(input, value);
+            inPlace.setConstant(input, value);
+        }
+
+        expected.run();
+        inPlace.run();
+
+        for (uint32_t g = 0; g < circuit.getGatesCount(); g++) {
+            for (size_t o = 0; o < circuit[g].getOutputsCount(); o++) {
+                if (inPlace.getSlotValue(inPlace.getSlot(g, o)) != expected.getValue(circuit[g], o)) {
+                    fail("cycle " + std::to_string(cycle) + ": wrong value of " + netlist.names[g]);
+                }
+            }
+        }
+
+        expected.clock();
+        inPlace.clock();
+    }
+
+    // gates of a mapped netlist have a single output, and slots past it are not handed out
+    expectRejected([&] { (void) inPlace.getSlot(0, 1); }, "a second output of a mapped gate");
+    expectRejected([&] { (void) inPlace.getSlot(circuit.getGatesCount(), 0); }, "a gate past the mapped ones");
+}
+
+/**
+ * Loads a damaged binary netlist, which must either be rejected or load into something that can
+ * be evaluated and turned back into gates.
+ */
+static void loadCorrupted(const std::string& path) {
+    try {
+        MappedNetlist mapped(path);
+        (void) mapped.getProbes();
+
+        CompiledCircuit compiled = mapped.createCircuit();
+        compiled.run();
+        compiled.clock();
+
+        (void) mapped.toNetlist();
+    } catch (const std::runtime_error &) {
+        // rejected, as it should be unless the damage happens to leave a valid netlist
+    }
+}
+
+void testBinaryNetlist() {
+    const std::string path = getTempPath("binary-netlist.cirb");
+
+    for (uint64_t seed = 0; seed < NETLISTS_COUNT; seed++) {
+        std::mt19937_64 rng(seed);
+        const RandomNetlist random = makeRandomNetlist(10 + seed * 37 % 200, false, rng);
+
+        std::ostringstream out;
+        saveBinaryNetlist(random.netlist, out);
+        const std::string data = out.str();
+
+        writeFile(path, data);
+        MappedNetlist mapped(path);
+        checkMappedNetlist(random, mapped, rng, seed);
+
+        if (seed % 10 != 0) continue;
+
+        // everything is referred to from the header, so cutting off even one byte has to be noticed
+        for (size_t size = 0; size < data.size(); size += 1 + size / 16) {
+            writeFile(path, std::string_view(data).substr(0, size));
+            expectRejected([&] { MappedNetlist truncated(path); },
+                           "binary netlist truncated to " + std::to_string(size) + " bytes");
+        }
+
+        std::string corrupted = data;
+        corrupted[0] = 'X';
+        writeFile(path, corrupted);
+        expectRejected([&] { MappedNetlist wrongMagic(path); }, "binary netlist with a wrong magic");
+
+        corrupted = data;
+        const uint32_t version = BinaryNetlistHeader::VERSION + 1;
+        std::memcpy(corrupted.data() + offsetof(BinaryNetlistHeader, version), &version, sizeof version);
+        writeFile(path, corrupted);
+        expectRejected([&] { MappedNetlist wrongVersion(path); }, "binary netlist of an unknown version");
+
+        for (size_t s = 0; s < BinaryNetlistHeader::SECTIONS_COUNT; s++) {
+            corrupted = data;
+            const uint64_t offset = data.size() + 8;
+            std::memcpy(corrupted.data() + offsetof(BinaryNetlistHeader, sectionOffsets) + s * sizeof offset,
+                        &offset, sizeof offset);
+            writeFile(path, corrupted);
+            expectRejected([&] { MappedNetlist outOfBounds(path); }, "binary netlist with section "
+                           + std::to_string(s) + " out of bounds");
+        }
+
+        for (size_t m = 0; m < MUTATIONS_COUNT; m++) {
+            corrupted = data;
+            mutate(corrupted, rng);
+            writeFile(path, corrupted);
+            loadCorrupted(path);
+        }
+    }
+
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,84 @@
+#include "tests.h"
+#include "../circuit/circuit.h"
+
+#include <array>
+#include <stdexcept>
+#include <string>
+
+// deep enough to overflow the stack of any recursive evaluation
+constexpr static size_t CHAIN_LENGTH = 1000001;
+
+static void expectState(const std::string& what, int actual, int expected) {
+    if (actual != expected) {
+        throw std::runtime_error(what + " holds " + std::to_string(actual) + " instead of " + std::to_string(expected));
+    }
+}
+
+static void testDeepFanin() {
+    Circuit circuit;
+    CircuitGate_ConstBool &input = circuit.add<CircuitGate_ConstBool>();
+    CircuitGate::GateID last = input.getId();
+    for (size_t i = 0; i < CHAIN_LENGTH; i++) {
+        const CircuitGate::GateID gate = circuit.add<CircuitGate_Not>().getId();
+        circuit.connect(last, 0, gate, 0);
+        last = gate;
+    }
+
+    CircuitGate_Register &reg = circuit.add<CircuitGate_Register>();
+    circuit.connect(last, 0, reg.getId(), 0);
+
+    circuit.clock();
+    expectState("a register behind an odd chain of negations", reg.value, true);
+
+    input.value = true;
+    input.invalidate();
+    circuit.clock();
+    expectState("a register behind an odd chain of negations", reg.value, false);
+}
+
+static void testLatching() {
+    Circuit circuit;
+
+    // a twisted ring of two registers, which only counts through 00, 01, 11, 10 if both of them
+    // read their input before either of them changes
+    CircuitGate_Register &first = circuit.add<CircuitGate_Register>();
+    CircuitGate_Register &second = circuit.add<CircuitGate_Register>();
+    const CircuitGate::GateID inverter = circuit.add<CircuitGate_Not>().getId();
+    circuit.connect(second.getId(), 0, first.getId(), 0);
+    circuit.connect(first.getId(), 0, inverter, 0);
+    circuit.connect(inverter, 0, second.getId(), 0);
+
+    // a counter, and registers with nothing or nothing evaluable at their input
+    CircuitGate_IntRegister &counter = circuit.add<CircuitGate_IntRegister>();
+    CircuitGate_ConstInt &one = circuit.add<CircuitGate_ConstInt>();
+    const CircuitGate::GateID sum = circuit.add<CircuitGate_Add>().getId();
+    one.value = 1;
+    circuit.connect(counter.getId(), 0, sum, 0);
+    circuit.connect(one.getId(), 0, sum, 1);
+    circuit.connect(sum, 0, counter.getId(), 0);
+
+    CircuitGate_Register &unconnected = circuit.add<CircuitGate_Register>();
+    CircuitGate_Register &blocked = circuit.add<CircuitGate_Register>();
+    const CircuitGate::GateID halfConnected = circuit.add<CircuitGate_And>().getId();
+    circuit.connect(first.getId(), 0, halfConnected, 0);
+    circuit.connect(halfConnected, 0, blocked.getId(), 0);
+    unconnected.value = true;
+    blocked.value = true;
+
+    const std::array<std::pair<bool, bool>, 4> ring = {{{false, false}, {false, true}, {true, true}, {true, false}}};
+    for (int cycle = 1; cycle <= 8; cycle++) {
+        circuit.clock();
+
+        const std::string when = " after " + std::to_string(cycle) + " cycles";
+        expectState("the first register of the ring" + when, first.value, ring[cycle % 4].first);
+        expectState("the second register of the ring" + when, second.value, ring[cycle % 4].second);
+        expectState("the counter" + when, counter.value, cycle);
+        expectState("an unconnected register" + when, unconnected.value, true);
+        expectState("a register reading an unevaluable gate" + when, blocked.value, true);
+    }
+}
+
+void testClock() {
+    testDeepFanin();
+    testLatching();
+}
@@ -0,0 +1,239 @@
+#include "random-netlist.h"
+#include "tests.h"
+#include "../circuit/visitor.h"
+#include "../circuit/compiler/batch-evaluator.h"
+#include "../circuit/compiler/cone-evaluator.h"
+#include "../circuit/compiler/event-simulator.h"
+#include "../circuit/compiler/native-evaluator.h"
+#include "../circuit/compiler/optimizer.h"
+#include "../circuit/compiler/parallel-evaluator.h"
+
+#include <iostream>
+#include <optional>
+
+using Value = std::optional<int32_t>;
+
+constexpr static uint64_t CIRCUITS_COUNT = 200;
+constexpr static size_t CYCLES_COUNT = 8;
+constexpr static size_t LANES_COUNT = 128;
+// every native evaluator runs the system's compiler, so only the first few circuits get one
+constexpr static uint64_t NATIVE_CIRCUITS_COUNT = 3;
+
+static std::string describe(const Value& value) {
+    return value ? std::to_string(*value) : "nothing";
+}
+
+static Value toValue(const std::optional<std::variant<int, bool>>& value) {
+    if (!value) return std::nullopt;
+    return std::visit([](auto v) { return static_cast<int32_t>(v); }, *value);
+}
+
+/**
+ * Evaluates every gate with the gate-level evaluator, which all other evaluators are checked against.
+ */
+static void evaluateReference(const Circuit& circuit) {
+    CircuitVisitor_Eval eval(circuit.validate());
+    for (CircuitGate *gate : circuit.getGates()) {
+        gate->acceptVisitor(eval);
+    }
+}
+
+static Value getReferenceValue(const CircuitGate& gate, size_t output) {
+    const CircuitGate::OutputPin pin = gate.getOutput(output);
+    if (!pin.isEval) return std::nullopt;
+    return pin.value;
+}
+
+static void expectEqual(const Value& actual, const Value& expected, const std::string& evaluator, uint64_t seed,
+                        size_t cycle, const Netlist& netlist, const CircuitGate& gate, size_t output) {
+    if (actual == expected) return;
+
+    throw std::runtime_error("circuit " + std::to_string(seed) + ", cycle " + std::to_string(cycle) + ": "
+                             + evaluator + " evaluates " + netlist.names[gate.getId()] + "." + std::to_string(output)
+                             + " to " + describe(actual) + " instead of " + describe(expected));
+}
+
+static uint32_t getIndex(const CompiledCircuit& compiled, const CircuitGate& gate) {
+    const std::optional<uint32_t> index = compiled.getGateIndex(gate);
+    if (!index) {
+        throw std::runtime_error("gate " + std::to_string(gate.getId()) + " is not compiled");
+    }
+
+    return *index;
+}
+
+/**
+ * Drives every input with random values in every lane, lane 0 getting the values the inputs have.
+ */
+static void driveLanes(BatchEvaluator& batch, const RandomNetlist& random, std::mt19937_64& rng) {
+    const Circuit &circuit = random.netlist.circuit;
+    std::vector<BatchEvaluator::Word> words(batch.getWordsCount());
+    std::vector<int32_t> ints(batch.getLanesCount());
+
+    for (CircuitGate::GateID input : random.inputs) {
+        CircuitGate &gate = circuit[input];
+        const int32_t value = *getConstantValue(gate);
+
+        if (gate.getOutputType(0) == CircuitGate::Bool) {
+            for (BatchEvaluator::Word &word : words) {
+                word = rng();
+            }
+            words[0] = (words[0] & ~BatchEvaluator::Word(1)) | BatchEvaluator::Word(value != 0);
+            batch.driveBool(gate, words);
+        } else {
+            for (int32_t &lane : ints) {
+                lane = makeRandomInt(rng);
+            }
+            ints[0] = value;
+            batch.driveInt(gate, ints);
+        }
+    }
+}
+
+static Value getLaneValue(const BatchEvaluator& batch, const CircuitGate& gate, size_t output, size_t lane) {
+    if (gate.getOutputType(output) == CircuitGate::Bool) {
+        return batch.getBool(gate, lane, output);
+    }
+
+    return batch.getInt(gate, lane, output);
+}
+
+/**
+ * Checks the given lanes of the batch against the reference, setting the inputs to each lane's
+ * values in turn and back to those of lane 0 in the end.
+ */
+static void checkLanes(const BatchEvaluator& batch, const RandomNetlist& random, std::initializer_list<size_t> lanes,
+                       uint64_t seed, size_t cycle) {
+    const Circuit &circuit = random.netlist.circuit;
+
+    for (size_t lane : lanes) {
+        for (CircuitGate::GateID input : random.inputs) {
+            setConstantValue(circuit[input], *getLaneValue(batch, circuit[input], 0, lane));
+        }
+        evaluateReference(circuit);
+
+        for (CircuitGate *gate : circuit.getGates()) {
+            for (size_t o = 0; o < gate->getOutputsCount(); o++) {
+                const Value expected = getReferenceValue(*gate, o);
+                // lanes hold garbage for nets which cannot be evaluated
+                if (!expected) continue;
+
+                expectEqual(getLaneValue(batch, *gate, o, lane), expected, "lane " + std::to_string(lane)
+                            + " of the batch evaluator", seed, cycle, random.netlist, *gate, o);
+            }
+        }
+    }
+
+    for (CircuitGate::GateID input : random.inputs) {
+        setConstantValue(circuit[input], *getLaneValue(batch, circuit[input], 0, 0));
+    }
+}
+
+static void runCircuit(uint64_t seed, size_t gatesCount) {
+    std::mt19937_64 rng(seed);
+    RandomNetlist random = makeRandomNetlist(gatesCount, true, rng);
+    const Netlist &netlist = random.netlist;
+    Circuit &circuit = random.netlist.circuit;
+
+    CompiledCircuit compiled(circuit), optimized(circuit), parallelCompiled(circuit), coneCompiled(circuit),
+            eventCompiled(circuit), nativeCompiled(circuit);
+
+    std::vector<uint32_t> optimizedOutputs;
+    for (const Netlist::Probe &probe : netlist.outputs) {
+        optimizedOutputs.push_back(getIndex(optimized, circuit[probe.gate]));
+    }
+    CircuitOptimizer().run(optimized, optimizedOutputs);
+
+    ParallelEvaluator parallel(parallelCompiled, 4);
+    ConeEvaluator cone(coneCompiled);
+    BatchEvaluator batch(compiled, LANES_COUNT);
+
+    EventSimulator events(eventCompiled);
+    for (CircuitGate *gate : circuit.getGates()) {
+        const uint32_t index = getIndex(eventCompiled, *gate);
+        if (eventCompiled.getProgram().gateInstructions[index] != CompiledCircuit::NO_INSTRUCTION) {
+            events.setDelay(index, 1 + rng() % 3);
+        }
+    }
+
+    std::optional<NativeEvaluator> native;
+    if (seed < NATIVE_CIRCUITS_COUNT) {
+        native.emplace(nativeCompiled);
+        if (!native->isNative() && seed == 0) {
+            std::cerr << "native code unavailable, checking its fallback: " << native->getError() << "\n";
+        }
+    }
+
+    for (size_t cycle = 0; cycle < CYCLES_COUNT; cycle++) {
+        for (CircuitGate::GateID input : random.inputs) {
+            CircuitGate &gate = circuit[input];
+            const int32_t value = gate.getOutputType(0) == CircuitGate::Bool ? static_cast<int32_t>(rng() % 2)
+                                                                              : makeRandomInt(rng);
+
+            setConstantValue(gate, value);
+            compiled.setConstant(gate, value);
+            parallelCompiled.setConstant(gate, value);
+            nativeCompiled.setConstant(gate, value);
+            cone.setConstant(getIndex(coneCompiled, gate), value);
+            events.setConstant(gate, value);
+
+            // inputs reaching no output are optimized away
+            if (optimized.isConstant(getIndex(optimized, gate))) {
+                optimized.setConstant(gate, value);
+            }
+        }
+
+        evaluateReference(circuit);
+        compiled.run();
+        optimized.run();
+        parallel.run();
+        events.settle();
+        if (native) native->run();
+
+        for (CircuitGate *gate : circuit.getGates()) {
+            for (size_t o = 0; o < gate->getOutputsCount(); o++) {
+                const Value expected = getReferenceValue(*gate, o);
+
+                expectEqual(toValue(compiled.getValue(*gate, o)), expected, "the compiled circuit",
+                            seed, cycle, netlist, *gate, o);
+                expectEqual(toValue(parallelCompiled.getValue(*gate, o)), expected, "the parallel evaluator",
+                            seed, cycle, netlist, *gate, o);
+                expectEqual(toValue(cone.getValue(getIndex(coneCompiled, *gate), o)), expected, "the cone evaluator",
+                            seed, cycle, netlist, *gate, o);
+                expectEqual(toValue(eventCompiled.getValue(*gate, o)), expected, "the event simulator",
+                            seed, cycle, netlist, *gate, o);
+                if (native) {
+                    expectEqual(toValue(nativeCompiled.getValue(*gate, o)), expected, "the native evaluator",
+                                seed, cycle, netlist, *gate, o);
+                }
+            }
+        }
+
+        for (const Netlist::Probe &probe : netlist.outputs) {
+            const CircuitGate &gate = circuit[probe.gate];
+            const size_t o = probe.outputIndex;
+            expectEqual(toValue(optimized.getValue(gate, o)), getReferenceValue(gate, o), "the optimized circuit",
+                        seed, cycle, netlist, gate, o);
+        }
+
+        driveLanes(batch, random, rng);
+        batch.run();
+        checkLanes(batch, random, {0, 1, LANES_COUNT - 1}, seed, cycle);
+
+        circuit.clock();
+        compiled.clock();
+        optimized.clock();
+        parallelCompiled.clock();
+        nativeCompiled.clock();
+        cone.clock();
+        events.clock();
+    }
+}
+
+void testDifferential() {
+    for (uint64_t seed = 0; seed < CIRCUITS_COUNT; seed++) {
+        // mostly small circuits, and now and then one wide enough for the parallel evaluator to split its levels
+        const size_t gatesCount = seed % 50 == 49 ? 20000 : 10 + seed * 37 % 300;
+        runCircuit(seed, gatesCount);
+    }
+}
@@ -0,0 +1,143 @@
+#include "tests.h"
+#include "../circuit/compiler/equivalence-checker.h"
+#include "../circuit/io/netlist.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using Net = EquivalenceChecker::Net;
+
+constexpr static uint64_t VECTORS_COUNT = 100000;
+
+/**
+ * Two circuits starting with the same inputs, matched by pairs of gate indices.
+ */
+struct NetlistPair {
+    Netlist first, second;
+    std::vector<std::array<uint32_t, 2>> inputs;
+};
+
+static uint32_t getIndex(const Netlist& netlist, const std::string& name) {
+    return netlist.find(name)->getId();
+}
+
+static NetlistPair makePair(const std::vector<std::pair<std::string, std::string>>& inputs) {
+    NetlistPair pair;
+    for (const auto &[name, type] : inputs) {
+        (void) pair.first.add(name, type);
+        (void) pair.second.add(name, type);
+        pair.inputs.push_back({getIndex(pair.first, name), getIndex(pair.second, name)});
+    }
+
+    return pair;
+}
+
+static void addGate(Netlist& netlist, const std::string& name, const std::string& type,
+                    const std::vector<std::string>& sources) {
+    const uint32_t gate = netlist.add(name, type).getId();
+    for (size_t i = 0; i < sources.size(); i++) {
+        netlist.circuit.connect(getIndex(netlist, sources[i]), 0, gate, i);
+    }
+}
+
+/**
+ * The value of `output` in the circuit with the inputs set as in the counterexample.
+ */
+static int32_t evaluateAt(const Netlist& netlist, size_t side, const NetlistPair& pair,
+                          const EquivalenceChecker::Counterexample& counterexample, const std::string& output) {
+    CompiledCircuit compiled(netlist.circuit);
+    for (size_t i = 0; i < pair.inputs.size(); i++) {
+        compiled.setConstant(pair.inputs[i][side], counterexample.inputs[i]);
+    }
+    compiled.run();
+
+    return std::visit([](auto v) { return static_cast<int32_t>(v); },
+                      *compiled.getValue(netlist.circuit[getIndex(netlist, output)], 0));
+}
+
+static void testMutation() {
+    // s = x + z and y = a & (s <= x), of which the second circuit computes s as x * z instead
+    NetlistPair pair = makePair({{"a", "ConstBool"}, {"x", "ConstInt"}, {"z", "ConstInt"}});
+    for (auto [netlist, sum] : {std::pair{&pair.first, "Add"}, std::pair{&pair.second, "Mul"}}) {
+        addGate(*netlist, "s", sum, {"x", "z"});
+        addGate(*netlist, "le", "CmpLe", {"s", "x"});
+        addGate(*netlist, "y", "And", {"a", "le"});
+    }
+
+    const std::vector<std::string> outputNames = {"y", "s"};
+    std::vector<std::array<Net, 2>> outputs;
+    for (const std::string &name : outputNames) {
+        outputs.push_back({Net{getIndex(pair.first, name)}, Net{getIndex(pair.second, name)}});
+    }
+
+    const CompiledCircuit first(pair.first.circuit), second(pair.second.circuit);
+    EquivalenceChecker checker(first, second, pair.inputs, outputs);
+    const std::optional<EquivalenceChecker::Counterexample> counterexample = checker.check(VECTORS_COUNT);
+    if (!counterexample) {
+        throw std::runtime_error("a sum and a product are found equivalent");
+    }
+
+    // the values reported are the ones the vector gives, and differ
+    const std::string &output = outputNames[counterexample->output];
+    const std::array<int32_t, 2> values = {evaluateAt(pair.first, 0, pair, *counterexample, output),
+                                           evaluateAt(pair.second, 1, pair, *counterexample, output)};
+    if (values != counterexample->values || values[0] == values[1]) {
+        throw std::runtime_error("vector " + std::to_string(counterexample->vector) + " gives " + output + " = "
+                                 + std::to_string(values[0]) + " and " + std::to_string(values[1])
+                                 + ", reported as " + std::to_string(counterexample->values[0]) + " and "
+                                 + std::to_string(counterexample->values[1]));
+    }
+
+    // and it is the first one: the same sequence of vectors finds nothing before it
+    EquivalenceChecker again(first, second, pair.inputs, outputs);
+    if (again.check(counterexample->vector) || again.getVectorsCount() != counterexample->vector) {
+        throw std::runtime_error("vector " + std::to_string(counterexample->vector) + " is not the first to differ");
+    }
+
+    const std::optional<EquivalenceChecker::Counterexample> repeated = again.check(1);
+    if (!repeated || repeated->vector != counterexample->vector || repeated->inputs != counterexample->inputs) {
+        throw std::runtime_error("the counterexample is not found again");
+    }
+}
+
+static void testRestructuring() {
+    // y = a & b, and y = !!a & b in the second circuit
+    NetlistPair pair = makePair({{"a", "ConstBool"}, {"b", "ConstBool"}});
+    addGate(pair.first, "y", "And", {"a", "b"});
+    addGate(pair.second, "n", "Not", {"a"});
+    addGate(pair.second, "nn", "Not", {"n"});
+    addGate(pair.second, "y", "And", {"nn", "b"});
+
+    const CompiledCircuit first(pair.first.circuit), second(pair.second.circuit);
+    EquivalenceChecker checker(first, second, pair.inputs,
+                               {{Net{getIndex(pair.first, "y")}, Net{getIndex(pair.second, "y")}}});
+    if (const auto counterexample = checker.check(VECTORS_COUNT)) {
+        throw std::runtime_error("double negation differs on vector " + std::to_string(counterexample->vector));
+    }
+    if (checker.getVectorsCount() != VECTORS_COUNT) {
+        throw std::runtime_error(std::to_string(checker.getVectorsCount()) + " vectors were checked");
+    }
+
+    // every net of the second circuit but n has its counterpart
+    std::vector<std::pair<std::string, std::string>> matches;
+    for (const EquivalenceChecker::NetMatch &match : checker.findCandidateNets()) {
+        matches.emplace_back(pair.first.names[match.first.gateIndex], pair.second.names[match.second.gateIndex]);
+    }
+    std::sort(matches.begin(), matches.end());
+
+    const std::vector<std::pair<std::string, std::string>> expected = {
+            {"a", "a"}, {"a", "nn"}, {"b", "b"}, {"y", "y"},
+    };
+    if (matches != expected) {
+        std::string found;
+        for (const auto &[a, b] : matches) {
+            found += " " + a + "=" + b;
+        }
+        throw std::runtime_error("candidate nets are" + found);
+    }
+}
+
+void testEquivalence() {
+    testMutation();
+    testRestructuring();
+}
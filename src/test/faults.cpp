@@ -0,0 +1,77 @@
+#include "tests.h"
+#include "../circuit/io/netlist.h"
+#include "../circuit/compiler/fault-simulator.h"
+
+#include <map>
+#include <stdexcept>
+
+static std::string describe(const Netlist& netlist, const FaultSimulator::Fault& fault) {
+    return netlist.names[fault.gateIndex] + " stuck at " + (fault.stuckAtOne ? "1" : "0");
+}
+
+void testFaults() {
+    // y = (a & b) & (a & a), in which `e = a & a` only ever matters when it is 0
+    Netlist netlist;
+    Circuit &circuit = netlist.circuit;
+    const CircuitGate::GateID a = netlist.add("a", "ConstBool").getId();
+    const CircuitGate::GateID b = netlist.add("b", "ConstBool").getId();
+    const CircuitGate::GateID c = netlist.add("c", "And").getId();
+    const CircuitGate::GateID e = netlist.add("e", "And").getId();
+    const CircuitGate::GateID y = netlist.add("y", "And").getId();
+    circuit.connect(a, 0, c, 0);
+    circuit.connect(b, 0, c, 1);
+    circuit.connect(a, 0, e, 0);
+    circuit.connect(a, 0, e, 1);
+    circuit.connect(c, 0, y, 0);
+    circuit.connect(e, 0, y, 1);
+
+    const CompiledCircuit compiled(circuit);
+    FaultSimulator simulator(compiled, {compiled.getSlot(y, 0)});
+
+    // vectors (a, b) = 00, 01, 10, 11, and for every fault the first of them which makes y differ
+    const std::map<std::pair<std::string, bool>, std::optional<uint64_t>> expected = {
+            {{"a", false}, 3}, {{"a", true}, 1},
+            {{"b", false}, 3}, {{"b", true}, 2},
+            {{"c", false}, 3}, {{"c", true}, 2},
+            {{"e", false}, 3}, {{"e", true}, std::nullopt},
+            {{"y", false}, 3}, {{"y", true}, 0},
+    };
+
+    if (simulator.getFaults().size() != expected.size()) {
+        throw std::runtime_error(std::to_string(simulator.getFaults().size()) + " faults instead of "
+                                 + std::to_string(expected.size()));
+    }
+
+    // in two calls, which keep counting vectors from the first one
+    const std::vector<uint32_t> inputs = {a, b};
+    (void) simulator.simulate(inputs, std::vector<int32_t>{0, 0, 0, 1}, 2);
+    (void) simulator.simulate(inputs, std::vector<int32_t>{1, 1, 0, 1}, 2);
+
+    for (size_t f = 0; f < simulator.getFaults().size(); f++) {
+        const FaultSimulator::Fault &fault = simulator.getFaults()[f];
+        const std::optional<uint64_t> vector = simulator.getDetectingVector(f);
+        const std::optional<uint64_t> expectedVector = expected.at({netlist.names[fault.gateIndex], fault.stuckAtOne});
+
+        if (vector != expectedVector) {
+            throw std::runtime_error(describe(netlist, fault) + " is detected by vector "
+                                     + (vector ? std::to_string(*vector) : "none") + " instead of "
+                                     + (expectedVector ? std::to_string(*expectedVector) : "none"));
+        }
+    }
+
+    if (simulator.getDetectedCount() != expected.size() - 1 || simulator.getVectorsCount() != 4) {
+        throw std::runtime_error(std::to_string(simulator.getDetectedCount()) + " faults detected in "
+                                 + std::to_string(simulator.getVectorsCount()) + " vectors");
+    }
+
+    // nothing detects the redundant fault, so repeating the vectors changes nothing but their count
+    if (simulator.simulate(inputs, std::vector<int32_t>{0, 0, 1, 1, 0, 1, 0, 1}, 4) != 0
+        || simulator.getVectorsCount() != 8 || simulator.getDetectingVector(0) != expected.at({"a", false})) {
+        throw std::runtime_error("repeated vectors change what was detected");
+    }
+
+    simulator.reset();
+    if (simulator.getDetectedCount() != 0 || simulator.getVectorsCount() != 0) {
+        throw std::runtime_error("reset keeps what was detected");
+    }
+}
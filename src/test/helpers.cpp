@@ -0,0 +1,30 @@
+#include "helpers.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+std::string getTempPath(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / ("circuit-test-" + name)).string();
+}
+
+void writeFile(const std::string& path, std::string_view contents) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.write(contents.data(), static_cast<std::streamsize>(contents.size())) || !file.flush()) {
+        throw std::runtime_error("cannot write " + path);
+    }
+}
+
+void mutate(std::string& data, std::mt19937_64& rng) {
+    const size_t position = rng() % data.size();
+    for (size_t i = 0, count = 1 + rng() % 4; i < count; i++) {
+        data[std::min(data.size() - 1, position + rng() % 8)] ^= static_cast<char>(1 + rng() % 255);
+    }
+}
+
+std::string saveText(const Netlist& netlist) {
+    std::ostringstream out;
+    netlist.save(out);
+    return out.str();
+}
@@ -0,0 +1,38 @@
+#ifndef CIRCUIT_TEST_HELPERS_H
+#define CIRCUIT_TEST_HELPERS_H
+
+#include "../circuit/io/netlist.h"
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+/**
+ * A path in the temporary directory, unique to the given name.
+ */
+std::string getTempPath(const std::string& name);
+
+void writeFile(const std::string& path, std::string_view contents);
+
+/**
+ * Flips random bits of `data` in place, at most a few bytes apart from a random position.
+ */
+void mutate(std::string& data, std::mt19937_64& rng);
+
+std::string saveText(const Netlist& netlist);
+
+/**
+ * Runs `fn`, which is expected to reject its input by throwing std::runtime_error.
+ */
+template<typename F>
+void expectRejected(F&& fn, const std::string& input) {
+    try {
+        fn();
+    } catch (const std::runtime_error &) {
+        return;
+    }
+
+    throw std::runtime_error(input + " was accepted");
+}
+
+#endif //CIRCUIT_TEST_HELPERS_H
@@ -0,0 +1,161 @@
+#include "random-netlist.h"
+#include "tests.h"
+#include "../circuit/visitor.h"
+
+#include <sstream>
+#include <stdexcept>
+
+constexpr static uint64_t CIRCUITS_COUNT = 50;
+constexpr static size_t CHANGES_COUNT = 40;
+
+static void evaluateAll(const Circuit& circuit) {
+    CircuitVisitor_Eval eval(circuit.validate());
+    for (CircuitGate *gate : circuit.getGates()) {
+        gate->acceptVisitor(eval);
+    }
+}
+
+static bool isRegister(CircuitGate& gate) {
+    const std::string type = getGateType(gate);
+    return type == "Register" || type == "IntRegister";
+}
+
+/**
+ * The gates reachable from `gate` along connections, `gate` included. Without `throughRegisters`,
+ * the walk stops at registers, whose outputs do not depend on their input until the next clock edge.
+ */
+static std::vector<bool> findFanout(const Circuit& circuit, CircuitGate& gate, bool throughRegisters) {
+    std::vector<bool> fanout(circuit.getGatesCount());
+    std::vector<CircuitGate *> stack = {&gate};
+    fanout[gate.getId()] = true;
+
+    while (!stack.empty()) {
+        CircuitGate *next = stack.back();
+        stack.pop_back();
+
+        next->forEachFanout([&](CircuitGate& consumer) {
+            if (fanout[consumer.getId()] || (!throughRegisters && isRegister(consumer))) return;
+
+            fanout[consumer.getId()] = true;
+            stack.push_back(&consumer);
+        });
+    }
+
+    return fanout;
+}
+
+/**
+ * Checks what `invalidate()` relies on: every evaluated gate other than a register, which outputs
+ * its state, reads only evaluated outputs.
+ */
+static void checkCachedFanin(const Netlist& netlist, const std::string& when) {
+    for (CircuitGate *gate : netlist.circuit.getGates()) {
+        if (!gate->isEvaluated() || isRegister(*gate)) continue;
+
+        for (size_t i = 0; i < gate->getInputsCount(); i++) {
+            if (gate->getInput(i).destGate != CircuitGate::NO_GATE && !gate->getOutputForInput(i).isEval) {
+                throw std::runtime_error(when + ": " + netlist.names[gate->getId()]
+                                         + " is evaluated but its input " + std::to_string(i) + " is not");
+            }
+        }
+    }
+}
+
+/**
+ * Compares every cached value with what a freshly built copy of the circuit evaluates to.
+ */
+static void checkValues(const RandomNetlist& random, const std::string& when) {
+    const Netlist &netlist = random.netlist;
+    std::stringstream text;
+    netlist.save(text);
+    const Netlist fresh = Netlist::load(text);
+    evaluateAll(fresh.circuit);
+
+    for (CircuitGate *gate : netlist.circuit.getGates()) {
+        for (size_t o = 0; o < gate->getOutputsCount(); o++) {
+            const CircuitGate::OutputPin actual = gate->getOutput(o);
+            const CircuitGate::OutputPin expected = fresh.circuit[gate->getId()].getOutput(o);
+            if (actual.isEval != expected.isEval || (actual.isEval && actual.value != expected.value)) {
+                throw std::runtime_error(when + ": " + netlist.names[gate->getId()] + "." + std::to_string(o)
+                                         + " is stale");
+            }
+        }
+    }
+}
+
+static void testStaleFanout() {
+    // a -> b -> d, after the fan-in of b alone was cleared
+    Netlist netlist;
+    Circuit &circuit = netlist.circuit;
+    CircuitGate &a = netlist.add("a", "ConstBool");
+    CircuitGate &b = netlist.add("b", "Not");
+    CircuitGate &d = netlist.add("d", "Not");
+    circuit.connect(a.getId(), 0, b.getId(), 0);
+    circuit.connect(b.getId(), 0, d.getId(), 0);
+
+    evaluateAll(circuit);
+    b.clearCaches();
+    checkCachedFanin(netlist, "after clearing the caches of b");
+
+    (void) setConstantValue(a, true);
+    evaluateAll(circuit);
+    if (d.getOutput(0).value != 1) {
+        throw std::runtime_error("d keeps its value from before a changed");
+    }
+}
+
+static void testRandomChanges(uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    RandomNetlist random = makeRandomNetlist(10 + seed * 37 % 200, true, rng);
+    Circuit &circuit = random.netlist.circuit;
+    evaluateAll(circuit);
+
+    for (size_t change = 0; change < CHANGES_COUNT; change++) {
+        const std::string when = "circuit " + std::to_string(seed) + ", change " + std::to_string(change);
+        CircuitGate &gate = *circuit.getGates()[rng() % circuit.getGatesCount()];
+
+        // changing a value invalidates everything depending on it, and nothing outside its fan-out;
+        // whatever lies behind registers may go either way
+        std::vector<bool> cached(circuit.getGatesCount());
+        for (CircuitGate *other : circuit.getGates()) {
+            cached[other->getId()] = other->isEvaluated();
+        }
+        const std::vector<bool> dependent = findFanout(circuit, gate, false);
+        const std::vector<bool> fanout = findFanout(circuit, gate, true);
+
+        const std::optional<int> value = getConstantValue(gate);
+        if (!value) {
+            gate.clearCaches();
+        } else if (gate.getOutputType(0) == CircuitGate::Bool) {
+            (void) setConstantValue(gate, !*value);
+        } else {
+            (void) setConstantValue(gate, makeRandomInt(rng));
+        }
+
+        for (CircuitGate *other : circuit.getGates()) {
+            const CircuitGate::GateID id = other->getId();
+            if (dependent[id] && other->isEvaluated()) {
+                throw std::runtime_error(when + ": " + random.netlist.names[id] + " is still cached");
+            }
+            if (value && cached[id] && !fanout[id] && !other->isEvaluated()) {
+                throw std::runtime_error(when + ": " + random.netlist.names[id] + " was invalidated");
+            }
+        }
+        checkCachedFanin(random.netlist, when);
+
+        if (rng() % 4 == 0) {
+            circuit.clock();
+            checkCachedFanin(random.netlist, when + " and a clock edge");
+        }
+        evaluateAll(circuit);
+        checkValues(random, when);
+    }
+}
+
+void testInvalidation() {
+    testStaleFanout();
+
+    for (uint64_t seed = 0; seed < CIRCUITS_COUNT; seed++) {
+        testRandomChanges(seed);
+    }
+}
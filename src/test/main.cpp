@@ -0,0 +1,60 @@
+#include "tests.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static void printUsage() {
+    std::cerr << "usage: circuit-test [<test>...]\n"
+                 "\n"
+                 "Runs the named tests, or all of them: differential, binary-netlist, stimulus, trace, faults,\n"
+                 "clock, invalidation, traversal, async, validation, equivalence, netlist.\n";
+}
+
+int main(int argc, char **argv) {
+    const std::vector<std::pair<std::string, std::function<void()>>> tests = {
+            {"differential", testDifferential},
+            {"binary-netlist", testBinaryNetlist},
+            {"stimulus", testStimulus},
+            {"trace", testTrace},
+            {"faults", testFaults},
+            {"clock", testClock},
+            {"invalidation", testInvalidation},
+            {"traversal", testTraversal},
+            {"async", testAsync},
+            {"validation", testValidation},
+            {"equivalence", testEquivalence},
+            {"netlist", testNetlist},
+    };
+
+    std::vector<std::string> selected(argv + 1, argv + argc);
+    for (const std::string &name : selected) {
+        if (std::none_of(tests.begin(), tests.end(), [&](const auto& test) { return test.first == name; })) {
+            printUsage();
+            return 2;
+        }
+    }
+
+    int failures = 0;
+    for (const auto &[name, run] : tests) {
+        if (!selected.empty() && std::find(selected.begin(), selected.end(), name) == selected.end()) continue;
+
+        const auto start = std::chrono::steady_clock::now();
+        try {
+            run();
+        } catch (const std::exception &e) {
+            std::cerr << name << ": FAILED: " << e.what() << "\n";
+            failures++;
+            continue;
+        }
+
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cerr << name << ": passed in " << elapsed.count() << " s\n";
+    }
+
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,42 @@
+#include "helpers.h"
+#include "random-netlist.h"
+#include "tests.h"
+
+#include <climits>
+#include <sstream>
+
+constexpr static uint64_t NETLISTS_COUNT = 50;
+
+static Netlist loadText(const std::string& text) {
+    std::istringstream in(text);
+    return Netlist::load(in);
+}
+
+void testNetlist() {
+    // saving and loading again gives back the same text
+    for (uint64_t seed = 0; seed < NETLISTS_COUNT; seed++) {
+        std::mt19937_64 rng(seed);
+        const RandomNetlist random = makeRandomNetlist(10 + seed * 37 % 200, true, rng);
+        const std::string text = saveText(random.netlist);
+        if (saveText(loadText(text)) != text) {
+            throw std::runtime_error("netlist " + std::to_string(seed) + " reads back differently");
+        }
+    }
+
+    const Netlist values = loadText("gate a ConstInt -2147483648  # the smallest value\n"
+                                    "gate b ConstBool 1\n"
+                                    "gate c Register\n");
+    if (getConstantValue(*values.find("a")) != INT32_MIN || getConstantValue(*values.find("b")) != 1
+        || getConstantValue(*values.find("c")) != 0) {
+        throw std::runtime_error("gate values are read wrong");
+    }
+
+    expectRejected([] { (void) loadText("gate a ConstInt 12abc\n"); }, "a value followed by garbage");
+    expectRejected([] { (void) loadText("gate a ConstInt zz\n"); }, "a value which is not a number");
+    expectRejected([] { (void) loadText("gate a ConstInt 99999999999\n"); }, "a value out of range");
+    expectRejected([] { (void) loadText("gate a ConstInt 1 2\n"); }, "a gate line with two values");
+    expectRejected([] { (void) loadText("gate a And 1\n"); }, "a value for a gate without one");
+    expectRejected([] { (void) loadText("gate a ConstBool\ngate b Not\nwire a b.0 c\n"); },
+                   "a wire line with a token too many");
+    expectRejected([] { (void) loadText("gate a ConstBool\noutput a a\n"); }, "an output line naming two outputs");
+}
@@ -0,0 +1,131 @@
+#include "random-netlist.h"
+#include "../circuit/hierarchy/circuit-definition.h"
+
+#include <memory>
+
+using GateID = CircuitGate::GateID;
+
+// outputs gates may read from, by type
+struct Sources {
+    std::vector<std::pair<GateID, size_t>> bools, ints;
+};
+
+int32_t makeRandomInt(std::mt19937_64& rng) {
+    if (rng() % 4 == 0) return static_cast<int32_t>(rng());
+    return static_cast<int32_t>(rng() % 33) - 16;
+}
+
+static void addSources(Sources& sources, const CircuitGate& gate) {
+    for (size_t o = 0; o < gate.getOutputsCount(); o++) {
+        auto &pool = gate.getOutputType(o) == CircuitGate::Bool ? sources.bools : sources.ints;
+        pool.emplace_back(gate.getId(), o);
+    }
+}
+
+static void connectRandomly(Circuit& circuit, GateID gate, size_t input, const Sources& sources,
+                            std::mt19937_64& rng) {
+    const auto &pool = circuit[gate].getInput(input).type == CircuitGate::Bool ? sources.bools : sources.ints;
+    if (pool.empty()) return;
+
+    const auto [source, output] = pool[rng() % pool.size()];
+    circuit.connect(source, output, gate, input);
+}
+
+static CircuitGate& addNamed(Netlist& netlist, const std::string& type) {
+    return netlist.add('g' + std::to_string(netlist.circuit.getGatesCount()), type);
+}
+
+static void addRandomGates(Netlist& netlist, Sources& sources, size_t count, const std::vector<std::string>& types,
+                           size_t unconnectedOdds, std::mt19937_64& rng) {
+    for (size_t i = 0; i < count; i++) {
+        CircuitGate &gate = addNamed(netlist, types[rng() % types.size()]);
+
+        for (size_t k = 0; k < gate.getInputsCount(); k++) {
+            if (unconnectedOdds > 0 && rng() % unconnectedOdds == 0) continue;
+            connectRandomly(netlist.circuit, gate.getId(), k, sources, rng);
+        }
+
+        addSources(sources, gate);
+    }
+}
+
+static void defineRandomly(Netlist& netlist, const std::string& name, const std::vector<std::string>& types,
+                           std::mt19937_64& rng) {
+    Netlist body;
+    Sources sources;
+    std::vector<CircuitDefinition::Port> inputs, outputs;
+
+    // earlier definitions can be instantiated inside this one
+    for (const Netlist::Definition &definition : netlist.definitions) {
+        body.define(definition.definition, definition.names);
+    }
+
+    for (const char *type : {"ConstBool", "ConstInt", "ConstBool", "ConstInt"}) {
+        const CircuitGate &gate = addNamed(body, type);
+        inputs.push_back({body.names[gate.getId()], gate.getId()});
+        addSources(sources, gate);
+    }
+
+    // every output port must be evaluable, so nothing is left unconnected
+    addRandomGates(body, sources, 12, types, 0, rng);
+    outputs.push_back({"b", sources.bools.back().first, sources.bools.back().second});
+    outputs.push_back({"i", sources.ints.back().first, sources.ints.back().second});
+
+    netlist.define(std::make_shared<const CircuitDefinition>(name, std::move(body.circuit), std::move(inputs),
+                                                             std::move(outputs)),
+                   std::move(body.names));
+}
+
+RandomNetlist makeRandomNetlist(size_t gatesCount, bool withSubCircuits, std::mt19937_64& rng) {
+    RandomNetlist random;
+    Netlist &netlist = random.netlist;
+    Sources sources;
+
+    std::vector<std::string> types = {"ConstTrue", "Not", "And", "Add", "Mul", "CmpLe"};
+    if (withSubCircuits) {
+        for (const char *name : {"Inner", "Outer"}) {
+            defineRandomly(netlist, name, types, rng);
+            types.emplace_back(name);
+        }
+    }
+
+    const size_t sourcesCount = std::max<size_t>(2, gatesCount / 16);
+    for (size_t i = 0; i < sourcesCount; i++) {
+        CircuitGate &input = addNamed(netlist, i % 2 ? "ConstInt" : "ConstBool");
+        setConstantValue(input, i % 2 ? makeRandomInt(rng) : static_cast<int>(rng() % 2));
+
+        random.inputs.push_back(input.getId());
+        addSources(sources, input);
+    }
+
+    std::vector<GateID> registers;
+    for (size_t i = 0; i < sourcesCount; i++) {
+        CircuitGate &reg = addNamed(netlist, i % 2 ? "IntRegister" : "Register");
+        setConstantValue(reg, i % 2 ? makeRandomInt(rng) : static_cast<int>(rng() % 2));
+
+        registers.push_back(reg.getId());
+        addSources(sources, reg);
+    }
+
+    addRandomGates(netlist, sources, gatesCount, types, 100, rng);
+
+    // a register with nothing to latch just keeps its state
+    for (GateID reg : registers) {
+        if (rng() % 8 != 0) {
+            connectRandomly(netlist.circuit, reg, 0, sources, rng);
+        }
+    }
+
+    for (CircuitGate *gate : netlist.circuit.getGates()) {
+        if (rng() % 4 != 0) continue;
+
+        const size_t output = rng() % gate->getOutputsCount();
+        std::string name = netlist.names[gate->getId()];
+        if (gate->getOutputsCount() > 1) {
+            name += '.' + std::to_string(output);
+        }
+        netlist.outputs.push_back({name, gate->getId(), output});
+    }
+
+    return random;
+}
@@ -0,0 +1,31 @@
+#ifndef CIRCUIT_TEST_RANDOM_NETLIST_H
+#define CIRCUIT_TEST_RANDOM_NETLIST_H
+
+#include "../circuit/io/netlist.h"
+#include <random>
+#include <vector>
+
+/**
+ * A random netlist together with its primary inputs, the ConstBool and ConstInt gates the tests
+ * drive. Every gate has a name and a few random outputs are declared.
+ */
+struct RandomNetlist {
+    Netlist netlist;
+    std::vector<CircuitGate::GateID> inputs;
+};
+
+/**
+ * `gatesCount` gates of every built-in type, each input reading a random earlier output of its
+ * type, after the inputs and a few registers. Register inputs read any gate, so loops through them
+ * are common. With `withSubCircuits`, there are also instances of two random definitions, the
+ * second one instantiating the first. One input in a hundred is left unconnected, so that some
+ * gates cannot be evaluated.
+ */
+RandomNetlist makeRandomNetlist(size_t gatesCount, bool withSubCircuits, std::mt19937_64& rng);
+
+/**
+ * Mostly small values, which keep comparisons interesting, and now and then any value at all.
+ */
+int32_t makeRandomInt(std::mt19937_64& rng);
+
+#endif //CIRCUIT_TEST_RANDOM_NETLIST_H
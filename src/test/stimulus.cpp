@@ -0,0 +1,148 @@
+#include "helpers.h"
+#include "random-netlist.h"
+#include "tests.h"
+#include "../circuit/io/stimulus.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+constexpr static uint64_t STIMULI_COUNT = 50;
+
+static std::vector<int32_t> readStimulus(const std::string& data, StimulusFormat format, size_t columnsCount,
+                                         size_t maxVectors, std::vector<std::string> *columns = nullptr) {
+    std::istringstream in(data);
+    StimulusReader reader(in, format);
+    if (columns) *columns = reader.getColumns();
+    if (reader.getColumns().size() != columnsCount) {
+        throw std::runtime_error("stimulus read back with " + std::to_string(reader.getColumns().size())
+                                 + " columns instead of " + std::to_string(columnsCount));
+    }
+
+    // gathered column by column, like the values it was written from
+    std::vector<std::vector<int32_t>> gathered(columnsCount);
+    std::vector<int32_t> chunk(columnsCount * maxVectors);
+    while (const size_t count = reader.read(chunk, maxVectors)) {
+        for (size_t c = 0; c < columnsCount; c++) {
+            gathered[c].insert(gathered[c].end(), &chunk[c * maxVectors], &chunk[c * maxVectors] + count);
+        }
+    }
+
+    std::vector<int32_t> values;
+    for (const std::vector<int32_t> &column : gathered) {
+        values.insert(values.end(), column.begin(), column.end());
+    }
+
+    return values;
+}
+
+static void testStimulusRoundTrip(StimulusFormat format, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    const size_t columnsCount = 1 + rng() % 5;
+    const size_t vectorsCount = rng() % 3000;
+    const std::string formatName = format == StimulusFormat::Csv ? "CSV" : "binary";
+
+    std::vector<std::string> columns;
+    for (size_t c = 0; c < columnsCount; c++) {
+        columns.push_back('c' + std::to_string(c));
+    }
+
+    std::vector<int32_t> values(columnsCount * vectorsCount);
+    for (int32_t &value : values) {
+        value = makeRandomInt(rng);
+    }
+
+    std::ostringstream out;
+    StimulusWriter writer(out, format, columns);
+    for (size_t written = 0; written < vectorsCount;) {
+        const size_t count = std::min(vectorsCount - written, size_t(1 + rng() % 700));
+        writer.write(std::span<const int32_t>(values).subspan(written), vectorsCount, count);
+        written += count;
+    }
+    writer.flush();
+
+    const std::string data = out.str();
+    std::vector<std::string> readColumns;
+    if (readStimulus(data, format, columnsCount, 1 + rng() % 1000, &readColumns) != values || readColumns != columns) {
+        throw std::runtime_error(formatName + " stimulus " + std::to_string(seed) + " reads back differently");
+    }
+
+    if (format != StimulusFormat::Binary || seed % 10 != 0) return;
+
+    // a file cut short has to be rejected, unless it ends between two blocks
+    for (size_t size = 0; size < data.size(); size += 1 + size / 16) {
+        std::vector<int32_t> prefix;
+        try {
+            prefix = readStimulus(data.substr(0, size), format, columnsCount, 64);
+        } catch (const std::runtime_error &) {
+            continue;
+        }
+
+        const size_t prefixVectors = prefix.size() / columnsCount;
+        for (size_t c = 0; c < columnsCount; c++) {
+            if (!std::equal(prefix.begin() + c * prefixVectors, prefix.begin() + (c + 1) * prefixVectors,
+                            values.begin() + c * vectorsCount)) {
+                throw std::runtime_error("binary stimulus truncated to " + std::to_string(size)
+                                         + " bytes reads other vectors");
+            }
+        }
+    }
+}
+
+void testStimulus() {
+    for (uint64_t seed = 0; seed < STIMULI_COUNT; seed++) {
+        testStimulusRoundTrip(StimulusFormat::Csv, seed);
+        testStimulusRoundTrip(StimulusFormat::Binary, seed);
+    }
+
+    // blank lines, Windows line breaks, spaces around values and no line break at the end
+    const std::vector<int32_t> values = readStimulus("a,b\n\n1,-2\r\n  3 , 4\n\n5,-2147483648", StimulusFormat::Csv,
+                                                     2, 2);
+    if (values != std::vector<int32_t>{1, 3, 5, -2, 4, INT32_MIN}) {
+        throw std::runtime_error("hand-written CSV stimulus reads wrong");
+    }
+
+    const auto readCsv = [](const std::string& data) {
+        return [data] { readStimulus(data, StimulusFormat::Csv, 2, 4); };
+    };
+    expectRejected(readCsv(""), "CSV stimulus without a header");
+    expectRejected(readCsv("a,b\n1\n"), "CSV stimulus with a value missing");
+    expectRejected(readCsv("a,b\n1,2,3\n"), "CSV stimulus with a value too many");
+    expectRejected(readCsv("a,b\n1,x\n"), "CSV stimulus with a value which is not a number");
+    expectRejected(readCsv("a,b\n1,99999999999\n"), "CSV stimulus with a value out of range");
+
+    std::ostringstream out;
+    StimulusWriter writer(out, StimulusFormat::Binary, {"a"});
+    writer.flush();
+    const std::string header = out.str();
+    const auto readBinary = [](const std::string& data) {
+        return [data] { readStimulus(data, StimulusFormat::Binary, 1, 4); };
+    };
+
+    std::string corrupted = header;
+    corrupted[0] = 'X';
+    expectRejected(readBinary(corrupted), "binary stimulus with a wrong magic");
+
+    corrupted = header;
+    const uint32_t version = StimulusHeader::VERSION + 1;
+    std::memcpy(corrupted.data() + offsetof(StimulusHeader, version), &version, sizeof version);
+    expectRejected(readBinary(corrupted), "binary stimulus of an unknown version");
+
+    // sizes far beyond the data are rejected before anything that large is allocated
+    corrupted = header;
+    const uint32_t huge = UINT32_MAX;
+    std::memcpy(corrupted.data() + sizeof(StimulusHeader), &huge, sizeof huge);
+    expectRejected(readBinary(corrupted + "a"), "binary stimulus with a column name of 4 GiB");
+
+    corrupted = header;
+    corrupted.append(reinterpret_cast<const char *>(&huge), sizeof huge);
+    corrupted.append(4 * sizeof(int32_t), '\0');
+    expectRejected(readBinary(corrupted), "binary stimulus with a block of 4 billion vectors");
+
+    expectRejected([] {
+        std::istringstream in("a,b\n1,2\n");
+        StimulusReader reader(in, StimulusFormat::Csv);
+        std::vector<int32_t> chunk(3);
+        reader.read(chunk, 2);
+    }, "stimulus chunk too small for its vectors");
+}
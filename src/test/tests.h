@@ -0,0 +1,73 @@
+#ifndef CIRCUIT_TEST_TESTS_H
+#define CIRCUIT_TEST_TESTS_H
+
+/**
+ * Every test throws std::runtime_error on the first failure, telling what went wrong and for which
+ * seed, so that the failing case can be rerun on its own.
+ */
+
+/**
+ * Evaluates random circuits with registers and sub-circuits for a few clock cycles with every
+ * evaluator, each of which has to agree with gate-level evaluation on every net in every cycle.
+ */
+void testDifferential();
+
+/**
+ * Binary netlists of random circuits read back like the netlist they were saved from, and damaged
+ * ones are either rejected or still safe to use.
+ */
+void testBinaryNetlist();
+
+void testStimulus();
+
+void testTrace();
+
+/**
+ * Fault simulation of a small circuit with one redundant fault finds every other fault, each on the
+ * first vector which detects it.
+ */
+void testFaults();
+
+/**
+ * Clock edges latch every register at once, keep registers without an evaluable input as they are,
+ * and cope with logic too deep to evaluate recursively.
+ */
+void testClock();
+
+/**
+ * Changing a value invalidates exactly the cached values depending on it, and clearing the caches
+ * of a gate never leaves anything evaluated from a stale input.
+ */
+void testInvalidation();
+
+/**
+ * Evaluating, clearing the caches of and printing a gate visit every gate of its fan-in once, however
+ * many paths lead to it.
+ */
+void testTraversal();
+
+/**
+ * Background evaluations deliver the result of the last submission only, nothing once cancelled,
+ * and tell by their revision whether the gates were edited in the meantime.
+ */
+void testAsync();
+
+/**
+ * Validation reports unconnected inputs, type mismatches and combinational cycles but not loops
+ * through registers, and marks everything depending on a problem as not evaluable.
+ */
+void testValidation();
+
+/**
+ * The equivalence checker reports the first vector on which a mutated circuit differs, passes a
+ * restructured but equivalent one, and pairs up the nets the two have in common.
+ */
+void testEquivalence();
+
+/**
+ * Text netlists read back as they were saved, and lines with malformed values or tokens left over
+ * are rejected.
+ */
+void testNetlist();
+
+#endif //CIRCUIT_TEST_TESTS_H
@@ -0,0 +1,157 @@
+#include "helpers.h"
+#include "random-netlist.h"
+#include "tests.h"
+#include "../circuit/io/trace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <sstream>
+
+constexpr static size_t MUTATIONS_COUNT = 1000;
+
+/**
+ * Records random samples of a few Int and Bool constants, and one gate which cannot be evaluated,
+ * into a trace and returns it, together with the values and times of the samples.
+ */
+static std::string recordTrace(size_t samplesCount, size_t signalsCount, std::mt19937_64& rng,
+                               std::vector<std::vector<int32_t>>& samples, std::vector<uint64_t>& times) {
+    Circuit circuit;
+    std::vector<CircuitGate::GateID> constants;
+    for (size_t s = 0; s < signalsCount; s++) {
+        constants.push_back(s % 2 ? circuit.add<CircuitGate_ConstInt>().getId()
+                                  : circuit.add<CircuitGate_ConstBool>().getId());
+    }
+    const CircuitGate &blocked = circuit.add<CircuitGate_Not>();
+
+    CompiledCircuit compiled(circuit);
+    std::vector<TraceRecorder::Probe> probes;
+    for (CircuitGate::GateID constant : constants) {
+        probes.push_back({'s' + std::to_string(constant), compiled.getSlot(circuit[constant], 0)});
+    }
+    probes.push_back({"blocked", compiled.getSlot(blocked, 0)});
+
+    std::ostringstream out;
+    TraceRecorder recorder(compiled, probes, out);
+
+    std::vector<int32_t> values(signalsCount, 0);
+    uint64_t time = 0;
+    for (size_t i = 0; i < samplesCount; i++) {
+        // mostly a change or two, and now and then nothing at all, which leaves the sample out
+        for (size_t changes = rng() % 3; changes > 0; changes--) {
+            const size_t s = rng() % signalsCount;
+            values[s] = s % 2 ? makeRandomInt(rng) : static_cast<int32_t>(rng() % 2);
+            compiled.setConstant(constants[s], values[s]);
+        }
+
+        compiled.run();
+        time += rng() % 3;
+        recorder.record(time);
+
+        samples.push_back(values);
+        samples.back().push_back(0);
+        times.push_back(time);
+    }
+
+    recorder.finish();
+    return out.str();
+}
+
+/**
+ * The values of every sample of a trace, or nothing if the trace is rejected.
+ */
+static std::optional<std::vector<std::vector<int32_t>>> readTrace(const std::string& data) {
+    std::vector<std::vector<int32_t>> samples;
+
+    try {
+        std::istringstream in(data);
+        TraceReader reader(in);
+
+        while (reader.next()) {
+            std::vector<int32_t> &values = samples.emplace_back(reader.getSignalsCount());
+            for (size_t s = 0; s < values.size(); s++) {
+                values[s] = reader.getValue(s);
+            }
+        }
+    } catch (const std::runtime_error &) {
+        return std::nullopt;
+    }
+
+    return samples;
+}
+
+void testTrace() {
+    std::mt19937_64 rng(1);
+
+    // enough samples for the recorder's ring to wrap around a few times
+    std::vector<std::vector<int32_t>> samples;
+    std::vector<uint64_t> times;
+    const std::string data = recordTrace(400000, 40, rng, samples, times);
+
+    std::istringstream in(data);
+    TraceReader reader(in);
+    if (reader.getSignalsCount() != 41 || reader.isKnown(40) || !reader.isKnown(0)
+        || reader.getType(0) != CircuitGate::Bool || reader.getType(1) != CircuitGate::Int) {
+        throw std::runtime_error("trace signals read back wrong");
+    }
+
+    // samples which change nothing are left out, except for the last one
+    std::vector<int32_t> current(reader.getSignalsCount(), 0);
+    for (size_t i = 0; i < samples.size(); i++) {
+        const bool isLast = i + 1 == samples.size();
+        if (i > 0 && samples[i] == current && !isLast) continue;
+
+        if (!reader.next() || reader.getTime() != times[i]) {
+            throw std::runtime_error("trace sample " + std::to_string(i) + " is missing");
+        }
+
+        for (size_t s = 0; s < reader.getSignalsCount(); s++) {
+            const bool changed = std::binary_search(reader.getChanged().begin(), reader.getChanged().end(), s);
+            if (reader.getValue(s) != samples[i][s] || changed != (samples[i][s] != current[s])) {
+                throw std::runtime_error("trace sample " + std::to_string(i) + " reads back wrong");
+            }
+        }
+        current = samples[i];
+    }
+    if (reader.next()) {
+        throw std::runtime_error("trace has samples which were never recorded");
+    }
+
+    // small enough to cut off at every byte
+    samples.clear();
+    times.clear();
+    const std::string small = recordTrace(200, 6, rng, samples, times);
+
+    const std::optional<std::vector<std::vector<int32_t>>> expected = readTrace(small);
+
+    // a trace cut short has to be rejected, unless it ends between two samples
+    for (size_t size = 0; size < small.size(); size++) {
+        const auto prefix = readTrace(small.substr(0, size));
+        if (prefix && (prefix->size() > expected->size()
+                       || !std::equal(prefix->begin(), prefix->end(), expected->begin()))) {
+            throw std::runtime_error("trace truncated to " + std::to_string(size) + " bytes reads other samples");
+        }
+    }
+
+    // whatever the damage, it is either rejected or read as some trace
+    for (size_t m = 0; m < MUTATIONS_COUNT; m++) {
+        std::string corrupted = small;
+        mutate(corrupted, rng);
+        (void) readTrace(corrupted);
+    }
+
+    std::string corrupted = small;
+    corrupted[0] = 'X';
+    expectRejected([&] {
+        std::istringstream corruptedIn(corrupted);
+        TraceReader wrongMagic(corruptedIn);
+    }, "trace with a wrong magic");
+
+    corrupted = small;
+    const uint32_t version = TraceHeader::VERSION + 1;
+    std::memcpy(corrupted.data() + offsetof(TraceHeader, version), &version, sizeof version);
+    expectRejected([&] {
+        std::istringstream corruptedIn(corrupted);
+        TraceReader wrongVersion(corruptedIn);
+    }, "trace of an unknown version");
+}
@@ -0,0 +1,88 @@
+#include "tests.h"
+#include "../circuit/visitor.h"
+
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+// a walk which does not remember where it has been follows 2^LEVELS_COUNT paths through the ladder
+constexpr static size_t LEVELS_COUNT = 64;
+
+/**
+ * Redirects std::cout into a string for as long as it lives.
+ */
+class CaptureOutput {
+    std::ostringstream captured;
+    std::streambuf *original;
+
+public:
+    CaptureOutput() : original(std::cout.rdbuf(captured.rdbuf())) { }
+
+    ~CaptureOutput() { std::cout.rdbuf(original); }
+
+    [[nodiscard]]
+    std::string get() const { return captured.str(); }
+};
+
+void testTraversal() {
+    // a ladder in which both gates of every level read both gates of the level below
+    Circuit circuit;
+    CircuitGate::GateID left = circuit.add<CircuitGate_ConstBool>().getId();
+    CircuitGate::GateID right = circuit.add<CircuitGate_ConstTrue>().getId();
+    size_t linksCount = 0;
+
+    for (size_t level = 0; level < LEVELS_COUNT; level++) {
+        const CircuitGate::GateID nextLeft = circuit.add<CircuitGate_And>().getId();
+        const CircuitGate::GateID nextRight = circuit.add<CircuitGate_And>().getId();
+        for (CircuitGate::GateID gate : {nextLeft, nextRight}) {
+            circuit.connect(left, 0, gate, 0);
+            circuit.connect(right, 0, gate, 1);
+            linksCount += 2;
+        }
+        left = nextLeft;
+        right = nextRight;
+    }
+
+    CircuitGate &top = circuit.add<CircuitGate_And>();
+    circuit.connect(left, 0, top.getId(), 0);
+    circuit.connect(right, 0, top.getId(), 1);
+    linksCount += 2;
+
+    CircuitVisitor_Eval eval(circuit.validate());
+    top.acceptVisitor(eval);
+    for (CircuitGate *gate : circuit.getGates()) {
+        if (!gate->isEvaluated()) {
+            throw std::runtime_error("gate " + std::to_string(gate->getId()) + " was not evaluated");
+        }
+    }
+
+    top.clearCaches();
+    for (CircuitGate *gate : circuit.getGates()) {
+        if (gate->isEvaluated()) {
+            throw std::runtime_error("gate " + std::to_string(gate->getId()) + " is still cached");
+        }
+    }
+
+    // one line for every link followed, each gate being written out in full the first time only
+    std::string printed;
+    {
+        CaptureOutput capture;
+        top.print();
+        printed = capture.get();
+    }
+
+    std::istringstream lines(printed);
+    std::string line;
+    size_t linesCount = 0, expandedCount = 0;
+    while (std::getline(lines, line)) {
+        linesCount++;
+        if (line.find("(see above)") == std::string::npos) {
+            expandedCount++;
+        }
+    }
+
+    if (linesCount != linksCount + 1 || expandedCount != circuit.getGatesCount()) {
+        throw std::runtime_error("printing the ladder wrote " + std::to_string(linesCount) + " lines expanding "
+                                 + std::to_string(expandedCount) + " gates");
+    }
+}
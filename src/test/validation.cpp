@@ -0,0 +1,134 @@
+#include "tests.h"
+#include "../circuit/circuit.h"
+#include "../circuit/io/netlist.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using Diagnostic = CircuitValidation::Diagnostic;
+using GateTest = bool (CircuitValidation::*)(CircuitGate::GateID) const;
+
+static const Diagnostic& findDiagnostic(const CircuitValidation& validation, Diagnostic::Kind kind) {
+    const auto diagnostics = validation.getDiagnostics();
+    const auto found = std::find_if(diagnostics.begin(), diagnostics.end(),
+                                    [&](const Diagnostic& diagnostic) { return diagnostic.kind == kind; });
+    if (found == diagnostics.end()) {
+        throw std::runtime_error("diagnostic of kind " + std::to_string(kind) + " is missing");
+    }
+
+    return *found;
+}
+
+static void expectDiagnostic(const Netlist& netlist, const Diagnostic& diagnostic, const std::string& gate,
+                             size_t input) {
+    const std::string description = CircuitValidation::describe(netlist.circuit, diagnostic, netlist.names);
+    if (netlist.names[diagnostic.gate] != gate || diagnostic.input != input
+        || description.find(gate) == std::string::npos) {
+        throw std::runtime_error("wrong diagnostic: " + description);
+    }
+}
+
+static void expectCycle(const Netlist& netlist, const Diagnostic& diagnostic, std::vector<std::string> gates) {
+    const std::vector<CircuitGate::GateID> &cycle = diagnostic.cycle;
+
+    std::vector<std::string> names;
+    for (CircuitGate::GateID gate : cycle) {
+        names.push_back(netlist.names[gate]);
+    }
+    std::sort(names.begin(), names.end());
+    std::sort(gates.begin(), gates.end());
+    if (names != gates || std::find(cycle.begin(), cycle.end(), diagnostic.gate) == cycle.end()) {
+        throw std::runtime_error("wrong cycle: " + CircuitValidation::describe(netlist.circuit, diagnostic,
+                                                                                 netlist.names));
+    }
+
+    // every gate of the cycle reads from the one after it, and the last one from the first
+    for (size_t k = 0; k < cycle.size(); k++) {
+        const std::span<const CircuitGate::InputPin> inputs = netlist.circuit[cycle[k]].getInputs();
+        const CircuitGate::GateID next = cycle[(k + 1) % cycle.size()];
+        if (std::none_of(inputs.begin(), inputs.end(), [&](const auto& input) { return input.destGate == next; })) {
+            throw std::runtime_error("gate " + netlist.names[cycle[k]] + " of the cycle does not read "
+                                     + netlist.names[next]);
+        }
+    }
+}
+
+static void expectGates(const Netlist& netlist, const std::vector<std::string>& gates, GateTest test, bool expected,
+                        const std::string& what) {
+    const CircuitValidation &validation = netlist.circuit.validate();
+    for (const std::string &name : gates) {
+        if ((validation.*test)(netlist.find(name)->getId()) != expected) {
+            throw std::runtime_error(name + (expected ? " is not " : " is ") + what);
+        }
+    }
+}
+
+void testValidation() {
+    Netlist netlist;
+    Circuit &circuit = netlist.circuit;
+    auto add = [&](const std::string& name, const std::string& type) { (void) netlist.add(name, type); };
+    auto connect = [&](const std::string& source, const std::string& dest, size_t input) {
+        circuit.connect(netlist.find(source)->getId(), 0, netlist.find(dest)->getId(), input);
+    };
+
+    add("a", "ConstBool");
+    add("i", "ConstInt");
+    add("ok", "And");
+    connect("a", "ok", 0);
+    connect("a", "ok", 1);
+
+    // u misses its second input, m reads an Int with a Bool input
+    add("u", "And");
+    add("afterU", "Not");
+    connect("a", "u", 0);
+    connect("u", "afterU", 0);
+
+    add("m", "Not");
+    add("afterM", "Not");
+    connect("i", "m", 0);
+    connect("m", "afterM", 0);
+
+    // c1 -> c2 -> c3 -> c1, with a gate feeding into the cycle and one reading from it
+    add("c1", "And");
+    add("c2", "Not");
+    add("c3", "Not");
+    add("afterC", "Not");
+    connect("a", "c1", 0);
+    connect("c3", "c1", 1);
+    connect("c1", "c2", 0);
+    connect("c2", "c3", 0);
+    connect("c3", "afterC", 0);
+
+    // loops through registers are fine, and registers cut off the problems of their fan-in
+    add("r", "Register");
+    add("loop", "Not");
+    add("behindU", "Register");
+    connect("r", "loop", 0);
+    connect("loop", "r", 0);
+    connect("afterU", "behindU", 0);
+
+    const CircuitValidation &validation = circuit.validate();
+    if (validation.getDiagnostics().size() != 3 || validation.isValid()) {
+        throw std::runtime_error(std::to_string(validation.getDiagnostics().size()) + " diagnostics instead of 3");
+    }
+
+    expectDiagnostic(netlist, findDiagnostic(validation, Diagnostic::UnconnectedInput), "u", 1);
+    expectDiagnostic(netlist, findDiagnostic(validation, Diagnostic::TypeMismatch), "m", 0);
+    expectCycle(netlist, findDiagnostic(validation, Diagnostic::CombinationalCycle), {"c1", "c2", "c3"});
+
+    expectGates(netlist, {"u", "m", "c1", "c2", "c3"}, &CircuitValidation::isFaulty, true, "faulty");
+    expectGates(netlist, {"a", "i", "ok", "afterU", "afterM", "afterC", "r", "loop", "behindU"},
+                &CircuitValidation::isFaulty, false, "faulty");
+    expectGates(netlist, {"u", "afterU", "m", "afterM", "c1", "c2", "c3", "afterC"},
+                &CircuitValidation::isEvaluable, false, "evaluable");
+    expectGates(netlist, {"a", "i", "ok", "r", "loop", "behindU"}, &CircuitValidation::isEvaluable, true, "evaluable");
+
+    // an edit makes the circuit validated anew, this one fixing u and everything after it
+    connect("a", "u", 1);
+    const CircuitValidation &fixed = circuit.validate();
+    if (fixed.getDiagnostics().size() != 2 || fixed.getRevision() != circuit.getRevision()) {
+        throw std::runtime_error("connecting an input leaves " + std::to_string(fixed.getDiagnostics().size())
+                                 + " diagnostics");
+    }
+    expectGates(netlist, {"u", "afterU"}, &CircuitValidation::isEvaluable, true, "evaluable once connected");
+}